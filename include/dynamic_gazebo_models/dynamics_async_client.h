@@ -0,0 +1,350 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_DYNAMICS_ASYNC_CLIENT_H
+#define DYNAMIC_GAZEBO_MODELS_DYNAMICS_ASYNC_CLIENT_H
+
+#include <future>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+
+#include <dynamic_gazebo_models/AddGroup.h>
+#include <dynamic_gazebo_models/DeleteGroup.h>
+#include <dynamic_gazebo_models/BatchCommands.h>
+
+#define DEFAULT_BATCH_WINDOW 0.002 // in s
+#define DEFAULT_MAX_BATCH_SIZE 256 // commands per batch call
+
+/*
+
+Asynchronous client of the model dynamics manager (header-only):
+	Door & elevator commands return a std::future<bool> right away. Commands issued within DEFAULT_BATCH_WINDOW of the
+	first queued one are sent together in a single 'batch_commands' call (over a persistent connection) by a background
+	thread; the manager executes a batch in order, so the commands of one client keep their order.
+
+		dynamic_gazebo_models::AsyncDynamicsClient client;
+		std::future<bool> opened = client.openDoors(doors); // std::vector<uint32_t> of door reference numbers
+		client.gotoFloor("lifts", 3);
+		opened.get();
+
+	Commands can target a named group, or directly a list of units: the client then creates (and finally deletes) a
+	group for every distinct unit list & type it sees. Only the first command on a new unit list waits for that.
+
+*/
+
+namespace dynamic_gazebo_models
+{
+	class AsyncDynamicsClient
+	{
+		private:
+
+			typedef boost::shared_ptr<std::promise<bool> > ResultPtr;
+
+			ros::NodeHandle rosNode;
+			double batchWindow;
+			size_t maxBatchSize;
+
+			// batching:
+			boost::mutex queueMutex;
+			boost::condition_variable hasWork;
+			std::vector<ManagerCommand> queuedCommands;
+			std::vector<ResultPtr> queuedResults;
+			ros::WallTime batchStart;
+			bool isStopping;
+			ros::ServiceClient batchClient; // only used by the flush thread
+			boost::thread flushThread;
+
+			// groups created for unit lists:
+			boost::mutex groupsMutex;
+			std::map<std::pair<std::string, std::vector<uint32_t> >, std::string> unitGroups;
+			ros::ServiceClient addGroupClient, deleteGroupClient;
+
+		public:
+
+			AsyncDynamicsClient(const ros::NodeHandle &nh = ros::NodeHandle(""), double batchWindow = DEFAULT_BATCH_WINDOW, size_t maxBatchSize = DEFAULT_MAX_BATCH_SIZE)
+				: rosNode(nh), batchWindow(batchWindow), maxBatchSize(std::max<size_t>(maxBatchSize, 1)), isStopping(false)
+			{
+				flushThread = boost::thread(boost::bind(&AsyncDynamicsClient::flushLoop, this));
+			}
+
+			~AsyncDynamicsClient()
+			{
+				{
+					boost::mutex::scoped_lock lock(queueMutex);
+					isStopping = true; // queued commands are still sent
+				}
+
+				hasWork.notify_one();
+				flushThread.join();
+
+				boost::mutex::scoped_lock lock(groupsMutex);
+
+				for (std::map<std::pair<std::string, std::vector<uint32_t> >, std::string>::iterator it = unitGroups.begin(); it != unitGroups.end(); ++it) {
+					DeleteGroup srv;
+					srv.request.group_name = it->second;
+					deleteGroupClient.call(srv);
+				}
+			}
+
+			// Doors:
+			std::future<bool> openDoors(const std::string &group_name)
+			{
+				ManagerCommand cmd = command(ManagerCommand::OPEN_CLOSE_DOORS, group_name);
+				cmd.state = true;
+				return enqueue(cmd);
+			}
+
+			std::future<bool> closeDoors(const std::string &group_name)
+			{
+				ManagerCommand cmd = command(ManagerCommand::OPEN_CLOSE_DOORS, group_name);
+				cmd.state = false;
+				return enqueue(cmd);
+			}
+
+			std::future<bool> setDoorVel(const std::string &group_name, float linear, float angular)
+			{
+				ManagerCommand cmd = command(ManagerCommand::SET_VEL_DOORS, group_name);
+				cmd.lin_x = cmd.lin_y = linear;
+				cmd.ang_z = angular;
+				return enqueue(cmd);
+			}
+
+			std::future<bool> setDoorOpening(const std::string &group_name, float opening, float slideSpeed = 0, float flipSpeed = 0)
+			{
+				ManagerCommand cmd = command(ManagerCommand::SET_DOOR_OPENING, group_name);
+				cmd.opening = opening;
+				cmd.lin_x = slideSpeed;
+				cmd.ang_z = flipSpeed;
+				return enqueue(cmd);
+			}
+
+			std::future<bool> openDoors(const std::vector<uint32_t> &doors)
+			{
+				return openDoors(groupFor("door", doors));
+			}
+
+			std::future<bool> closeDoors(const std::vector<uint32_t> &doors)
+			{
+				return closeDoors(groupFor("door", doors));
+			}
+
+			std::future<bool> setDoorVel(const std::vector<uint32_t> &doors, float linear, float angular)
+			{
+				return setDoorVel(groupFor("door", doors), linear, angular);
+			}
+
+			std::future<bool> setDoorOpening(const std::vector<uint32_t> &doors, float opening, float slideSpeed = 0, float flipSpeed = 0)
+			{
+				return setDoorOpening(groupFor("door", doors), opening, slideSpeed, flipSpeed);
+			}
+
+			// Elevators:
+			std::future<bool> gotoFloor(const std::string &group_name, int floor)
+			{
+				ManagerCommand cmd = command(ManagerCommand::TARGET_FLOOR_ELEV, group_name);
+				cmd.target_floor = floor;
+				return enqueue(cmd);
+			}
+
+			std::future<bool> openElevDoors(const std::string &group_name)
+			{
+				ManagerCommand cmd = command(ManagerCommand::OPEN_CLOSE_ELEV_DOORS, group_name);
+				cmd.state = true;
+				return enqueue(cmd);
+			}
+
+			std::future<bool> closeElevDoors(const std::string &group_name)
+			{
+				ManagerCommand cmd = command(ManagerCommand::OPEN_CLOSE_ELEV_DOORS, group_name);
+				cmd.state = false;
+				return enqueue(cmd);
+			}
+
+			std::future<bool> setElevProps(const std::string &group_name, float velocity, float force)
+			{
+				ManagerCommand cmd = command(ManagerCommand::SET_ELEV_PROPS, group_name);
+				cmd.velocity = velocity;
+				cmd.force = force;
+				return enqueue(cmd);
+			}
+
+			std::future<bool> gotoFloor(const std::vector<uint32_t> &elevators, int floor)
+			{
+				return gotoFloor(groupFor("elevator", elevators), floor);
+			}
+
+			std::future<bool> openElevDoors(const std::vector<uint32_t> &elevators)
+			{
+				return openElevDoors(groupFor("elevator", elevators));
+			}
+
+			std::future<bool> closeElevDoors(const std::vector<uint32_t> &elevators)
+			{
+				return closeElevDoors(groupFor("elevator", elevators));
+			}
+
+			std::future<bool> setElevProps(const std::vector<uint32_t> &elevators, float velocity, float force)
+			{
+				return setElevProps(groupFor("elevator", elevators), velocity, force);
+			}
+
+		private:
+
+			ManagerCommand command(uint8_t type, const std::string &group_name)
+			{
+				ManagerCommand cmd;
+				cmd.type = type;
+				cmd.group_name = group_name;
+				return cmd;
+			}
+
+			std::future<bool> enqueue(const ManagerCommand &cmd)
+			{
+				ResultPtr result(new std::promise<bool>());
+				std::future<bool> future = result->get_future();
+
+				boost::mutex::scoped_lock lock(queueMutex);
+
+				if (queuedCommands.empty()) {
+					batchStart = ros::WallTime::now(); // the window opens with the first command
+				}
+
+				queuedCommands.push_back(cmd);
+				queuedResults.push_back(result);
+
+				if (queuedCommands.size() == 1 || queuedCommands.size() >= maxBatchSize) {
+					hasWork.notify_one();
+				}
+
+				return future;
+			}
+
+			void flushLoop()
+			{
+				while (true) {
+					std::vector<ManagerCommand> commands;
+					std::vector<ResultPtr> results;
+
+					{
+						boost::mutex::scoped_lock lock(queueMutex);
+
+						while (queuedCommands.empty() && !isStopping) {
+							hasWork.wait(lock);
+						}
+
+						if (queuedCommands.empty()) {
+							return; // stopping
+						}
+
+						// give other commands the rest of the window to join the batch:
+						ros::WallTime deadline = batchStart + ros::WallDuration(batchWindow);
+
+						while (!isStopping && queuedCommands.size() < maxBatchSize && ros::WallTime::now() < deadline) {
+							hasWork.timed_wait(lock, boost::posix_time::microseconds((deadline - ros::WallTime::now()).toNSec() / 1000 + 1));
+						}
+
+						size_t batchSize = std::min(queuedCommands.size(), maxBatchSize);
+
+						commands.assign(queuedCommands.begin(), queuedCommands.begin() + batchSize);
+						results.assign(queuedResults.begin(), queuedResults.begin() + batchSize);
+						queuedCommands.erase(queuedCommands.begin(), queuedCommands.begin() + batchSize);
+						queuedResults.erase(queuedResults.begin(), queuedResults.begin() + batchSize);
+
+						if (!queuedCommands.empty()) {
+							batchStart = ros::WallTime::now(); // the overflow starts a new window
+						}
+					}
+
+					send(commands, results);
+				}
+			}
+
+			void send(std::vector<ManagerCommand> &commands, std::vector<ResultPtr> &results)
+			{
+				BatchCommands srv;
+				srv.request.commands.swap(commands);
+
+				if (!batchClient.isValid()) {
+					batchClient = rosNode.serviceClient<BatchCommands>("model_dynamics_manager/batch_commands", true);
+				}
+
+				bool isSent = batchClient.call(srv);
+
+				if (!isSent && !batchClient.isValid()) {
+					// the connection was dropped; reconnect & try once more
+					batchClient = rosNode.serviceClient<BatchCommands>("model_dynamics_manager/batch_commands", true);
+					isSent = batchClient.call(srv);
+				}
+
+				for (size_t i=0; i<results.size(); i++) {
+					results[i]->set_value(isSent && i < srv.response.success.size() && srv.response.success[i]);
+				}
+			}
+
+			// Returns the name of the group of the given units, creating it on first use ("" if that failed)
+			std::string groupFor(const std::string &type, const std::vector<uint32_t> &units)
+			{
+				std::vector<uint32_t> key(units);
+				std::sort(key.begin(), key.end());
+				key.erase(std::unique(key.begin(), key.end()), key.end());
+
+				boost::mutex::scoped_lock lock(groupsMutex);
+
+				std::map<std::pair<std::string, std::vector<uint32_t> >, std::string>::iterator it = unitGroups.find(std::make_pair(type, key));
+
+				if (it != unitGroups.end()) {
+					return it->second;
+				}
+
+				std::ostringstream name;
+				name << ros::this_node::getName() << "/" << this << "/" << type << "_" << unitGroups.size();
+
+				if (!addGroupClient.isValid()) {
+					addGroupClient = rosNode.serviceClient<AddGroup>("model_dynamics_manager/add_control_group", true);
+					deleteGroupClient = rosNode.serviceClient<DeleteGroup>("model_dynamics_manager/delete_control_group", true);
+				}
+
+				AddGroup srv;
+				srv.request.group.group_name = name.str();
+				srv.request.group.type = type;
+				srv.request.group.active_units = key;
+
+				if (!addGroupClient.call(srv)) {
+					ROS_ERROR("Async Dynamics Client: could not create a group for %zu %s units", key.size(), type.c_str());
+					return ""; // the commands will fail
+				}
+
+				unitGroups[std::make_pair(type, key)] = name.str();
+
+				return name.str();
+			}
+	};
+}
+
+#endif
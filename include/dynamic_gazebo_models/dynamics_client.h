@@ -0,0 +1,93 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_DYNAMICS_CLIENT_H
+#define DYNAMIC_GAZEBO_MODELS_DYNAMICS_CLIENT_H
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+
+#include <dynamic_gazebo_models/ListGroups.h>
+
+/*
+
+Client of the model dynamics manager:
+	Typed helpers over the manager's services, e.g.
+
+		dynamic_gazebo_models::DynamicsClient client;
+		client.addGroup("lobby", "door", units);
+		client.openDoors("lobby");
+
+	Every service is reached through a persistent connection, so a call doesn't pay for a new TCP connection & header
+	handshake. A dropped connection is re-established and the call retried once. Calls on the same service are
+	serialized (a connection carries one call at a time); use one client per thread for parallel calls.
+	All helpers return false if the manager couldn't be reached or rejected the call.
+
+*/
+
+namespace dynamic_gazebo_models
+{
+	class DynamicsClient
+	{
+		private:
+
+			struct Connection
+			{
+				std::string service;
+				ros::ServiceClient client;
+				boost::mutex mutex;
+			};
+
+			ros::NodeHandle rosNode;
+			Connection addGroupConn, deleteGroupConn, listGroupsConn, addUnitsConn, removeUnitsConn;
+			Connection openCloseDoorsConn, setVelDoorsConn, setDoorOpeningConn, targetFloorConn, setElevPropsConn, openCloseElevConn;
+
+			template <class S>
+			bool call(Connection &conn, S &srv);
+
+		public:
+
+			DynamicsClient(const ros::NodeHandle &nh = ros::NodeHandle(""));
+
+			// Groups:
+			bool addGroup(const std::string &group_name, const std::string &type, const std::vector<uint32_t> &units);
+			bool deleteGroup(const std::string &group_name);
+			bool addUnits(const std::string &group_name, const std::vector<uint32_t> &units);
+			bool removeUnits(const std::string &group_name, const std::vector<uint32_t> &units);
+			bool listGroups(const ListGroups::Request &req, ListGroups::Response &res);
+
+			// Doors:
+			bool openDoors(const std::string &group_name);
+			bool closeDoors(const std::string &group_name);
+			bool setDoorVel(const std::string &group_name, float linear, float angular);
+			bool setDoorOpening(const std::string &group_name, float opening, float slideSpeed = 0, float flipSpeed = 0); // 0: closed ... 1: open
+
+			// Elevators:
+			bool gotoFloor(const std::string &group_name, int floor);
+			bool openElevDoors(const std::string &group_name);
+			bool closeElevDoors(const std::string &group_name);
+			bool setElevProps(const std::string &group_name, float velocity, float force);
+	};
+}
+
+#endif
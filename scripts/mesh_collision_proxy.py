@@ -0,0 +1,309 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2014 Mohit Shridhar, David Lee
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""
+Compound-box collision proxy for a (closed) COLLADA mesh:
+    The solid is sampled on a rectilinear grid - the planes through the mesh vertices, subdivided so that no cell is
+    larger than --resolution - and the solid cells are greedily merged into boxes. Axis-aligned meshes (like the
+    elevator car) come out exact, in a handful of boxes; anything else is approximated to within one cell.
+
+    ODE collides boxes analytically, so robots riding the car no longer go through trimesh contact generation.
+
+    $ rosrun dynamic_gazebo_models mesh_collision_proxy.py media/meshes/elevator.dae                  # print the <collision> elements
+    $ rosrun dynamic_gazebo_models mesh_collision_proxy.py media/meshes/elevator.dae --sdf models/elevator.sdf   # update the model
+
+    With --sdf, the elements between the 'collision proxy' marker comments of the model are replaced.
+"""
+
+import argparse
+import math
+import re
+import sys
+import xml.etree.ElementTree as ET
+
+COLLADA_NS = '{http://www.collada.org/2005/11/COLLADASchema}'
+
+PROXY_BEGIN = '<!-- collision proxy: generated by scripts/mesh_collision_proxy.py -->'
+PROXY_END = '<!-- end of collision proxy -->'
+
+DEFAULT_RESOLUTION = 0.1 # in m; largest cell of the sampling grid
+RAY_DIRECTION = (1.0, 1.4142135e-3, 1.7320508e-3) # slightly skewed, so rays don't run along triangle edges
+PLANE_TOLERANCE = 1e-6 # in m; vertex coordinates closer than this are one grid plane
+
+
+def mat_mul(a, b):
+    return [[sum(a[i][k] * b[k][j] for k in range(4)) for j in range(4)] for i in range(4)]
+
+
+def identity():
+    return [[1.0 if i == j else 0.0 for j in range(4)] for i in range(4)]
+
+
+def transform_point(m, p):
+    return tuple(m[i][0] * p[0] + m[i][1] * p[1] + m[i][2] * p[2] + m[i][3] for i in range(3))
+
+
+def node_transform(node):
+    """Local transform of a visual scene node (only <matrix>, <translate> & <scale> are used by our exporters)"""
+    m = identity()
+
+    for child in node:
+        tag = child.tag.replace(COLLADA_NS, '')
+        values = [float(v) for v in child.text.split()] if child.text else []
+
+        if tag == 'matrix':
+            m = mat_mul(m, [values[0:4], values[4:8], values[8:12], values[12:16]])
+        elif tag == 'translate':
+            t = identity()
+            t[0][3], t[1][3], t[2][3] = values
+            m = mat_mul(m, t)
+        elif tag == 'scale':
+            s = identity()
+            s[0][0], s[1][1], s[2][2] = values
+            m = mat_mul(m, s)
+
+    return m
+
+
+def load_geometry(root, geometry_id):
+    """Vertex positions & triangles of a <geometry> (triangles & polylists)"""
+    geometry = root.find('.//%sgeometry[@id="%s"]' % (COLLADA_NS, geometry_id))
+    mesh = geometry.find(COLLADA_NS + 'mesh')
+
+    vertices = mesh.find(COLLADA_NS + 'vertices')
+    position_src = vertices.find(COLLADA_NS + 'input[@semantic="POSITION"]').get('source')[1:]
+    array = mesh.find('.//%ssource[@id="%s"]/%sfloat_array' % (COLLADA_NS, position_src, COLLADA_NS))
+    values = [float(v) for v in array.text.split()]
+    positions = [tuple(values[i:i + 3]) for i in range(0, len(values), 3)]
+
+    triangles = []
+
+    for prim in list(mesh.findall(COLLADA_NS + 'polylist')) + list(mesh.findall(COLLADA_NS + 'triangles')):
+        inputs = prim.findall(COLLADA_NS + 'input')
+        stride = max(int(i.get('offset')) for i in inputs) + 1
+        vertex_offset = [int(i.get('offset')) for i in inputs if i.get('semantic') == 'VERTEX'][0]
+        indices = [int(v) for v in prim.find(COLLADA_NS + 'p').text.split()]
+
+        vcount_elem = prim.find(COLLADA_NS + 'vcount')
+        counts = [int(v) for v in vcount_elem.text.split()] if vcount_elem is not None else [3] * int(prim.get('count'))
+
+        pos = 0
+        for count in counts:
+            polygon = [indices[(pos + k) * stride + vertex_offset] for k in range(count)]
+            pos += count
+
+            for k in range(1, count - 1): # fan triangulation
+                triangles.append((polygon[0], polygon[k], polygon[k + 1]))
+
+    return positions, triangles
+
+
+def load_mesh(path):
+    """All triangles of the visual scene, in metres (the <unit> scale applied like Gazebo does)"""
+    root = ET.parse(path).getroot()
+
+    unit = root.find('.//%sasset/%sunit' % (COLLADA_NS, COLLADA_NS))
+    meter = float(unit.get('meter')) if unit is not None else 1.0
+
+    triangles = []
+
+    def visit(node, parent_transform):
+        transform = mat_mul(parent_transform, node_transform(node))
+
+        for instance in node.findall(COLLADA_NS + 'instance_geometry'):
+            positions, indices = load_geometry(root, instance.get('url')[1:])
+            world = [tuple(meter * c for c in transform_point(transform, p)) for p in positions]
+            triangles.extend((world[a], world[b], world[c]) for a, b, c in indices)
+
+        for child in node.findall(COLLADA_NS + 'node'):
+            visit(child, transform)
+
+    for scene in root.findall('.//%svisual_scene' % COLLADA_NS):
+        for node in scene.findall(COLLADA_NS + 'node'):
+            visit(node, identity())
+
+    return triangles
+
+
+def ray_hits(origin, tri):
+    """Moller-Trumbore; true if the ray from origin along RAY_DIRECTION crosses the triangle"""
+    d = RAY_DIRECTION
+    v0, v1, v2 = tri
+    e1 = [v1[i] - v0[i] for i in range(3)]
+    e2 = [v2[i] - v0[i] for i in range(3)]
+
+    p = [d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]]
+    det = sum(e1[i] * p[i] for i in range(3))
+
+    if abs(det) < 1e-12:
+        return False
+
+    t_vec = [origin[i] - v0[i] for i in range(3)]
+    u = sum(t_vec[i] * p[i] for i in range(3)) / det
+
+    if u < 0.0 or u > 1.0:
+        return False
+
+    q = [t_vec[1] * e1[2] - t_vec[2] * e1[1], t_vec[2] * e1[0] - t_vec[0] * e1[2], t_vec[0] * e1[1] - t_vec[1] * e1[0]]
+    v = sum(d[i] * q[i] for i in range(3)) / det
+
+    if v < 0.0 or u + v > 1.0:
+        return False
+
+    return sum(e2[i] * q[i] for i in range(3)) / det > 0.0
+
+
+def is_inside(point, triangles):
+    return sum(1 for tri in triangles if ray_hits(point, tri)) % 2 == 1
+
+
+def grid_planes(coords, resolution):
+    """Sorted vertex coordinates (merged within PLANE_TOLERANCE), subdivided down to the resolution"""
+    unique = []
+    for c in sorted(coords):
+        if not unique or c - unique[-1] > PLANE_TOLERANCE:
+            unique.append(c)
+
+    planes = [unique[0]]
+    for c in unique[1:]:
+        steps = max(1, int(math.ceil((c - planes[-1]) / resolution - PLANE_TOLERANCE))) if resolution > 0 else 1
+        start = planes[-1]
+        planes.extend(start + (c - start) * k / steps for k in range(1, steps + 1))
+
+    return planes
+
+
+def merge_cells(solid, nx, ny, nz):
+    """Greedy merge of solid cells: grow along x, then y, then z; returns (x0, x1, y0, y1, z0, z1) cell ranges"""
+    used = set()
+    boxes = []
+
+    def free(i, j, k):
+        return (i, j, k) in solid and (i, j, k) not in used
+
+    for k in range(nz):
+        for j in range(ny):
+            for i in range(nx):
+                if not free(i, j, k):
+                    continue
+
+                i1 = i + 1
+                while i1 < nx and free(i1, j, k):
+                    i1 += 1
+
+                j1 = j + 1
+                while j1 < ny and all(free(a, j1, k) for a in range(i, i1)):
+                    j1 += 1
+
+                k1 = k + 1
+                while k1 < nz and all(free(a, b, k1) for a in range(i, i1) for b in range(j, j1)):
+                    k1 += 1
+
+                for c in range(k, k1):
+                    for b in range(j, j1):
+                        for a in range(i, i1):
+                            used.add((a, b, c))
+
+                boxes.append((i, i1, j, j1, k, k1))
+
+    return boxes
+
+
+def compute_proxy(triangles, resolution):
+    xs = grid_planes([v[0] for tri in triangles for v in tri], resolution)
+    ys = grid_planes([v[1] for tri in triangles for v in tri], resolution)
+    zs = grid_planes([v[2] for tri in triangles for v in tri], resolution)
+
+    solid = set()
+    for k in range(len(zs) - 1):
+        for j in range(len(ys) - 1):
+            for i in range(len(xs) - 1):
+                center = ((xs[i] + xs[i + 1]) / 2, (ys[j] + ys[j + 1]) / 2, (zs[k] + zs[k + 1]) / 2)
+                if is_inside(center, triangles):
+                    solid.add((i, j, k))
+
+    boxes = []
+    for i0, i1, j0, j1, k0, k1 in merge_cells(solid, len(xs) - 1, len(ys) - 1, len(zs) - 1):
+        center = ((xs[i0] + xs[i1]) / 2, (ys[j0] + ys[j1]) / 2, (zs[k0] + zs[k1]) / 2)
+        size = (xs[i1] - xs[i0], ys[j1] - ys[j0], zs[k1] - zs[k0])
+        boxes.append((center, size))
+
+    return boxes
+
+
+def proxy_sdf(boxes, indent):
+    pad = ' ' * indent
+    lines = [pad + PROXY_BEGIN]
+
+    for n, (center, size) in enumerate(boxes):
+        lines.append(pad + '<collision name="collision_%d">' % n)
+        lines.append(pad + '  <pose>%.6f %.6f %.6f 0 0 0</pose>' % center)
+        lines.append(pad + '  <geometry>')
+        lines.append(pad + '    <box>')
+        lines.append(pad + '      <size>%.6f %.6f %.6f</size>' % size)
+        lines.append(pad + '    </box>')
+        lines.append(pad + '  </geometry>')
+        lines.append(pad + '</collision>')
+
+    lines.append(pad + PROXY_END)
+    return '\n'.join(lines)
+
+
+def update_sdf(path, boxes):
+    with open(path) as f:
+        sdf = f.read()
+
+    pattern = re.compile(r'( *)' + re.escape(PROXY_BEGIN) + r'.*?' + re.escape(PROXY_END), re.S)
+    match = pattern.search(sdf)
+
+    if match is None:
+        sys.exit("%s has no '%s' ... '%s' section to replace" % (path, PROXY_BEGIN, PROXY_END))
+
+    sdf = sdf[:match.start()] + proxy_sdf(boxes, len(match.group(1))) + sdf[match.end():]
+
+    with open(path, 'w') as f:
+        f.write(sdf)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generates a compound-box collision proxy for a closed COLLADA mesh')
+    parser.add_argument('mesh', help='COLLADA (.dae) file')
+    parser.add_argument('--sdf', help='model whose collision proxy section is replaced (default: print the elements)')
+    parser.add_argument('--resolution', type=float, default=DEFAULT_RESOLUTION, help='largest grid cell in m (default: %(default)s; 0: vertex planes only)')
+    args = parser.parse_args()
+
+    triangles = load_mesh(args.mesh)
+
+    if not triangles:
+        sys.exit('%s has no triangles' % args.mesh)
+
+    boxes = compute_proxy(triangles, args.resolution)
+    sys.stderr.write('%d triangles -> %d boxes\n' % (len(triangles), len(boxes)))
+
+    if args.sdf:
+        update_sdf(args.sdf, boxes)
+    else:
+        print(proxy_sdf(boxes, 0))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,638 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <new>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/program_options.hpp>
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <std_msgs/Int32.h>
+#include <std_msgs/UInt32MultiArray.h>
+#include <dynamic_gazebo_models/ActiveUnits.h>
+
+#include "../plugins/lod_scheduler.h"
+
+#define AUDIT_DOOR_PREFIX "door_" // the domain space of the door models
+#define AUDIT_ROBOT_PREFIX "allocation_audit_robot_"
+#define AUDIT_AUTO_DOOR_PREFIX "allocation_audit_auto_door_"
+#define DOOR_SPACING 3.0 // in m, between the doors of the grid
+#define ROBOT_OFFSET 1.0 // in m, from the door a robot stands next to; the next door in the row is at the edge of its context space
+#define ROBOT_SWAY 0.2 // in m; robots sway around their spot, within the LOD hysteresis, so the classes stay put
+#define ROBOT_SWAY_PERIOD 500 // in world iterations
+#define SHAFT_X -20.0 // in m; away from the doors & robots
+#define SHAFT_Y -20.0
+#define AUTO_DOOR_SPACING 2.0 // in m, between the auto doors, so they don't touch each other
+#define COMMAND_PERIOD 100 // in world iterations; the target floor is sent again until the car sets off
+#define DEPARTURE_TIMEOUT 30000 // in world iterations
+#define DEPARTURE_DISTANCE 0.05 // in m; the car has set off once it's this far from where it stood
+#define DEFAULT_ELEVATOR "elevator_1" // the elevator the auto doors in models/ belong to
+#define DEFAULT_UNIT 1
+#define DEFAULT_FLOOR 6 // the top floor of models/elevator.sdf; the ride outlasts the audit
+
+/*
+
+Allocation audit of the plugin updates:
+	Loads the door, elevator & auto door plugins into an in-process Gazebo server (on an empty world) and counts the
+	heap allocations of their per-step work, for --ticks world iterations after --warmup iterations. Gazebo calls the
+	callbacks of an event in the order they were connected, so the audit brackets the plugins' WorldUpdateBegin
+	callbacks (their OnUpdate) and WorldUpdateEnd callbacks (the slide clamp batch and the door state board) with its
+	own: a counting operator new only counts between the brackets, on the world thread. The physics step and moving
+	the robots aren't counted.
+
+	The world:
+		--doors slide doors (--door-model) in a grid, with LOD, auto open & obstruction detection
+		--robots robots (static, without collisions) next to every few doors; they sway, so the next door in the row
+			keeps opening & closing for them while the LOD classes stay put
+		an elevator (--elevator-model) with LOD & one of the robots as payload model, sent to --floor
+		its auto doors (--auto-door-model) at its starting level, which close as it departs
+	so each tick runs the tuning check, robot tracking & LOD classification, the door proximity, opening control,
+	obstruction & state reports, the elevator drive, payload & floor estimate, and the auto doors' slide constraint.
+
+	Sending a message allocates in roscpp (it's serialized into a new buffer), and so does receiving one. The ticks in
+	which a plugin sends one (LOD counters, estimated floor; the audit listens to tell) and the ticks after them (when
+	the auto doors receive the floor) are reported apart and don't fail the audit. No one subscribes to the door states,
+	so the state board has nothing to send. Any other allocation fails it.
+
+	The plugin libraries must be on GAZEBO_PLUGIN_PATH (source the workspace), and a ROS master must run, without a
+	dynamics manager or other simulation on it: the audit activates the elevator itself.
+
+*/
+
+namespace po = boost::program_options;
+using namespace gazebo;
+
+static __thread bool isAuditing = false;
+static bool isCounting = false; // the brackets only count while the audit loop sets this
+static uint64_t numAllocations = 0; // only counted on the auditing thread
+
+void* operator new(size_t size)
+{
+	if (isAuditing) {
+		numAllocations++;
+	}
+
+	void *ptr = malloc(size == 0 ? 1 : size);
+
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw()
+{
+	if (isAuditing) {
+		numAllocations++;
+	}
+
+	return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t &tag) throw()
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void *ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) throw()
+{
+	free(ptr);
+}
+
+static void openBracket()
+{
+	isAuditing = isCounting;
+}
+
+static void closeBracket()
+{
+	isAuditing = false;
+}
+
+// Counts the messages the plugins send on the topics that may allocate; on a queue of its own, so the plugins'
+// ros::spinOnce doesn't run the callbacks inside the brackets
+class SendWatch
+{
+	private:
+
+		ros::CallbackQueue queue;
+		std::vector<ros::Subscriber> subs;
+		uint64_t numReceived;
+
+	public:
+
+		SendWatch() : numReceived(0) {}
+
+		void init(const std::string &elevatorName)
+		{
+			ros::NodeHandle nh;
+			nh.setCallbackQueue(&queue);
+
+			const char *unitTypes[] = {"door", "elevator", "auto_door"};
+
+			for (int i=0; i<3; i++) {
+				subs.push_back(nh.subscribe<std_msgs::UInt32MultiArray>(std::string("/model_dynamics_manager/lod/") + unitTypes[i], 10, &SendWatch::lod_cb, this));
+			}
+
+			subs.push_back(nh.subscribe<std_msgs::Int32>("/elevator_controller/" + elevatorName + "/estimated_current_floor", 10, &SendWatch::floor_cb, this));
+		}
+
+		// Returns the number of messages sent since the last call
+		uint64_t collect()
+		{
+			numReceived = 0;
+			queue.callAvailable();
+
+			return numReceived;
+		}
+
+	private:
+
+		void lod_cb(const std_msgs::UInt32MultiArray::ConstPtr &counts)
+		{
+			numReceived++;
+		}
+
+		void floor_cb(const std_msgs::Int32::ConstPtr &floor)
+		{
+			numReceived++;
+		}
+};
+
+static bool readFile(const std::string &path, std::string &content)
+{
+	std::ifstream file(path.c_str());
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+
+	content = buffer.str();
+
+	if (!file || content.empty()) {
+		std::cerr << "Couldn't read " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// The model of an SDF file renamed, moved by offset, and with extra elements in its plugin reference; empty on failure
+static std::string placeModel(const std::string &modelXml, const std::string &name, const math::Vector3 &offset, const std::string &pluginElements)
+{
+	std::string xml = modelXml;
+
+	size_t model = xml.find("<model");
+	size_t nameStart = model == std::string::npos ? model : xml.find("name=", model);
+
+	if (nameStart == std::string::npos || nameStart + 5 >= xml.size()) {
+		return "";
+	}
+
+	nameStart += 5;
+	size_t nameEnd = xml.find(xml[nameStart], nameStart + 1); // the closing quote
+
+	if (nameEnd == std::string::npos) {
+		return "";
+	}
+
+	xml.replace(nameStart + 1, nameEnd - nameStart - 1, name);
+
+	// a pose right at the top of the model is moved; otherwise, the offset becomes its pose
+	size_t tagEnd = xml.find('>', model);
+	size_t firstChild = xml.find_first_not_of(" \t\r\n", tagEnd + 1);
+	math::Pose pose;
+
+	if (firstChild != std::string::npos && xml.compare(firstChild, 6, "<pose>") == 0) {
+		size_t poseEnd = xml.find("</pose>", firstChild);
+		std::istringstream values(xml.substr(firstChild + 6, poseEnd - firstChild - 6));
+		double x, y, z, roll, pitch, yaw;
+
+		if (poseEnd == std::string::npos || !(values >> x >> y >> z >> roll >> pitch >> yaw)) {
+			return "";
+		}
+
+		pose.Set(x, y, z, roll, pitch, yaw);
+		xml.erase(firstChild, poseEnd + 7 - firstChild);
+	}
+
+	math::Vector3 rpy = pose.rot.GetAsEuler();
+	std::ostringstream poseTag;
+	poseTag << "<pose>" << pose.pos.x + offset.x << " " << pose.pos.y + offset.y << " " << pose.pos.z + offset.z << " " << rpy.x << " " << rpy.y << " " << rpy.z << "</pose>";
+	xml.insert(tagEnd + 1, poseTag.str());
+
+	size_t pluginEnd = xml.find("</plugin>");
+
+	if (pluginEnd == std::string::npos) {
+		return "";
+	}
+
+	xml.insert(pluginEnd, pluginElements);
+	return xml;
+}
+
+// Runs the world until all the models are there; false if some of them don't show up
+static bool waitForModels(physics::WorldPtr world, const std::vector<std::string> &names)
+{
+	for (int i=0; i<100; i++) {
+		runWorld(world, 1);
+
+		size_t numLoaded = 0;
+		for (size_t j=0; j<names.size(); j++) {
+			numLoaded += world->GetModel(names[j]) ? 1 : 0;
+		}
+
+		if (numLoaded == names.size()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+class UpdateAudit
+{
+	private:
+
+		physics::WorldPtr world;
+		physics::LinkPtr carBody;
+		std::vector<physics::ModelPtr> robots;
+		std::vector<math::Pose> robotSpots;
+		std::vector<std::string> robotNames;
+		std::string robotNameList; // comma-separated, for the plugin references
+
+		event::ConnectionPtr beginOpening, endOpening, beginClosing, endClosing;
+
+	public:
+
+		// Before any plugin is loaded, so the brackets open ahead of the plugin callbacks
+		UpdateAudit(physics::WorldPtr world, int numRobots) : world(world)
+		{
+			beginOpening = event::Events::ConnectWorldUpdateBegin(boost::bind(&openBracket));
+			endOpening = event::Events::ConnectWorldUpdateEnd(boost::bind(&openBracket));
+
+			for (int i=0; i<numRobots; i++) {
+				std::ostringstream name;
+				name << AUDIT_ROBOT_PREFIX << i;
+				robotNames.push_back(name.str());
+				robotNameList += (i > 0 ? "," : "") + name.str();
+			}
+		}
+
+		// After all plugins are loaded, so the brackets close behind the plugin callbacks
+		void closeBrackets()
+		{
+			beginClosing = event::Events::ConnectWorldUpdateBegin(boost::bind(&closeBracket));
+			endClosing = event::Events::ConnectWorldUpdateEnd(boost::bind(&closeBracket));
+		}
+
+		bool spawnDoors(const std::string &doorXml, size_t numDoors)
+		{
+			std::string elements = "<lod>true</lod><auto_open>true</auto_open><bot_model_names>" + robotNameList + "</bot_model_names>";
+			size_t columns = std::max<size_t>(1, static_cast<size_t>(sqrt(numDoors)));
+			std::vector<std::string> names;
+
+			for (size_t i=0; i<numDoors; i++) {
+				std::ostringstream name;
+				name << AUDIT_DOOR_PREFIX << i;
+				names.push_back(name.str());
+
+				if (!insertModel(doorXml, name.str(), math::Vector3((i % columns) * DOOR_SPACING, (i / columns) * DOOR_SPACING, 0), elements)) {
+					return false;
+				}
+			}
+
+			return awaitModels(names);
+		}
+
+		// Robots stand next to every few doors, so the grid holds near, mid & far units
+		bool spawnRobots(size_t numDoors)
+		{
+			for (size_t i=0; i<robotNames.size(); i++) {
+				std::ostringstream doorName;
+				doorName << AUDIT_DOOR_PREFIX << (i * numDoors) / robotNames.size();
+
+				physics::ModelPtr door = world->GetModel(doorName.str());
+
+				if (!door || door->GetLinks().empty()) {
+					std::cerr << "Door " << doorName.str() << " has no link" << std::endl;
+					return false;
+				}
+
+				math::Vector3 spot = door->GetLinks()[0]->GetWorldPose().pos + math::Vector3(ROBOT_OFFSET, 0, 0);
+				robotSpots.push_back(math::Pose(spot.x, spot.y, 0.5, 0, 0, 0));
+
+				// no collision, so it doesn't obstruct the doors it passes
+				std::ostringstream sdf;
+				sdf << "<sdf version='1.4'><model name='" << robotNames[i] << "'><static>true</static>"
+					<< "<pose>" << spot.x << " " << spot.y << " 0.5 0 0 0</pose><link name='body'/></model></sdf>";
+
+				world->InsertModelString(sdf.str());
+			}
+
+			if (!awaitModels(robotNames)) {
+				return false;
+			}
+
+			for (size_t i=0; i<robotNames.size(); i++) {
+				robots.push_back(world->GetModel(robotNames[i]));
+			}
+
+			return true;
+		}
+
+		// Away from the doors, carrying robot 0 as its payload model
+		bool spawnElevator(const std::string &elevatorXml, const std::string &elevatorName)
+		{
+			std::string elements = "<lod>true</lod><bot_model_names>" + robotNameList + "</bot_model_names><payload_models>" + robotNames[0] + "</payload_models>";
+
+			if (!insertModel(elevatorXml, elevatorName, math::Vector3(SHAFT_X, SHAFT_Y, 0), elements) || !awaitModels(std::vector<std::string>(1, elevatorName))) {
+				return false;
+			}
+
+			carBody = world->GetModel(elevatorName)->GetLink("body");
+
+			if (!carBody) {
+				std::cerr << "The elevator model has no 'body' link" << std::endl;
+				return false;
+			}
+
+			return true;
+		}
+
+		bool spawnAutoDoors(const std::vector<std::string> &autoDoorXmls, int unit)
+		{
+			std::ostringstream elements;
+			elements << "<lod>true</lod><bot_model_names>" << robotNameList << "</bot_model_names><unit_id>" << unit << "</unit_id>";
+
+			std::vector<std::string> names;
+
+			for (size_t i=0; i<autoDoorXmls.size(); i++) {
+				std::ostringstream name;
+				name << AUDIT_AUTO_DOOR_PREFIX << i;
+				names.push_back(name.str());
+
+				if (!insertModel(autoDoorXmls[i], name.str(), math::Vector3(SHAFT_X, SHAFT_Y + (i + 1) * AUTO_DOOR_SPACING, 0), elements.str())) {
+					return false;
+				}
+			}
+
+			return awaitModels(names);
+		}
+
+		float getCarHeight()
+		{
+			return carBody->GetWorldPose().pos.z;
+		}
+
+		// Moves the robots and steps the world; only the plugin callbacks are audited
+		void step(uint64_t tick)
+		{
+			for (size_t i=0; i<robots.size(); i++) {
+				math::Pose pose = robotSpots[i];
+				pose.pos.x += ROBOT_SWAY * sin(2 * M_PI * tick / ROBOT_SWAY_PERIOD + i);
+				robots[i]->SetWorldPose(pose);
+			}
+
+			runWorld(world, 1);
+		}
+
+	private:
+
+		bool insertModel(const std::string &modelXml, const std::string &name, const math::Vector3 &offset, const std::string &pluginElements)
+		{
+			std::string xml = placeModel(modelXml, name, offset, pluginElements);
+
+			if (xml.empty()) {
+				std::cerr << "Couldn't place " << name << ": the model file has no <model> or <plugin>, or a malformed model pose" << std::endl;
+				return false;
+			}
+
+			world->InsertModelString(xml);
+			return true;
+		}
+
+		bool awaitModels(const std::vector<std::string> &names)
+		{
+			if (waitForModels(world, names)) {
+				return true;
+			}
+
+			std::cerr << "Couldn't spawn " << names.front() << " (and " << names.size() - 1 << " more)" << std::endl;
+			return false;
+		}
+};
+
+static bool readFiles(const std::vector<std::string> &paths, std::vector<std::string> &xmls)
+{
+	xmls.resize(paths.size());
+
+	for (size_t i=0; i<paths.size(); i++) {
+		if (!readFile(paths[i], xmls[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "allocation_audit", ros::init_options::AnonymousName); // takes out the ROS arguments first
+
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("door-model", po::value<std::string>()->required(), "SDF file of the slide door")
+		("elevator-model", po::value<std::string>()->required(), "SDF file of the elevator")
+		("auto-door-model", po::value<std::vector<std::string> >()->multitoken()->required(), "SDF files of the elevator's auto doors")
+		("elevator,e", po::value<std::string>()->default_value(DEFAULT_ELEVATOR), "elevator model name; the <elevator_name> of the auto doors")
+		("unit,u", po::value<int>()->default_value(DEFAULT_UNIT), "unit id of the elevator & its auto doors")
+		("floor,f", po::value<int>()->default_value(DEFAULT_FLOOR), "floor the elevator is sent to")
+		("ticks,t", po::value<uint64_t>()->default_value(10000), "audited world iterations")
+		("warmup,w", po::value<uint64_t>()->default_value(2 * LOD_REPORT_PERIOD), "world iterations before the audit starts, at least until the car sets off")
+		("doors,d", po::value<size_t>()->default_value(1000), "number of doors")
+		("robots,r", po::value<int>()->default_value(4), "number of robots");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+
+		if (args.count("help")) {
+			std::cout << options << std::endl;
+			return EXIT_SUCCESS;
+		}
+
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t numDoors = args["doors"].as<size_t>();
+	int numRobots = args["robots"].as<int>();
+
+	if (numDoors == 0 || numRobots < 1) {
+		std::cerr << "--doors and --robots must be at least 1" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string doorXml, elevatorXml;
+	std::vector<std::string> autoDoorXmls;
+
+	if (!readFile(args["door-model"].as<std::string>(), doorXml) || !readFile(args["elevator-model"].as<std::string>(), elevatorXml)
+			|| !readFiles(args["auto-door-model"].as<std::vector<std::string> >(), autoDoorXmls)) {
+		return EXIT_FAILURE;
+	}
+
+	std::string elevatorName = args["elevator"].as<std::string>();
+	int unit = args["unit"].as<int>();
+
+	ros::NodeHandle nh;
+
+	// latched, so the elevator gets it whenever its registry subscribes
+	ros::Publisher active_pub = nh.advertise<dynamic_gazebo_models::ActiveUnits>("/elevator_controller/active", 1, true);
+	ros::Publisher target_floor_pub = nh.advertise<std_msgs::Int32>("/elevator_controller/target_floor", 1);
+
+	dynamic_gazebo_models::ActiveUnits activeUnits;
+	activeUnits.seq = static_cast<uint32_t>(ros::WallTime::now().toNSec() / 1000000); // newer than what an earlier run left latched
+	activeUnits.units.push_back(unit);
+	active_pub.publish(activeUnits);
+
+	SendWatch watch;
+	watch.init(elevatorName);
+
+	if (!setupServer()) {
+		std::cerr << "Couldn't start the Gazebo server" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	physics::WorldPtr world = loadWorld("worlds/empty.world");
+
+	if (!world) {
+		std::cerr << "Couldn't load worlds/empty.world" << std::endl;
+		shutdown();
+		return EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+
+	{
+		UpdateAudit audit(world, numRobots);
+
+		if (!audit.spawnDoors(doorXml, numDoors) || !audit.spawnRobots(numDoors) || !audit.spawnElevator(elevatorXml, elevatorName)
+				|| !audit.spawnAutoDoors(autoDoorXmls, unit)) {
+			result = EXIT_FAILURE;
+		}
+
+		audit.closeBrackets();
+
+		uint64_t warmup = args["warmup"].as<uint64_t>(), ticks = args["ticks"].as<uint64_t>();
+		uint64_t auditStart = 0, sendingTicks = 0, sendingAllocations = 0, failingTicks = 0, firstFailingTick = 0;
+		bool isDeparted = false, hasSent = false;
+
+		std_msgs::Int32 targetFloor;
+		targetFloor.data = args["floor"].as<int>();
+		float startHeight = result == EXIT_SUCCESS ? audit.getCarHeight() : 0;
+
+		for (uint64_t tick=0; result == EXIT_SUCCESS && (!isCounting || tick - auditStart < ticks); tick++) {
+			// until the car sets off: the command allocates when the elevator receives it
+			if (!isDeparted) {
+				if (tick % COMMAND_PERIOD == 0) {
+					target_floor_pub.publish(targetFloor);
+				}
+
+				isDeparted = fabs(audit.getCarHeight() - startHeight) > DEPARTURE_DISTANCE;
+
+				if (!isDeparted && tick >= DEPARTURE_TIMEOUT) {
+					std::cerr << "The elevator didn't set off for floor " << targetFloor.data << " in " << DEPARTURE_TIMEOUT << " iterations" << std::endl;
+					result = EXIT_FAILURE;
+					break;
+				}
+			}
+
+			if (!isCounting && isDeparted && tick >= warmup) {
+				isCounting = true;
+				auditStart = tick;
+			}
+
+			uint64_t before = numAllocations;
+			audit.step(tick);
+
+			// roscpp hands in-process messages to the subscriber queue as they're published, so they're in by now
+			bool isSending = watch.collect() > 0;
+
+			if (isCounting && numAllocations != before) {
+				if (isSending || hasSent) {
+					sendingTicks++;
+					sendingAllocations += numAllocations - before;
+				} else {
+					firstFailingTick = failingTicks == 0 ? tick - auditStart : firstFailingTick;
+					failingTicks++;
+				}
+			}
+
+			hasSent = isSending;
+		}
+
+		if (result == EXIT_SUCCESS) {
+			printf("%lu ticks after %lu warm-up ticks: %lu allocations, %lu of them in %lu ticks that sent or received messages\n",
+				(unsigned long) ticks, (unsigned long) auditStart, (unsigned long) numAllocations, (unsigned long) sendingAllocations,
+				(unsigned long) sendingTicks);
+
+			if (failingTicks > 0) {
+				printf("FAILED: the plugin updates allocate in %lu other ticks, first in tick %lu\n", (unsigned long) failingTicks, (unsigned long) firstFailingTick);
+				result = EXIT_FAILURE;
+			}
+		}
+	}
+
+	shutdown();
+	return result;
+}
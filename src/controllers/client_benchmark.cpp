@@ -0,0 +1,151 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <algorithm>
+#include <boost/program_options.hpp>
+
+#include <ros/ros.h>
+
+#include <dynamic_gazebo_models/dynamics_client.h>
+#include <dynamic_gazebo_models/ListGroups.h>
+
+#define LIST_GROUPS_SERVICE "model_dynamics_manager/list_groups"
+#define BENCHMARK_PREFIX "client_benchmark_" // matches no group, so the manager does next to no work per call
+
+/*
+
+Client benchmark, against a running dynamics manager:
+	Calls list_groups --calls times through a new connection per call (ros::service::call, as keyboard_op used to), then
+	through the persistent connection of DynamicsClient, and reports the mean, median & 99th percentile latency of
+	each. The listing matches no group, so the latencies are mostly connection setup & round trip.
+
+*/
+
+namespace po = boost::program_options;
+
+struct LatencyStats
+{
+	double mean, median, p99; // in ms
+	size_t numFailed;
+};
+
+static LatencyStats summarize(std::vector<double> &latencies, size_t numFailed)
+{
+	LatencyStats stats = {0, 0, 0, numFailed};
+
+	if (latencies.empty()) {
+		return stats;
+	}
+
+	for (size_t i=0; i<latencies.size(); i++) {
+		stats.mean += latencies[i];
+	}
+
+	stats.mean /= latencies.size();
+
+	std::sort(latencies.begin(), latencies.end());
+	stats.median = latencies[latencies.size() / 2];
+	stats.p99 = latencies[std::min(latencies.size() - 1, static_cast<size_t>(0.99 * latencies.size()))];
+
+	return stats;
+}
+
+static void printStats(const char *name, const LatencyStats &stats)
+{
+	printf("%-12s %10.3f %10.3f %10.3f %8zu\n", name, stats.mean, stats.median, stats.p99, stats.numFailed);
+}
+
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "client_benchmark", ros::init_options::AnonymousName); // takes out the ROS arguments first
+
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("calls,c", po::value<size_t>()->default_value(1000), "calls per connection mode");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+
+		if (args.count("help")) {
+			std::cout << options << std::endl;
+			return EXIT_SUCCESS;
+		}
+
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t numCalls = args["calls"].as<size_t>();
+
+	ros::NodeHandle nh;
+
+	if (!ros::service::waitForService(LIST_GROUPS_SERVICE, ros::Duration(10))) {
+		std::cerr << "Couldn't reach the dynamics manager" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	dynamic_gazebo_models::ListGroups srv;
+	srv.request.prefix = BENCHMARK_PREFIX;
+	srv.request.max_results = 1;
+	srv.request.omit_units = true;
+
+	std::vector<double> latencies;
+	size_t numFailed = 0;
+
+	for (size_t i=0; i<numCalls && ros::ok(); i++) {
+		ros::WallTime start = ros::WallTime::now();
+		bool isSuccess = ros::service::call(LIST_GROUPS_SERVICE, srv);
+		latencies.push_back((ros::WallTime::now() - start).toSec() * 1000);
+		numFailed += isSuccess ? 0 : 1;
+	}
+
+	LatencyStats perCall = summarize(latencies, numFailed);
+
+	dynamic_gazebo_models::DynamicsClient client;
+	latencies.clear();
+	numFailed = 0;
+
+	for (size_t i=0; i<numCalls && ros::ok(); i++) {
+		ros::WallTime start = ros::WallTime::now();
+		bool isSuccess = client.listGroups(srv.request, srv.response);
+		latencies.push_back((ros::WallTime::now() - start).toSec() * 1000);
+		numFailed += isSuccess ? 0 : 1;
+	}
+
+	LatencyStats persistent = summarize(latencies, numFailed);
+
+	printf("connection    mean (ms)  p50 (ms)   p99 (ms)   failed\n");
+	printStats("per call", perCall);
+	printStats("persistent", persistent);
+
+	if (persistent.mean > 0) {
+		printf("\nthe persistent connection is %.1fx faster on average\n", perCall.mean / persistent.mean);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,319 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <boost/program_options.hpp>
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#define PROXY_BEGIN "<!-- collision proxy: generated by scripts/mesh_collision_proxy.py -->"
+#define PROXY_END "<!-- end of collision proxy -->"
+
+#define BENCHMARK_CAR "collision_benchmark_car"
+#define BENCHMARK_RIDER_PREFIX "collision_benchmark_rider_"
+#define RIDER_SIZE 0.3 // in m; riders are cubes
+#define RIDER_MASS 20.0 // in kg
+#define RIDER_SPACING 0.45 // in m, between the riders' centres
+#define RIDER_COLUMNS 5 // along the car's x axis
+#define RIDER_ROWS 3 // along its y axis; the car holds this many riders
+#define RIDER_DROP_HEIGHT 0.8 // in m, above the bottom of the car
+#define SETTLE_STEPS 2000 // physics steps for the riders to land & come to rest before the timing
+#define DEFAULT_RIDER_COUNTS {0, 1, 5, 10, 15}
+
+/*
+
+Collision benchmark of the elevator car, in-process on an empty world:
+	Times the physics step with 0, 1, ... riders standing in the car, once with the car colliding as its collision proxy
+	(the boxes that scripts/mesh_collision_proxy.py generates) and once as the mesh it replaces. The mesh variant is the
+	model with its marked proxy section swapped for one <collision> with the <mesh> of its visual.
+
+	The car is made static, without its joint & plugin, so only its collisions differ between the two: the riders (cubes)
+	rest on its floor, and each step runs their contacts with it. A rider that fell through the car (below its floor)
+	is reported, since its contacts would be missing from the timing.
+
+	The mesh is found like the world finds it: media/meshes must be on GAZEBO_RESOURCE_PATH.
+
+*/
+
+namespace po = boost::program_options;
+using namespace gazebo;
+
+typedef std::chrono::steady_clock Clock;
+
+struct StepResult
+{
+	double stepTime; // in ms
+	int numInCar; // riders still above the bottom of the car
+};
+
+static bool readFile(const std::string &path, std::string &content)
+{
+	std::ifstream file(path.c_str());
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+
+	content = buffer.str();
+
+	if (!file || content.empty()) {
+		std::cerr << "Couldn't read " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Cuts the first element with the given tag out of the xml (with its content); false if there's none
+static bool eraseElement(std::string &xml, const std::string &tag)
+{
+	size_t start = xml.find("<" + tag + " ");
+	start = start == std::string::npos ? xml.find("<" + tag + ">") : start;
+	size_t end = start == std::string::npos ? start : xml.find("</" + tag + ">", start);
+
+	if (end == std::string::npos) {
+		return false;
+	}
+
+	xml.erase(start, end + tag.size() + 3 - start);
+	return true;
+}
+
+// The car model renamed and made static, without its joints & plugins; with the mesh of its visual as its collision if
+// isMesh. Empty on failure
+static std::string carVariant(const std::string &modelXml, bool isMesh)
+{
+	std::string xml = modelXml;
+
+	size_t model = xml.find("<model");
+	size_t nameStart = model == std::string::npos ? model : xml.find("name=", model);
+
+	if (nameStart == std::string::npos) {
+		std::cerr << "The elevator file has no named <model>" << std::endl;
+		return "";
+	}
+
+	size_t nameEnd = xml.find(xml[nameStart + 5], nameStart + 6);
+	xml.replace(nameStart + 6, nameEnd - nameStart - 6, BENCHMARK_CAR);
+	xml.insert(xml.find('>', model) + 1, "<static>true</static>");
+
+	while (eraseElement(xml, "joint")) {}
+	while (eraseElement(xml, "plugin")) {}
+
+	if (!isMesh) {
+		return xml;
+	}
+
+	size_t proxyStart = xml.find(PROXY_BEGIN);
+	size_t proxyEnd = proxyStart == std::string::npos ? proxyStart : xml.find(PROXY_END, proxyStart);
+	size_t meshStart = proxyEnd == std::string::npos ? proxyEnd : xml.find("<mesh>", proxyEnd);
+	size_t meshEnd = meshStart == std::string::npos ? meshStart : xml.find("</mesh>", meshStart);
+
+	if (meshEnd == std::string::npos) {
+		std::cerr << "The elevator file has no marked collision proxy with a <mesh> visual after it" << std::endl;
+		return "";
+	}
+
+	std::string collision = "<collision name='collision'><geometry>" + xml.substr(meshStart, meshEnd + 7 - meshStart) + "</geometry></collision>";
+	xml.replace(proxyStart, proxyEnd + strlen(PROXY_END) - proxyStart, collision);
+
+	return xml;
+}
+
+static std::string riderSdf(const std::string &name, const math::Vector3 &pos)
+{
+	std::ostringstream sdf;
+	double inertia = RIDER_MASS * RIDER_SIZE * RIDER_SIZE / 6;
+
+	sdf << "<sdf version='1.4'><model name='" << name << "'><pose>" << pos.x << " " << pos.y << " " << pos.z << " 0 0 0</pose><link name='body'>"
+		<< "<inertial><mass>" << RIDER_MASS << "</mass><inertia><ixx>" << inertia << "</ixx><iyy>" << inertia << "</iyy><izz>" << inertia
+		<< "</izz><ixy>0</ixy><ixz>0</ixz><iyz>0</iyz></inertia></inertial>"
+		<< "<collision name='collision'><geometry><box><size>" << RIDER_SIZE << " " << RIDER_SIZE << " " << RIDER_SIZE << "</size></box></geometry></collision>"
+		<< "</link></model></sdf>";
+
+	return sdf.str();
+}
+
+// Runs the world until the models are there (or gone, if !isPresent); false if they don't get there
+static bool waitForModels(physics::WorldPtr world, const std::vector<std::string> &names, bool isPresent)
+{
+	for (int i=0; i<100; i++) {
+		runWorld(world, 1);
+
+		size_t numDone = 0;
+		for (size_t j=0; j<names.size(); j++) {
+			bool isThere = world->GetModel(names[j]) ? true : false;
+			numDone += isThere == isPresent ? 1 : 0;
+		}
+
+		if (numDone == names.size()) {
+			return true;
+		}
+	}
+
+	std::cerr << "Couldn't " << (isPresent ? "spawn " : "delete ") << names.front() << std::endl;
+	return false;
+}
+
+// Spawns the car & riders, lets the riders come to rest, and times the steps; the models are deleted again
+static bool timeSteps(physics::WorldPtr world, const std::string &carXml, int numRiders, int numSteps, StepResult &result)
+{
+	world->InsertModelString(carXml);
+
+	std::vector<std::string> names(1, BENCHMARK_CAR);
+
+	if (!waitForModels(world, names, true)) {
+		return false;
+	}
+
+	math::Box car = world->GetModel(BENCHMARK_CAR)->GetBoundingBox();
+	math::Vector3 centre = car.GetCenter();
+
+	for (int i=0; i<numRiders; i++) {
+		std::ostringstream name;
+		name << BENCHMARK_RIDER_PREFIX << i;
+		names.push_back(name.str());
+
+		math::Vector3 pos(centre.x + (i % RIDER_COLUMNS - (RIDER_COLUMNS - 1) / 2.0) * RIDER_SPACING,
+			centre.y + (i / RIDER_COLUMNS - (RIDER_ROWS - 1) / 2.0) * RIDER_SPACING, car.min.z + RIDER_DROP_HEIGHT);
+
+		world->InsertModelString(riderSdf(name.str(), pos));
+	}
+
+	bool isDone = waitForModels(world, names, true);
+
+	if (isDone) {
+		runWorld(world, SETTLE_STEPS);
+
+		Clock::time_point start = Clock::now();
+		runWorld(world, numSteps);
+		double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		result.stepTime = elapsed * 1000 / numSteps;
+		result.numInCar = 0;
+
+		for (size_t i=1; i<names.size(); i++) {
+			result.numInCar += world->GetModel(names[i])->GetWorldPose().pos.z > car.min.z ? 1 : 0;
+		}
+	}
+
+	for (size_t i=0; i<names.size(); i++) {
+		world->RemoveModel(names[i]);
+	}
+
+	return waitForModels(world, names, false) && isDone;
+}
+
+int main(int argc, char** argv)
+{
+	const int defaultRiderCounts[] = DEFAULT_RIDER_COUNTS;
+
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("elevator-model", po::value<std::string>()->required(), "SDF file of the elevator, with its collision proxy")
+		("riders,r", po::value<std::vector<int> >()->multitoken()->default_value(std::vector<int>(defaultRiderCounts, defaultRiderCounts + sizeof(defaultRiderCounts) / sizeof(int)), "0 1 5 10 15"),
+			"rider counts to time the steps with")
+		("steps,s", po::value<int>()->default_value(5000), "timed physics steps per rider count & variant");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+
+		if (args.count("help")) {
+			std::cout << options << std::endl;
+			return EXIT_SUCCESS;
+		}
+
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<int> riderCounts = args["riders"].as<std::vector<int> >();
+	int numSteps = args["steps"].as<int>();
+
+	for (size_t i=0; i<riderCounts.size(); i++) {
+		if (riderCounts[i] < 0 || riderCounts[i] > RIDER_COLUMNS * RIDER_ROWS) {
+			std::cerr << "--riders must be within [0, " << RIDER_COLUMNS * RIDER_ROWS << "]: that's what the car holds" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (numSteps < 1) {
+		std::cerr << "--steps must be at least 1" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string modelXml;
+
+	if (!readFile(args["elevator-model"].as<std::string>(), modelXml)) {
+		return EXIT_FAILURE;
+	}
+
+	std::string variants[2] = {carVariant(modelXml, false), carVariant(modelXml, true)};
+
+	if (variants[0].empty() || variants[1].empty()) {
+		return EXIT_FAILURE;
+	}
+
+	if (!setupServer()) {
+		std::cerr << "Couldn't start the Gazebo server" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	physics::WorldPtr world = loadWorld("worlds/empty.world");
+
+	if (!world) {
+		std::cerr << "Couldn't load worlds/empty.world" << std::endl;
+		shutdown();
+		return EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+
+	printf("riders   proxy step (ms)   mesh step (ms)   mesh / proxy   riders in the car (proxy / mesh)\n");
+
+	for (size_t i=0; i<riderCounts.size() && result == EXIT_SUCCESS; i++) {
+		StepResult steps[2];
+
+		for (int v=0; v<2 && result == EXIT_SUCCESS; v++) {
+			if (!timeSteps(world, variants[v], riderCounts[i], numSteps, steps[v])) {
+				result = EXIT_FAILURE;
+			}
+		}
+
+		if (result == EXIT_SUCCESS) {
+			printf("%6d %17.4f %16.4f %14.2f %18d / %d\n", riderCounts[i], steps[0].stepTime, steps[1].stepTime,
+				steps[0].stepTime > 0 ? steps[1].stepTime / steps[0].stepTime : 0.0, steps[0].numInCar, steps[1].numInCar);
+		}
+	}
+
+	shutdown();
+	return result;
+}
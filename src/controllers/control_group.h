@@ -18,6 +18,15 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#ifndef DYNAMIC_GAZEBO_MODELS_CONTROL_GROUP_H
+#define DYNAMIC_GAZEBO_MODELS_CONTROL_GROUP_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/unordered_set.hpp>
+
 enum GroupType {DOOR, ELEVATOR, INVALID};
 
 class ControlGroup
@@ -37,7 +46,7 @@ class ControlGroup
 			this->active_units = active_units;
 		}
 
-		std::string getGroupName()
+		const std::string& getGroupName() const
 		{
 			return this->group_name;
 		}
@@ -47,7 +56,7 @@ class ControlGroup
 			this->group_name = group_name;
 		}
 
-		GroupType getType()
+		GroupType getType() const
 		{
 			return this->type;
 		}
@@ -57,7 +66,7 @@ class ControlGroup
 			this->type = type;
 		}
 
-		std::vector<uint32_t> getActiveUnits()
+		const std::vector<uint32_t>& getActiveUnits() const
 		{
 			return this->active_units;
 		}
@@ -66,4 +75,37 @@ class ControlGroup
 		{
 			this->active_units = active_units;
 		}
-};
\ No newline at end of file
+
+		// 'added' receives the units that weren't in the group yet
+		void addUnits(const std::vector<uint32_t> &units, std::vector<uint32_t> &added)
+		{
+			boost::unordered_set<uint32_t> members(active_units.begin(), active_units.end());
+
+			for (size_t i=0; i<units.size(); i++) {
+				if (members.insert(units[i]).second) {
+					active_units.push_back(units[i]);
+					added.push_back(units[i]);
+				}
+			}
+		}
+
+		// 'removed' receives the units that were actually in the group
+		void removeUnits(const std::vector<uint32_t> &units, std::vector<uint32_t> &removed)
+		{
+			boost::unordered_set<uint32_t> toRemove(units.begin(), units.end());
+			std::vector<uint32_t> kept;
+			kept.reserve(active_units.size());
+
+			for (size_t i=0; i<active_units.size(); i++) {
+				if (toRemove.erase(active_units[i]) > 0) {
+					removed.push_back(active_units[i]);
+				} else {
+					kept.push_back(active_units[i]);
+				}
+			}
+
+			active_units.swap(kept);
+		}
+};
+
+#endif
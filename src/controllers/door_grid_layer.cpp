@@ -0,0 +1,259 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <math.h>
+#include <ros/ros.h>
+
+#include <nav_msgs/OccupancyGrid.h>
+#include <map_msgs/OccupancyGridUpdate.h>
+
+#include <dynamic_gazebo_models/DoorStates.h>
+
+#define DEFAULT_FRAME_ID "map"
+#define DEFAULT_RESOLUTION 0.05 // in m/cell
+#define DEFAULT_ORIGIN_X -50.0 // in m
+#define DEFAULT_ORIGIN_Y -50.0
+#define DEFAULT_WIDTH 2000 // in cells
+#define DEFAULT_HEIGHT 2000
+
+#define COST_UNKNOWN -1
+#define COST_FREE 0
+#define COST_LETHAL 100
+
+#define FULL_GRID_FRACTION 0.25 // changes covering more of the grid than this republish the whole grid instead
+#define MAX_GRID_UPDATES 50 // more clusters of changes in one message than this republish the whole grid instead
+#define CLUSTER_GAP 20 // in cells; changed doors at most this far apart are sent in one update
+
+/*
+
+Door occupancy grid layer:
+	Rasterizes the footprint bounds of every door into an occupancy grid: free when the door is open, lethal otherwise.
+	Cells that aren't covered by a door (or whose door was removed) are unknown, so the layer can be stacked on top of
+	a static map. The full grid is published (latched) on 'door_grid' once; after that only the cells that changed are
+	sent on 'door_grid_updates', the same way map_server-style static layers expect them: one update per cluster of
+	changed doors in a DoorStates message, so doors changing at opposite ends of a building don't send everything in
+	between. The snapshot of all doors that the plugins send on connect usually covers much of the grid, so large or
+	scattered changes republish the full grid instead.
+
+*/
+
+class DoorGridLayer
+{
+	private:
+
+		ros::NodeHandle rosNode;
+		ros::Subscriber door_state_sub;
+		ros::Publisher grid_pub, grid_update_pub;
+
+		nav_msgs::OccupancyGrid grid;
+		int partialCost;
+
+		struct Region
+		{
+			int minX, minY, maxX, maxY; // in cells; empty if maxX < minX
+		};
+
+		std::vector<Region> clusters; // of the current message; kept to reuse its storage
+
+	public:
+
+		DoorGridLayer(ros::NodeHandle &nh)
+		{
+			rosNode = nh;
+
+			initGrid();
+
+			grid_pub = rosNode.advertise<nav_msgs::OccupancyGrid>("door_grid", 1, true);
+			grid_update_pub = rosNode.advertise<map_msgs::OccupancyGridUpdate>("door_grid_updates", 100);
+			door_state_sub = rosNode.subscribe<dynamic_gazebo_models::DoorStates>("/door_controller/state", 100, &DoorGridLayer::door_states_cb, this);
+
+			grid_pub.publish(grid);
+		}
+
+		void initGrid()
+		{
+			ros::NodeHandle privateNode("~");
+
+			int width, height;
+			privateNode.param<std::string>("frame_id", grid.header.frame_id, DEFAULT_FRAME_ID);
+			privateNode.param<float>("resolution", grid.info.resolution, DEFAULT_RESOLUTION);
+			privateNode.param<double>("origin_x", grid.info.origin.position.x, DEFAULT_ORIGIN_X);
+			privateNode.param<double>("origin_y", grid.info.origin.position.y, DEFAULT_ORIGIN_Y);
+			privateNode.param<int>("width", width, DEFAULT_WIDTH);
+			privateNode.param<int>("height", height, DEFAULT_HEIGHT);
+			privateNode.param<int>("partial_cost", partialCost, COST_LETHAL); // cost of a door that is neither open nor closed
+
+			grid.header.stamp = ros::Time::now();
+			grid.info.map_load_time = grid.header.stamp;
+			grid.info.width = width;
+			grid.info.height = height;
+			grid.info.origin.orientation.w = 1.0;
+			grid.data.assign(width * height, COST_UNKNOWN);
+		}
+
+		void door_states_cb(const dynamic_gazebo_models::DoorStates::ConstPtr& states)
+		{
+			clusters.clear();
+
+			for (size_t i=0; i<states->doors.size(); i++) {
+				Region dirty = {(int) grid.info.width, (int) grid.info.height, -1, -1};
+				rasterizeDoor(states->doors[i], dirty);
+
+				if (dirty.maxX >= dirty.minX) {
+					addToCluster(dirty);
+				}
+			}
+
+			if (clusters.empty()) {
+				return; // nothing changed
+			}
+
+			double area = 0;
+			for (size_t i=0; i<clusters.size(); i++) {
+				area += (double) (clusters[i].maxX - clusters[i].minX + 1) * (clusters[i].maxY - clusters[i].minY + 1);
+			}
+
+			if (clusters.size() > MAX_GRID_UPDATES || area > FULL_GRID_FRACTION * grid.info.width * grid.info.height) {
+				grid.header.stamp = ros::Time::now();
+				grid_pub.publish(grid);
+				return;
+			}
+
+			for (size_t i=0; i<clusters.size(); i++) {
+				const Region &cluster = clusters[i];
+				publishUpdate(cluster.minX, cluster.minY, cluster.maxX - cluster.minX + 1, cluster.maxY - cluster.minY + 1);
+			}
+		}
+
+		// merges the changed region of a door into the first cluster within CLUSTER_GAP of it, or starts a new one
+		void addToCluster(const Region &region)
+		{
+			for (size_t i=0; i<clusters.size(); i++) {
+				Region &cluster = clusters[i];
+
+				if (region.minX > cluster.maxX + CLUSTER_GAP || region.maxX < cluster.minX - CLUSTER_GAP ||
+						region.minY > cluster.maxY + CLUSTER_GAP || region.maxY < cluster.minY - CLUSTER_GAP) {
+					continue;
+				}
+
+				cluster.minX = std::min(cluster.minX, region.minX);
+				cluster.maxX = std::max(cluster.maxX, region.maxX);
+				cluster.minY = std::min(cluster.minY, region.minY);
+				cluster.maxY = std::max(cluster.maxY, region.maxY);
+				return;
+			}
+
+			clusters.push_back(region);
+		}
+
+		// grows dirty by the cells that changed
+		void rasterizeDoor(const dynamic_gazebo_models::DoorState &door, Region &dirty)
+		{
+			if (door.footprint.empty()) {
+				return;
+			}
+
+			int8_t cost = COST_LETHAL;
+
+			if (door.state == dynamic_gazebo_models::DoorState::OPEN) {
+				cost = COST_FREE;
+			} else if (door.state == dynamic_gazebo_models::DoorState::PARTIAL) {
+				cost = partialCost;
+			} else if (door.state == dynamic_gazebo_models::DoorState::REMOVED) {
+				cost = COST_UNKNOWN;
+			}
+
+			// every cell overlapping the bounds of the footprint belongs to the door (door footprints are often thinner than a cell):
+			double minX = door.footprint[0].x, maxX = minX, minY = door.footprint[0].y, maxY = minY;
+
+			for (size_t i=1; i<door.footprint.size(); i++) {
+				minX = std::min(minX, door.footprint[i].x);
+				maxX = std::max(maxX, door.footprint[i].x);
+				minY = std::min(minY, door.footprint[i].y);
+				maxY = std::max(maxY, door.footprint[i].y);
+			}
+
+			int cellMinX = std::max(0, toCellX(minX)), cellMaxX = std::min((int) grid.info.width - 1, toCellX(maxX));
+			int cellMinY = std::max(0, toCellY(minY)), cellMaxY = std::min((int) grid.info.height - 1, toCellY(maxY));
+
+			if (cellMinX > cellMaxX || cellMinY > cellMaxY) {
+				ROS_WARN("Door Grid Layer: door '%s' lies outside of the grid", door.model_name.c_str());
+				return;
+			}
+
+			// rasterize & track the region that actually changed:
+			for (int cy = cellMinY; cy <= cellMaxY; cy++) {
+				for (int cx = cellMinX; cx <= cellMaxX; cx++) {
+					int8_t &cell = grid.data[cy * grid.info.width + cx];
+
+					if (cell == cost) {
+						continue;
+					}
+
+					cell = cost;
+
+					dirty.minX = std::min(dirty.minX, cx);
+					dirty.maxX = std::max(dirty.maxX, cx);
+					dirty.minY = std::min(dirty.minY, cy);
+					dirty.maxY = std::max(dirty.maxY, cy);
+				}
+			}
+		}
+
+		void publishUpdate(int x, int y, int width, int height)
+		{
+			map_msgs::OccupancyGridUpdate update;
+
+			update.header.stamp = ros::Time::now();
+			update.header.frame_id = grid.header.frame_id;
+			update.x = x;
+			update.y = y;
+			update.width = width;
+			update.height = height;
+			update.data.reserve(width * height);
+
+			for (int cy = y; cy < y + height; cy++) {
+				std::vector<int8_t>::const_iterator row = grid.data.begin() + cy * grid.info.width;
+				update.data.insert(update.data.end(), row + x, row + x + width);
+			}
+
+			grid_update_pub.publish(update);
+		}
+
+		int toCellX(double x)
+		{
+			return (int) floor((x - grid.info.origin.position.x) / grid.info.resolution);
+		}
+
+		int toCellY(double y)
+		{
+			return (int) floor((y - grid.info.origin.position.y) / grid.info.resolution);
+		}
+};
+
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "door_grid_layer");
+	ros::NodeHandle rosNode;
+
+	DoorGridLayer layer(rosNode);
+	ros::spin();
+}
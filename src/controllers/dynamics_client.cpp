@@ -0,0 +1,199 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <dynamic_gazebo_models/dynamics_client.h>
+
+#include <dynamic_gazebo_models/AddGroup.h>
+#include <dynamic_gazebo_models/AddUnits.h>
+#include <dynamic_gazebo_models/RemoveUnits.h>
+#include <dynamic_gazebo_models/DeleteGroup.h>
+#include <dynamic_gazebo_models/OpenCloseDoors.h>
+#include <dynamic_gazebo_models/OpenCloseElevDoors.h>
+#include <dynamic_gazebo_models/SetElevProps.h>
+#include <dynamic_gazebo_models/SetVelDoors.h>
+#include <dynamic_gazebo_models/SetDoorOpening.h>
+#include <dynamic_gazebo_models/TargetFloorElev.h>
+
+namespace dynamic_gazebo_models
+{
+	DynamicsClient::DynamicsClient(const ros::NodeHandle &nh) : rosNode(nh)
+	{
+		addGroupConn.service = "model_dynamics_manager/add_control_group";
+		deleteGroupConn.service = "model_dynamics_manager/delete_control_group";
+		listGroupsConn.service = "model_dynamics_manager/list_groups";
+		addUnitsConn.service = "model_dynamics_manager/add_units";
+		removeUnitsConn.service = "model_dynamics_manager/remove_units";
+
+		openCloseDoorsConn.service = "model_dynamics_manager/doors/open_close";
+		setVelDoorsConn.service = "model_dynamics_manager/doors/set_vel";
+		setDoorOpeningConn.service = "model_dynamics_manager/doors/set_opening";
+
+		targetFloorConn.service = "model_dynamics_manager/elevators/target_floor";
+		setElevPropsConn.service = "model_dynamics_manager/elevators/set_props";
+		openCloseElevConn.service = "model_dynamics_manager/elevators/open_close_elev";
+	}
+
+	template <class S>
+	bool DynamicsClient::call(Connection &conn, S &srv)
+	{
+		boost::mutex::scoped_lock lock(conn.mutex);
+
+		if (!conn.client.isValid()) {
+			conn.client = rosNode.serviceClient<S>(conn.service, true);
+		}
+
+		if (conn.client.call(srv)) {
+			return true;
+		}
+
+		// a rejected call leaves the connection intact; only a dropped one is worth another try:
+		if (conn.client.isValid()) {
+			return false;
+		}
+
+		conn.client = rosNode.serviceClient<S>(conn.service, true);
+		return conn.client.call(srv);
+	}
+
+	bool DynamicsClient::addGroup(const std::string &group_name, const std::string &type, const std::vector<uint32_t> &units)
+	{
+		AddGroup srv;
+		srv.request.group.group_name = group_name;
+		srv.request.group.type = type;
+		srv.request.group.active_units = units;
+
+		return call(addGroupConn, srv);
+	}
+
+	bool DynamicsClient::deleteGroup(const std::string &group_name)
+	{
+		DeleteGroup srv;
+		srv.request.group_name = group_name;
+
+		return call(deleteGroupConn, srv);
+	}
+
+	bool DynamicsClient::addUnits(const std::string &group_name, const std::vector<uint32_t> &units)
+	{
+		AddUnits srv;
+		srv.request.group_name = group_name;
+		srv.request.units = units;
+
+		return call(addUnitsConn, srv);
+	}
+
+	bool DynamicsClient::removeUnits(const std::string &group_name, const std::vector<uint32_t> &units)
+	{
+		RemoveUnits srv;
+		srv.request.group_name = group_name;
+		srv.request.units = units;
+
+		return call(removeUnitsConn, srv);
+	}
+
+	bool DynamicsClient::listGroups(const ListGroups::Request &req, ListGroups::Response &res)
+	{
+		ListGroups srv;
+		srv.request = req;
+
+		if (!call(listGroupsConn, srv)) {
+			return false;
+		}
+
+		res = srv.response;
+		return true;
+	}
+
+	bool DynamicsClient::openDoors(const std::string &group_name)
+	{
+		OpenCloseDoors srv;
+		srv.request.group_name = group_name;
+		srv.request.state = true;
+
+		return call(openCloseDoorsConn, srv);
+	}
+
+	bool DynamicsClient::closeDoors(const std::string &group_name)
+	{
+		OpenCloseDoors srv;
+		srv.request.group_name = group_name;
+		srv.request.state = false;
+
+		return call(openCloseDoorsConn, srv);
+	}
+
+	bool DynamicsClient::setDoorVel(const std::string &group_name, float linear, float angular)
+	{
+		SetVelDoors srv;
+		srv.request.group_name = group_name;
+		srv.request.lin_x = srv.request.lin_y = linear;
+		srv.request.ang_z = angular;
+
+		return call(setVelDoorsConn, srv);
+	}
+
+	bool DynamicsClient::setDoorOpening(const std::string &group_name, float opening, float slideSpeed, float flipSpeed)
+	{
+		SetDoorOpening srv;
+		srv.request.group_name = group_name;
+		srv.request.opening = opening;
+		srv.request.slide_speed = slideSpeed;
+		srv.request.flip_speed = flipSpeed;
+
+		return call(setDoorOpeningConn, srv);
+	}
+
+	bool DynamicsClient::gotoFloor(const std::string &group_name, int floor)
+	{
+		TargetFloorElev srv;
+		srv.request.group_name = group_name;
+		srv.request.target_floor = floor;
+
+		return call(targetFloorConn, srv);
+	}
+
+	bool DynamicsClient::openElevDoors(const std::string &group_name)
+	{
+		OpenCloseElevDoors srv;
+		srv.request.group_name = group_name;
+		srv.request.state = true;
+
+		return call(openCloseElevConn, srv);
+	}
+
+	bool DynamicsClient::closeElevDoors(const std::string &group_name)
+	{
+		OpenCloseElevDoors srv;
+		srv.request.group_name = group_name;
+		srv.request.state = false;
+
+		return call(openCloseElevConn, srv);
+	}
+
+	bool DynamicsClient::setElevProps(const std::string &group_name, float velocity, float force)
+	{
+		SetElevProps srv;
+		srv.request.group_name = group_name;
+		srv.request.velocity = velocity;
+		srv.request.force = force;
+
+		return call(setElevPropsConn, srv);
+	}
+}
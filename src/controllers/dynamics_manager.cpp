@@ -23,22 +23,31 @@
 #include <ros/ros.h>
 
 #include <geometry_msgs/Twist.h>
-#include <std_msgs/UInt32MultiArray.h>
 #include <std_msgs/Float32MultiArray.h>
 #include <std_msgs/Int32.h>
 #include <std_msgs/UInt8.h>
 
+#include <boost/thread/mutex.hpp>
+
 #include "control_group.h"
+#include "group_registry.h"
+#include "message_pool.h"
 
 #include <dynamic_gazebo_models/ControlGroup.h>
+#include <dynamic_gazebo_models/ActiveUnits.h>
+#include <dynamic_gazebo_models/UnitDelta.h>
 #include <dynamic_gazebo_models/AddGroup.h>
+#include <dynamic_gazebo_models/AddUnits.h>
+#include <dynamic_gazebo_models/RemoveUnits.h>
 #include <dynamic_gazebo_models/DeleteGroup.h>
 #include <dynamic_gazebo_models/ListGroups.h>
 #include <dynamic_gazebo_models/OpenCloseDoors.h>
 #include <dynamic_gazebo_models/OpenCloseElevDoors.h>
 #include <dynamic_gazebo_models/SetElevProps.h>
 #include <dynamic_gazebo_models/SetVelDoors.h>
+#include <dynamic_gazebo_models/SetDoorOpening.h>
 #include <dynamic_gazebo_models/TargetFloorElev.h>
+#include <dynamic_gazebo_models/BatchCommands.h>
 
 #define TYPE_DOOR_STR "door"
 #define TYPE_ELEVATOR_STR "elevator"
@@ -53,10 +62,17 @@
 #define ELEV_DOOR_STATE_CLOSE 0
 #define ELEV_DOOR_STATE_FREE 2
 
-#define INDEX_NOT_FOUND -1
+#define MESSAGE_POOL_INITIAL_SIZE 16 // messages preallocated per type
+#define DEFAULT_SERVICE_THREADS 4
 
 /*
 
+Threading:
+	Services are handled on a pool of '~service_threads' threads (0 = one per core). The groups live in a sharded
+	GroupRegistry, so concurrent lookups don't serialize. Commands are a pair of publishes (active unit list, then the
+	command itself); the pair is published under a per unit type lock so that commands for different groups of the
+	same type can't interleave.
+
 Limitations:
 	Sometimes service calls are dropped without notice. Solution: Implement 'wait for call'
 */
@@ -65,22 +81,46 @@ class DynamicsController
 {
 	private:
 
+		// A command's group & active list, looked up before taking the publisher mutex
+		struct Activation
+		{
+			ControlGroupConstPtr group;
+			dynamic_gazebo_models::ActiveUnitsPtr activeList;
+		};
+
 		ros::NodeHandle rosNode;
-		ros::ServiceServer add_group_server, delete_group_server, list_groups_server;
+		ros::ServiceServer add_group_server, delete_group_server, list_groups_server, add_units_server, remove_units_server;
 		ros::ServiceServer open_close_doors_server, set_vel_doors_server, target_floor_elev_server, set_elev_props_server, open_close_elev_doors_server;
+		ros::ServiceServer set_door_opening_server, batch_commands_server;
 		
-		ros::Publisher door_cmd_vel_pub, door_active_pub;
+		ros::Publisher door_cmd_vel_pub, door_opening_pub, door_active_pub;
 		ros::Publisher elev_target_pub, elev_active_pub, elev_param_pub, elev_door_pub;
+		ros::Publisher door_active_delta_pub, elev_active_delta_pub;
 
-		std::vector<ControlGroup> groups;
+		GroupRegistry groups;
+		boost::mutex doorPubMutex, elevPubMutex;
+		std::string activeDoorGroup, activeElevGroup; // the groups the plugins were last told about, guarded by the mutexes above
+		uint32_t doorSeq, elevSeq; // of the last active list / delta published, guarded by the mutexes above
+
+		// recycled once roscpp has sent them, so steady-state publishing doesn't allocate:
+		MessagePool<geometry_msgs::Twist> twistPool;
+		MessagePool<dynamic_gazebo_models::ActiveUnits> unitListPool;
+		MessagePool<std_msgs::Float32MultiArray> elevParamPool, doorOpeningPool;
+		MessagePool<std_msgs::UInt8> elevDoorPool;
+		MessagePool<std_msgs::Int32> targetFloorPool;
 
 	public:
 
-		DynamicsController(ros::NodeHandle &nh)
+		DynamicsController(ros::NodeHandle &nh) : twistPool(MESSAGE_POOL_INITIAL_SIZE), unitListPool(MESSAGE_POOL_INITIAL_SIZE), 
+			elevParamPool(MESSAGE_POOL_INITIAL_SIZE), doorOpeningPool(MESSAGE_POOL_INITIAL_SIZE), elevDoorPool(MESSAGE_POOL_INITIAL_SIZE), targetFloorPool(MESSAGE_POOL_INITIAL_SIZE)
 		{
 			rosNode = nh;
 			nh = ros::NodeHandle("");
 
+			// the plugins drop lists & deltas older than the last list they got; starting from the clock keeps the numbers
+			// of a restarted manager ahead of the ones it sent before (unless it averaged over 1000 messages per second)
+			doorSeq = elevSeq = static_cast<uint32_t>(ros::WallTime::now().toNSec() / 1000000);
+
 			setupControlTopics();
 			setupManagerServices();
 		}
@@ -90,31 +130,45 @@ class DynamicsController
 			add_group_server = rosNode.advertiseService("model_dynamics_manager/add_control_group", &DynamicsController::add_control_group_cb, this);
 			delete_group_server = rosNode.advertiseService("model_dynamics_manager/delete_control_group", &DynamicsController::delete_control_group_cb, this);
 			list_groups_server = rosNode.advertiseService("model_dynamics_manager/list_groups", &DynamicsController::list_groups_cb, this);
+			add_units_server = rosNode.advertiseService("model_dynamics_manager/add_units", &DynamicsController::add_units_cb, this);
+			remove_units_server = rosNode.advertiseService("model_dynamics_manager/remove_units", &DynamicsController::remove_units_cb, this);
 
 			open_close_doors_server = rosNode.advertiseService("model_dynamics_manager/doors/open_close", &DynamicsController::open_close_doors_cb, this);
 			set_vel_doors_server = rosNode.advertiseService("model_dynamics_manager/doors/set_vel", &DynamicsController::set_vel_doors_cb, this);
+			set_door_opening_server = rosNode.advertiseService("model_dynamics_manager/doors/set_opening", &DynamicsController::set_door_opening_cb, this);
 
 			target_floor_elev_server = rosNode.advertiseService("model_dynamics_manager/elevators/target_floor", &DynamicsController::target_floor_elev_cb, this);
 			set_elev_props_server = rosNode.advertiseService("model_dynamics_manager/elevators/set_props", &DynamicsController::set_elev_props_cb, this);
 			open_close_elev_doors_server = rosNode.advertiseService("model_dynamics_manager/elevators/open_close_elev", &DynamicsController::open_close_elev_cb, this);		
+
+			batch_commands_server = rosNode.advertiseService("model_dynamics_manager/batch_commands", &DynamicsController::batch_commands_cb, this);
 		}
 
 		bool open_close_doors_cb(dynamic_gazebo_models::OpenCloseDoors::Request &req, dynamic_gazebo_models::OpenCloseDoors::Response &res)
 		{
-			if (!activateDoors(req.group_name)) {
+			Activation activation;
+
+			if (!prepareActivation(req.group_name, DOOR, activation)) {
 				return false;
 			}
 
-			geometry_msgs::Twist cmd_vel;
+			geometry_msgs::TwistPtr cmd_vel = twistPool.acquire();
+			*cmd_vel = geometry_msgs::Twist(); // recycled messages keep their old values
 
 			if (req.state == STATE_OPEN) {
-				cmd_vel.linear.x = -DEFAULT_SLIDE_SPEED;
-				cmd_vel.linear.y = -DEFAULT_SLIDE_SPEED;
-				cmd_vel.angular.z = -DEFAULT_FLIP_SPEED;
+				cmd_vel->linear.x = -DEFAULT_SLIDE_SPEED;
+				cmd_vel->linear.y = -DEFAULT_SLIDE_SPEED;
+				cmd_vel->angular.z = -DEFAULT_FLIP_SPEED;
 			} else {
-				cmd_vel.linear.x = DEFAULT_SLIDE_SPEED;
-				cmd_vel.linear.y = DEFAULT_SLIDE_SPEED;
-				cmd_vel.angular.z = DEFAULT_FLIP_SPEED;
+				cmd_vel->linear.x = DEFAULT_SLIDE_SPEED;
+				cmd_vel->linear.y = DEFAULT_SLIDE_SPEED;
+				cmd_vel->angular.z = DEFAULT_FLIP_SPEED;
+			}
+
+			boost::mutex::scoped_lock lock(doorPubMutex);
+
+			if (!publishActivation(req.group_name, DOOR, activation)) {
+				return false;
 			}
 
 			door_cmd_vel_pub.publish(cmd_vel);
@@ -124,32 +178,79 @@ class DynamicsController
 
 		bool set_vel_doors_cb(dynamic_gazebo_models::SetVelDoors::Request &req, dynamic_gazebo_models::SetVelDoors::Response &res)
 		{
-			if (!activateDoors(req.group_name)) {
+			Activation activation;
+
+			if (!prepareActivation(req.group_name, DOOR, activation)) {
 				return false;
 			}
 
-			geometry_msgs::Twist cmd_vel;
+			geometry_msgs::TwistPtr cmd_vel = twistPool.acquire();
+			*cmd_vel = geometry_msgs::Twist();
+
+			cmd_vel->linear.x = req.lin_x;
+			cmd_vel->linear.y = req.lin_y;
+			cmd_vel->angular.z = req.ang_z;
 
-			cmd_vel.linear.x = req.lin_x;
-			cmd_vel.linear.y = req.lin_y;
-			cmd_vel.angular.z = req.ang_z;
+			boost::mutex::scoped_lock lock(doorPubMutex);
+
+			if (!publishActivation(req.group_name, DOOR, activation)) {
+				return false;
+			}
 
 			door_cmd_vel_pub.publish(cmd_vel);
 
 			return true;
 		}
 
+		bool set_door_opening_cb(dynamic_gazebo_models::SetDoorOpening::Request &req, dynamic_gazebo_models::SetDoorOpening::Response &res)
+		{
+			if (req.opening < 0 || req.opening > 1) {
+				ROS_ERROR("Door Service Failed: The opening must be within [0, 1]");
+				return false;
+			}
+
+			Activation activation;
+
+			if (!prepareActivation(req.group_name, DOOR, activation)) {
+				return false;
+			}
+
+			std_msgs::Float32MultiArrayPtr opening = doorOpeningPool.acquire();
+			opening->data.resize(3);
+			opening->data[0] = req.opening;
+			opening->data[1] = req.slide_speed;
+			opening->data[2] = req.flip_speed;
+
+			boost::mutex::scoped_lock lock(doorPubMutex);
+
+			if (!publishActivation(req.group_name, DOOR, activation)) {
+				return false;
+			}
+
+			door_opening_pub.publish(opening);
+
+			return true;
+		}
+
 		bool target_floor_elev_cb(dynamic_gazebo_models::TargetFloorElev::Request &req, dynamic_gazebo_models::TargetFloorElev::Response &res)
 		{
-			if (!activateElevators(req.group_name)) {
+			Activation activation;
+
+			if (!prepareActivation(req.group_name, ELEVATOR, activation)) {
 				return false;
 			}
 
-			std_msgs::UInt8 elev_door_state;
-			elev_door_state.data = ELEV_DOOR_STATE_FREE;
+			std_msgs::UInt8Ptr elev_door_state = elevDoorPool.acquire();
+			elev_door_state->data = ELEV_DOOR_STATE_FREE;
 
-			std_msgs::Int32 target_floor;
-			target_floor.data = req.target_floor;
+			std_msgs::Int32Ptr target_floor = targetFloorPool.acquire();
+			target_floor->data = req.target_floor;
+
+			boost::mutex::scoped_lock lock(elevPubMutex);
+
+			if (!publishActivation(req.group_name, ELEVATOR, activation)) {
+				return false;
+			}
 
 			elev_door_pub.publish(elev_door_state);
 			elev_target_pub.publish(target_floor);
@@ -159,13 +260,22 @@ class DynamicsController
 
 		bool set_elev_props_cb(dynamic_gazebo_models::SetElevProps::Request &req, dynamic_gazebo_models::SetElevProps::Response &res)
 		{
-			if (!activateElevators(req.group_name)) {
+			Activation activation;
+
+			if (!prepareActivation(req.group_name, ELEVATOR, activation)) {
 				return false;
 			}
 
-			std_msgs::Float32MultiArray elev_params;
-			elev_params.data.push_back(req.velocity);
-			elev_params.data.push_back(req.force);
+			std_msgs::Float32MultiArrayPtr elev_params = elevParamPool.acquire();
+			elev_params->data.resize(2);
+			elev_params->data[0] = req.velocity;
+			elev_params->data[1] = req.force;
+
+			boost::mutex::scoped_lock lock(elevPubMutex);
+
+			if (!publishActivation(req.group_name, ELEVATOR, activation)) {
+				return false;
+			}
 
 			elev_param_pub.publish(elev_params);
 
@@ -174,16 +284,24 @@ class DynamicsController
 
 		bool open_close_elev_cb(dynamic_gazebo_models::OpenCloseElevDoors::Request &req, dynamic_gazebo_models::OpenCloseElevDoors::Response &res)
 		{
-			if (!activateElevators(req.group_name)) {
+			Activation activation;
+
+			if (!prepareActivation(req.group_name, ELEVATOR, activation)) {
 				return false;
 			}
 
-			std_msgs::UInt8 elev_door_state;
+			std_msgs::UInt8Ptr elev_door_state = elevDoorPool.acquire();
 
 			if (req.state == STATE_OPEN) {
-				elev_door_state.data = ELEV_DOOR_STATE_OPEN;
+				elev_door_state->data = ELEV_DOOR_STATE_OPEN;
 			} else {
-				elev_door_state.data = ELEV_DOOR_STATE_CLOSE;
+				elev_door_state->data = ELEV_DOOR_STATE_CLOSE;
+			}
+
+			boost::mutex::scoped_lock lock(elevPubMutex);
+
+			if (!publishActivation(req.group_name, ELEVATOR, activation)) {
+				return false;
 			}
 
 			elev_door_pub.publish(elev_door_state);
@@ -191,47 +309,120 @@ class DynamicsController
 			return true;
 		}
 
-		bool activateDoors(std::string group_name)
+		bool batch_commands_cb(dynamic_gazebo_models::BatchCommands::Request &req, dynamic_gazebo_models::BatchCommands::Response &res)
 		{
-			int groupIndex = getGroupIndex(group_name);
+			res.success.resize(req.commands.size());
 
-			if (groupIndex == INDEX_NOT_FOUND) {
-				ROS_ERROR("Door Service Failed: The specified group does not exist");
-				return false;
+			for (int i=0; i<req.commands.size(); i++) {
+				res.success[i] = executeCommand(req.commands[i]);
 			}
 
-			ControlGroup currGroup = groups.at(groupIndex);
+			return true; // failures are reported per command
+		}
 
-			if (currGroup.getType() != DOOR) {
-				ROS_ERROR("Door Service Failed: This group type doesn't support this call");
+		bool executeCommand(const dynamic_gazebo_models::ManagerCommand &cmd)
+		{
+			switch (cmd.type) {
+				case dynamic_gazebo_models::ManagerCommand::OPEN_CLOSE_DOORS: {
+					dynamic_gazebo_models::OpenCloseDoors srv;
+					srv.request.group_name = cmd.group_name;
+					srv.request.state = cmd.state;
+					return open_close_doors_cb(srv.request, srv.response);
+				}
+				case dynamic_gazebo_models::ManagerCommand::SET_VEL_DOORS: {
+					dynamic_gazebo_models::SetVelDoors srv;
+					srv.request.group_name = cmd.group_name;
+					srv.request.lin_x = cmd.lin_x;
+					srv.request.lin_y = cmd.lin_y;
+					srv.request.ang_z = cmd.ang_z;
+					return set_vel_doors_cb(srv.request, srv.response);
+				}
+				case dynamic_gazebo_models::ManagerCommand::SET_DOOR_OPENING: {
+					dynamic_gazebo_models::SetDoorOpening srv;
+					srv.request.group_name = cmd.group_name;
+					srv.request.opening = cmd.opening;
+					srv.request.slide_speed = cmd.lin_x;
+					srv.request.flip_speed = cmd.ang_z;
+					return set_door_opening_cb(srv.request, srv.response);
+				}
+				case dynamic_gazebo_models::ManagerCommand::TARGET_FLOOR_ELEV: {
+					dynamic_gazebo_models::TargetFloorElev srv;
+					srv.request.group_name = cmd.group_name;
+					srv.request.target_floor = cmd.target_floor;
+					return target_floor_elev_cb(srv.request, srv.response);
+				}
+				case dynamic_gazebo_models::ManagerCommand::SET_ELEV_PROPS: {
+					dynamic_gazebo_models::SetElevProps srv;
+					srv.request.group_name = cmd.group_name;
+					srv.request.velocity = cmd.velocity;
+					srv.request.force = cmd.force;
+					return set_elev_props_cb(srv.request, srv.response);
+				}
+				case dynamic_gazebo_models::ManagerCommand::OPEN_CLOSE_ELEV_DOORS: {
+					dynamic_gazebo_models::OpenCloseElevDoors srv;
+					srv.request.group_name = cmd.group_name;
+					srv.request.state = cmd.state;
+					return open_close_elev_cb(srv.request, srv.response);
+				}
+				default:
+					ROS_ERROR("Batch Service: Unknown command type %d", cmd.type);
+					return false;
+			}
+		}
+
+		// Looks the group up and copies its active list, before the publisher lock is taken; false (and logged) if the
+		// group can't take the command
+		bool prepareActivation(const std::string &group_name, GroupType type, Activation &activation)
+		{
+			activation.group = groups.find(group_name);
+
+			if (!checkGroup(activation.group, type)) {
 				return false;
 			}
 
-			// Publish the IDs of the active doors in the group
-			std_msgs::UInt32MultiArray active_doors = uintVectorToStdMsgs(currGroup.getActiveUnits());
-			door_active_pub.publish(active_doors);
+			activation.activeList = activeUnitsToMsg(activation.group->getActiveUnits());
 
 			return true;
 		}
 
-		bool activateElevators(std::string group_name)
+		// Publishes the IDs of the active units in the group. Call it with the publisher mutex of the type held, right before
+		// the command: the plugins must get the list first, and commands for different groups must not interleave
+		bool publishActivation(const std::string &group_name, GroupType type, Activation &activation)
 		{
-			int groupIndex = getGroupIndex(group_name);
+			bool isDoor = type == DOOR;
 
-			if (groupIndex == INDEX_NOT_FOUND) {
-				ROS_ERROR("Elevator Service Failed: The specified group does not exist");
-				return false;
+			// the group edits take the same mutex, so this snapshot is the one the plugins will follow:
+			ControlGroupConstPtr group = groups.find(group_name);
+
+			if (group != activation.group) {
+				// edited or deleted since it was prepared
+				if (!checkGroup(group, type)) {
+					return false;
+				}
+
+				activation.activeList = activeUnitsToMsg(group->getActiveUnits());
 			}
 
-			ControlGroup currGroup = groups.at(groupIndex);
+			activation.activeList->seq = ++(isDoor ? doorSeq : elevSeq);
+			(isDoor ? door_active_pub : elev_active_pub).publish(activation.activeList);
+			(isDoor ? activeDoorGroup : activeElevGroup) = group_name;
+
+			return true;
+		}
+
+		bool checkGroup(const ControlGroupConstPtr &group, GroupType type)
+		{
+			const char *service = type == DOOR ? "Door" : "Elevator";
 
-			if (currGroup.getType() != ELEVATOR) {
-				ROS_ERROR("Elevato Service Failed: This group type doesn't support this call");
+			if (!group) {
+				ROS_ERROR("%s Service Failed: The specified group does not exist", service);
 				return false;
 			}
 
-			std_msgs::UInt32MultiArray active_elevs = uintVectorToStdMsgs(currGroup.getActiveUnits());
-			elev_active_pub.publish(active_elevs);
+			if (group->getType() != type) {
+				ROS_ERROR("%s Service Failed: This group type doesn't support this call", service);
+				return false;
+			}
 
 			return true;
 		}
@@ -239,22 +430,23 @@ class DynamicsController
 		void setupControlTopics()
 		{
 			door_cmd_vel_pub = rosNode.advertise<geometry_msgs::Twist>("/door_controller/command", 100);
-			door_active_pub = rosNode.advertise<std_msgs::UInt32MultiArray>("/door_controller/active", 1000);
+			door_opening_pub = rosNode.advertise<std_msgs::Float32MultiArray>("/door_controller/opening", 100);
+			door_active_pub = rosNode.advertise<dynamic_gazebo_models::ActiveUnits>("/door_controller/active", 1000);
 
 		    elev_target_pub = rosNode.advertise<std_msgs::Int32>("/elevator_controller/target_floor", 100);
-		    elev_active_pub = rosNode.advertise<std_msgs::UInt32MultiArray>("elevator_controller/active", 1000);
+		    elev_active_pub = rosNode.advertise<dynamic_gazebo_models::ActiveUnits>("elevator_controller/active", 1000);
 		    elev_param_pub = rosNode.advertise<std_msgs::Float32MultiArray>("elevator_controller/param", 1000);
 		    elev_door_pub = rosNode.advertise<std_msgs::UInt8>("/elevator_controller/door", 100);
+
+			door_active_delta_pub = rosNode.advertise<dynamic_gazebo_models::UnitDelta>("/door_controller/active_delta", 100);
+			elev_active_delta_pub = rosNode.advertise<dynamic_gazebo_models::UnitDelta>("/elevator_controller/active_delta", 100);
 		}
 
-		std_msgs::UInt32MultiArray uintVectorToStdMsgs(std::vector<uint32_t> active_units)
+		// 'seq' is set when it's published
+		dynamic_gazebo_models::ActiveUnitsPtr activeUnitsToMsg(const std::vector<uint32_t> &active_units)
 		{
-			std_msgs::UInt32MultiArray active_list;
-
-			for (int i=0; i<active_units.size(); i++)
-			{	
-				active_list.data.push_back(active_units.at(i));
-			}
+			dynamic_gazebo_models::ActiveUnitsPtr active_list = unitListPool.acquire();
+			active_list->units.assign(active_units.begin(), active_units.end()); // reuses the capacity of the recycled message
 
 			return active_list;
 		}
@@ -268,45 +460,116 @@ class DynamicsController
 				return false;
 			}
 
-			// Check if there is an exiting group with the same name, which might cause conflicts:			
-			int groupIndex = getGroupIndex(req.group.group_name);
-			if (groupIndex != INDEX_NOT_FOUND) {
+			// An exiting group with the same name would cause conflicts:
+			ControlGroupConstPtr group(new ControlGroup(req.group.group_name, type, req.group.active_units));
+
+			if (!groups.add(group)) {
 				ROS_ERROR("Add Group Service Failed: The specified group name already exists");
-				return false;				
+				return false;
 			}
 
-			ControlGroup group(req.group.group_name, type, req.group.active_units);
-			groups.push_back(group);
-
 			return true;
 		}
 
 		bool delete_control_group_cb(dynamic_gazebo_models::DeleteGroup::Request &req, dynamic_gazebo_models::DeleteGroup::Response &res)
 		{
-			int groupIndex = getGroupIndex(req.group_name);
+			ControlGroupConstPtr group = groups.find(req.group_name);
+
+			if (!group) {
+				ROS_WARN("Delete Group Service: The specified group does not exist");
+				return false;
+			}
 
-			if (groupIndex == INDEX_NOT_FOUND) {
+			bool isDoor = group->getType() == DOOR;
+			boost::mutex::scoped_lock lock(isDoor ? doorPubMutex : elevPubMutex);
+
+			if (!groups.remove(req.group_name)) {
 				ROS_WARN("Delete Group Service: The specified group does not exist");
 				return false;
 			}
 
-			groups.erase(groups.begin() + groupIndex);
+			// a new group with the same name must not inherit the active state:
+			std::string &activeGroup = isDoor ? activeDoorGroup : activeElevGroup;
+			if (activeGroup == req.group_name) {
+				activeGroup.clear();
+			}
+
+			return true;
+		}
+
+		bool add_units_cb(dynamic_gazebo_models::AddUnits::Request &req, dynamic_gazebo_models::AddUnits::Response &res)
+		{
+			return editGroupUnits(req.group_name, req.units, true);
+		}
+
+		bool remove_units_cb(dynamic_gazebo_models::RemoveUnits::Request &req, dynamic_gazebo_models::RemoveUnits::Response &res)
+		{
+			return editGroupUnits(req.group_name, req.units, false);
+		}
+
+		bool editGroupUnits(const std::string &group_name, const std::vector<uint32_t> &units, bool add)
+		{
+			ControlGroupConstPtr group = groups.find(group_name);
+
+			if (!group) {
+				ROS_ERROR("Edit Group Service Failed: The specified group does not exist");
+				return false;
+			}
+
+			bool isDoor = group->getType() == DOOR;
+			boost::mutex::scoped_lock lock(isDoor ? doorPubMutex : elevPubMutex);
+
+			std::vector<uint32_t> delta;
+
+			if (!groups.editUnits(group_name, units, add, delta)) {
+				ROS_ERROR("Edit Group Service Failed: The specified group does not exist");
+				return false;
+			}
+
+			// the plugins only need to hear about the change if they're currently following this group:
+			if (!delta.empty() && group_name == (isDoor ? activeDoorGroup : activeElevGroup)) {
+				dynamic_gazebo_models::UnitDelta unit_delta;
+				unit_delta.seq = ++(isDoor ? doorSeq : elevSeq);
+				(add ? unit_delta.added : unit_delta.removed).swap(delta);
+
+				(isDoor ? door_active_delta_pub : elev_active_delta_pub).publish(unit_delta);
+			}
 
 			return true;
 		}
 
 		bool list_groups_cb(dynamic_gazebo_models::ListGroups::Request &req, dynamic_gazebo_models::ListGroups::Response &res)
 		{
-			for (int i=0; i<groups.size(); i++) {
-				dynamic_gazebo_models::ControlGroup item;
+			GroupType type = INVALID; // any type
 
-				item.group_name = groups.at(i).getGroupName();
-				item.type = groups.at(i).getType();
-				item.active_units = groups.at(i).getActiveUnits();
+			if (!req.type.empty()) {
+				type = parseGroupType(req.type);
 
-				res.groups.push_back(item);
+				if (type == INVALID) {
+					ROS_ERROR("List Groups Service Failed: Invalid group type");
+					return false;
+				}
+			}
+
+			// only the groups on the requested page are touched:
+			std::vector<ControlGroupConstPtr> page;
+			res.next_cursor = groups.page(req.prefix, type, req.cursor, req.max_results, page);
+
+			res.groups.resize(page.size());
+			res.unit_counts.resize(page.size());
+
+			for (int i=0; i<page.size(); i++) {
+				dynamic_gazebo_models::ControlGroup &item = res.groups[i];
+
+				item.group_name = page[i]->getGroupName();
+				item.type = groupTypeToStr(page[i]->getType());
+				res.unit_counts[i] = page[i]->getActiveUnits().size();
+
+				if (!req.omit_units) {
+					item.active_units = page[i]->getActiveUnits();
+				}
 			}
-			
+
 			return true;
 		}
 
@@ -321,25 +584,24 @@ class DynamicsController
 			}
 		}
 
-		int getGroupIndex(std::string group_name)
+		std::string groupTypeToStr(GroupType type)
 		{
-			int groupIndex = INDEX_NOT_FOUND;
-
-			for (int i=0; i<groups.size(); i++) {
-				if (groups.at(i).getGroupName().compare(group_name) == 0) {
-					groupIndex = i;
-					return groupIndex;
-				}
-			}
-
-			return groupIndex;
+			return type == DOOR ? TYPE_DOOR_STR : TYPE_ELEVATOR_STR;
 		}
 
 		void start()
 		{
-			while (rosNode.ok()) {
-				ros::spinOnce();
+			int numThreads;
+			ros::NodeHandle("~").param<int>("service_threads", numThreads, DEFAULT_SERVICE_THREADS);
+
+			if (numThreads < 0) {
+				ROS_WARN("Dynamics Manager: invalid number of service threads (%d), using %d", numThreads, DEFAULT_SERVICE_THREADS);
+				numThreads = DEFAULT_SERVICE_THREADS;
 			}
+
+			ros::AsyncSpinner spinner(numThreads);
+			spinner.start();
+			ros::waitForShutdown();
 		}
 };
 
@@ -0,0 +1,169 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_GROUP_REGISTRY_H
+#define DYNAMIC_GAZEBO_MODELS_GROUP_REGISTRY_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "control_group.h"
+
+#define GROUP_REGISTRY_SHARDS 16
+
+/*
+
+Thread-safe registry of control groups:
+	Groups are spread over GROUP_REGISTRY_SHARDS shards by the hash of their name, each behind its own reader-writer
+	lock, so service threads only contend when they touch the same shard - and even then only writers block.
+	Stored groups are immutable snapshots: lookups hand out a shared pointer (no copy of the unit list), and an edit
+	replaces the snapshot, so readers holding the old one are never affected.
+	Listings are served in name order from a separate sorted index, one page at a time.
+
+*/
+
+typedef boost::shared_ptr<const ControlGroup> ControlGroupConstPtr;
+
+class GroupRegistry
+{
+	private:
+
+		struct Shard
+		{
+			boost::shared_mutex mutex;
+			std::map<std::string, ControlGroupConstPtr> groups;
+		};
+
+		Shard shards[GROUP_REGISTRY_SHARDS];
+
+		boost::shared_mutex indexMutex; // always taken after a shard lock, never before
+		std::map<std::string, ControlGroupConstPtr> index;
+
+		Shard& shardOf(const std::string &group_name)
+		{
+			return shards[boost::hash<std::string>()(group_name) % GROUP_REGISTRY_SHARDS];
+		}
+
+	public:
+
+		// Returns false if a group with the same name already exists
+		bool add(const ControlGroupConstPtr &group)
+		{
+			Shard &shard = shardOf(group->getGroupName());
+			boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+
+			if (!shard.groups.insert(std::make_pair(group->getGroupName(), group)).second) {
+				return false;
+			}
+
+			boost::unique_lock<boost::shared_mutex> indexLock(indexMutex);
+			index[group->getGroupName()] = group;
+
+			return true;
+		}
+
+		bool remove(const std::string &group_name)
+		{
+			Shard &shard = shardOf(group_name);
+			boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+
+			if (shard.groups.erase(group_name) == 0) {
+				return false;
+			}
+
+			boost::unique_lock<boost::shared_mutex> indexLock(indexMutex);
+			index.erase(group_name);
+
+			return true;
+		}
+
+		// Adds (or removes) units to a copy of the group and swaps the copy in; readers of the old snapshot are unaffected.
+		// 'delta' receives the units that actually changed. Returns false if the group doesn't exist.
+		bool editUnits(const std::string &group_name, const std::vector<uint32_t> &units, bool add, std::vector<uint32_t> &delta)
+		{
+			Shard &shard = shardOf(group_name);
+			boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+
+			std::map<std::string, ControlGroupConstPtr>::iterator it = shard.groups.find(group_name);
+
+			if (it == shard.groups.end()) {
+				return false;
+			}
+
+			boost::shared_ptr<ControlGroup> edited(new ControlGroup(*it->second));
+			add ? edited->addUnits(units, delta) : edited->removeUnits(units, delta);
+
+			if (delta.empty()) {
+				return true; // nothing to swap
+			}
+
+			it->second = edited;
+
+			boost::unique_lock<boost::shared_mutex> indexLock(indexMutex);
+			index[group_name] = edited;
+
+			return true;
+		}
+
+		// Returns an empty pointer if the group doesn't exist
+		ControlGroupConstPtr find(const std::string &group_name)
+		{
+			Shard &shard = shardOf(group_name);
+			boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+
+			std::map<std::string, ControlGroupConstPtr>::const_iterator it = shard.groups.find(group_name);
+			return it == shard.groups.end() ? ControlGroupConstPtr() : it->second;
+		}
+
+		// Collects (in name order) at most maxResults groups whose names start with 'prefix' and come after 'cursor',
+		// of the given type (INVALID = any type). Returns the cursor of the next page, or "" if there are no more groups.
+		std::string page(const std::string &prefix, GroupType type, const std::string &cursor, size_t maxResults, std::vector<ControlGroupConstPtr> &groups)
+		{
+			boost::shared_lock<boost::shared_mutex> lock(indexMutex);
+
+			std::map<std::string, ControlGroupConstPtr>::const_iterator it = index.lower_bound(prefix);
+
+			if (!cursor.empty() && cursor >= prefix) {
+				it = index.upper_bound(cursor);
+			}
+
+			for (; it != index.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+				if (type != INVALID && it->second->getType() != type) {
+					continue;
+				}
+
+				if (maxResults > 0 && groups.size() == maxResults) {
+					return groups.back()->getGroupName(); // there's at least one more match
+				}
+
+				groups.push_back(it->second);
+			}
+
+			return "";
+		}
+};
+
+#endif
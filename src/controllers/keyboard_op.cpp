@@ -19,19 +19,17 @@
 // SOFTWARE.
 
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
 
 #include <ros/ros.h>
 
-#include <dynamic_gazebo_models/ControlGroup.h>
-#include <dynamic_gazebo_models/AddGroup.h>
-#include <dynamic_gazebo_models/DeleteGroup.h>
-#include <dynamic_gazebo_models/ListGroups.h>
-#include <dynamic_gazebo_models/OpenCloseDoors.h>
-#include <dynamic_gazebo_models/OpenCloseElevDoors.h>
-#include <dynamic_gazebo_models/SetElevProps.h>
-#include <dynamic_gazebo_models/SetVelDoors.h>
-#include <dynamic_gazebo_models/TargetFloorElev.h>
+#include <dynamic_gazebo_models/dynamics_client.h>
+
+#include "script_runner.h"
 
 #define CONTROL_GROUP_NAME "keyboard_op_control_group"
 
@@ -47,60 +45,42 @@ class KeyboardOp
 {
 	private:
 		ros::NodeHandle rosNode;
-		ros::ServiceClient add_group_client, delete_group_client, list_groups_client;
-		ros::ServiceClient open_close_doors_client, set_vel_doors_client, target_floor_elev_client, set_elev_props_client, open_close_elev_doors_client;
+		dynamic_gazebo_models::DynamicsClient client;
 
-		ControlType type;
+		ControlType type, groupType;
 		std::string groupName;
 		bool isGroupInitialized;
+		std::vector<uint32_t> groupUnits; // current members of the control group on the manager
 
-		dynamic_gazebo_models::OpenCloseDoors openDoorsCall;
-		dynamic_gazebo_models::OpenCloseDoors closeDoorsCall;
-		dynamic_gazebo_models::SetVelDoors setVelDoorsCall;
-		dynamic_gazebo_models::TargetFloorElev targetFloorCall;
-		dynamic_gazebo_models::OpenCloseElevDoors openElevDoorsCall;
-		dynamic_gazebo_models::OpenCloseElevDoors closeElevDoorsCall;
-		dynamic_gazebo_models::SetElevProps setElevPropsCall;
+		float slideSpeed, flipSpeed, elevSpeed, elevForce;
 
 	public:
-		KeyboardOp(ros::NodeHandle &nh)
+		KeyboardOp(ros::NodeHandle &nh) : client(ros::NodeHandle(""))
 		{
 			rosNode = nh;
 			rosNode = ros::NodeHandle("");
 
-			setupClientServices();
 			initVars();
 		}
 
 		void initVars()
 		{
 			type = DOOR;
-		}
-
-		void setupClientServices()
-		{
-			add_group_client = rosNode.serviceClient<dynamic_gazebo_models::AddGroup>("model_dynamics_manager/add_control_group");
-			delete_group_client = rosNode.serviceClient<dynamic_gazebo_models::DeleteGroup>("model_dynamics_manager/delete_control_group");
-			list_groups_client = rosNode.serviceClient<dynamic_gazebo_models::ListGroups>("model_dynamics_manager/list_groups");
 
-			open_close_doors_client = rosNode.serviceClient<dynamic_gazebo_models::OpenCloseDoors>("model_dynamics_manager/doors/open_close");
-			set_vel_doors_client = rosNode.serviceClient<dynamic_gazebo_models::SetVelDoors>("model_dynamics_manager/doors/set_vel");
-
-			target_floor_elev_client = rosNode.serviceClient<dynamic_gazebo_models::TargetFloorElev>("model_dynamics_manager/elevators/target_floor");
-			set_elev_props_client = rosNode.serviceClient<dynamic_gazebo_models::SetElevProps>("model_dynamics_manager/elevators/set_props");
-			open_close_elev_doors_client = rosNode.serviceClient<dynamic_gazebo_models::OpenCloseElevDoors>("model_dynamics_manager/elevators/open_close_elev");	
+			slideSpeed = DEFAULT_SLIDE_SPEED;
+			flipSpeed = DEFAULT_FLIP_SPEED;
+			elevSpeed = DEFAULT_ELEV_SPEED;
+			elevForce = DEFAULT_ELEV_FORCE;
 		}
 
-		bool setControlType(char input[])
+		bool setControlType(const std::string &input)
 		{
-			std::string inputStr(input);
-
-			if (boost::iequals(inputStr, "door")) {
+			if (boost::iequals(input, "door")) {
 				std::cout << "Control type set to 'door'" << std::endl;
 				type = DOOR;
 				setActiveUnits();
 				return true;
-			} else if (boost::iequals(inputStr, "elevator")){
+			} else if (boost::iequals(input, "elevator")){
 				std::cout << "Control type set to 'elevator'" << std::endl;
 				type = ELEVATOR;
 				setActiveUnits();
@@ -112,29 +92,54 @@ class KeyboardOp
 
 		void setActiveUnits()
 		{
-			char input[30];
+			std::string input;
 			std::cout << "Enter the reference numbers of the units you want to control. Eg: 1, 3, 4 for units one, three & four" << std::endl;
 			
 			readLineInput(input);
 			std::vector<uint32_t> activeList = parseActiveList(input);
-			
-			// Delete previous group if already initialized. Note: IGNORE the warning produced during initialization about delete service failing
-			dynamic_gazebo_models::DeleteGroup deleteSrv;
-			deleteSrv.request.group_name = CONTROL_GROUP_NAME;
-			delete_group_client.call(deleteSrv);
 
-			// Add new group with the desired units
-			dynamic_gazebo_models::AddGroup addSrv;
-			addSrv.request.group.group_name = CONTROL_GROUP_NAME;
-			addSrv.request.group.type = type == DOOR ? "door" : "elevator";
-			addSrv.request.group.active_units = activeList;
-			add_group_client.call(addSrv);
+			if (isGroupInitialized && type == groupType) {
+				editActiveUnits(activeList); // only send the difference
+			} else {
+				recreateGroup(activeList);
+			}
+
+			groupUnits = activeList;
+			groupType = type;
 
 			type == DOOR ? printDoorControls() : printElevatorControls();
 
 			isGroupInitialized = true;
 		}
 
+		void recreateGroup(const std::vector<uint32_t> &activeList)
+		{
+			// Delete previous group if already initialized. Note: IGNORE the warning produced during initialization about delete service failing
+			client.deleteGroup(CONTROL_GROUP_NAME);
+
+			// Add new group with the desired units
+			client.addGroup(CONTROL_GROUP_NAME, type == DOOR ? "door" : "elevator", activeList);
+		}
+
+		void editActiveUnits(const std::vector<uint32_t> &activeList)
+		{
+			std::vector<uint32_t> oldUnits(groupUnits), newUnits(activeList);
+			std::sort(oldUnits.begin(), oldUnits.end());
+			std::sort(newUnits.begin(), newUnits.end());
+
+			std::vector<uint32_t> added, removed;
+			std::set_difference(newUnits.begin(), newUnits.end(), oldUnits.begin(), oldUnits.end(), std::back_inserter(added));
+			std::set_difference(oldUnits.begin(), oldUnits.end(), newUnits.begin(), newUnits.end(), std::back_inserter(removed));
+
+			if (!removed.empty()) {
+				client.removeUnits(CONTROL_GROUP_NAME, removed);
+			}
+
+			if (!added.empty()) {
+				client.addUnits(CONTROL_GROUP_NAME, added);
+			}
+		}
+
 		void printDoorControls()
 		{
 		    std::cout << "\n-----------------\nDoor Controls:\nPress 'Enter' after each input.\n'q' to quit.\n'o' to open doors\n'c' to close doors";
@@ -149,7 +154,7 @@ class KeyboardOp
 			std::cout << "\n's##' to set the lift speed (eg: s4.2 for 4.2 m/s). Default: 1.5m/s\n'f##' to set the lift force (eg: f150 for 150N). Default: 150N\n'o' to force open the doors on the current floor\n'c' to force close the doors on the current floor\nDefault floor: 'F0'\n-----------------\n" << std::endl;
 		}
 
-	    std::vector<uint32_t> parseActiveList(char input[])
+	    std::vector<uint32_t> parseActiveList(const std::string &input)
 	    {
 	      std::string active_list_str(input);
 	      std::vector<uint32_t> active_list;
@@ -175,7 +180,7 @@ class KeyboardOp
 
 		void initialize()
 		{
-			char input[30];
+			std::string input;
 			isGroupInitialized = false;
 
 			std::cout << "Enter the |type| of models you want to control: 'door' or 'elevator'" << std::endl;
@@ -185,45 +190,12 @@ class KeyboardOp
 				std::cout << "Invalid type. Options: 'door' or 'elevator'" << std::endl;
 				readLineInput(input);
 			}
-
-			setupCallTemplates();
 		}
 
-		void setupCallTemplates()
+		void readLineInput(std::string &input)
 		{
-			// DOOR based services:
-			openDoorsCall.request.group_name = CONTROL_GROUP_NAME;
-			openDoorsCall.request.state = true;
-
-			closeDoorsCall.request.group_name = CONTROL_GROUP_NAME;
-			closeDoorsCall.request.state = false;
-
-			setVelDoorsCall.request.group_name = CONTROL_GROUP_NAME;
-			setVelDoorsCall.request.lin_x = DEFAULT_SLIDE_SPEED;
-			setVelDoorsCall.request.lin_y = DEFAULT_SLIDE_SPEED;
-			setVelDoorsCall.request.ang_z = DEFAULT_FLIP_SPEED;
-
-			// ELEVATOR based services:
-			targetFloorCall.request.group_name = CONTROL_GROUP_NAME;
-			targetFloorCall.request.target_floor = 0;
-
-			openElevDoorsCall.request.group_name = CONTROL_GROUP_NAME;
-			openElevDoorsCall.request.state = true;
-
-			closeElevDoorsCall.request.group_name = CONTROL_GROUP_NAME;
-			closeElevDoorsCall.request.state = false;
-
-			setElevPropsCall.request.group_name = CONTROL_GROUP_NAME;
-			setElevPropsCall.request.velocity = DEFAULT_ELEV_SPEED;
-			setElevPropsCall.request.force = DEFAULT_ELEV_FORCE;
-		}
-
-		void readLineInput(char input[30])
-		{
-			std::cin.getline(input, 30);
-
-			std::string inputStr(input);
-			if (boost::iequals(inputStr, "q")) {
+			// quit on 'q' or at the end of the input:
+			if (!std::getline(std::cin, input) || boost::iequals(input, "q")) {
 				rosNode.shutdown();				
 				std::exit(EXIT_SUCCESS);
 			}
@@ -232,7 +204,7 @@ class KeyboardOp
 		void start()
 		{
 			initialize();
-			char input[30];
+			std::string input;
 
 			while (rosNode.ok())
 			{
@@ -248,8 +220,12 @@ class KeyboardOp
 
 		}
 
-		void callServices(char input[])
+		void callServices(const std::string &input)
 		{
+			if (input.empty()) {
+				return;
+			}
+
 			ROS_ASSERT(type == DOOR || type == ELEVATOR);
 
 			if (type == DOOR) {
@@ -259,54 +235,49 @@ class KeyboardOp
 			}
 		}
 
-		void executeElevatorServices(char input[])
+		void executeElevatorServices(const std::string &inputStr)
 		{
-			std::string inputStr(input);
-
-			switch(input[0]) {
+			switch(inputStr[0]) {
 				case 'o':
-					open_close_elev_doors_client.call(openElevDoorsCall);
+					client.openElevDoors(CONTROL_GROUP_NAME);
 					break;
 				case 'c':
-					open_close_elev_doors_client.call(closeElevDoorsCall);
+					client.closeElevDoors(CONTROL_GROUP_NAME);
 					break;
 				case 's':
-					setElevPropsCall.request.velocity = parseFloat(inputStr.substr(1));
-					set_elev_props_client.call(setElevPropsCall);
+					elevSpeed = parseFloat(inputStr.substr(1));
+					client.setElevProps(CONTROL_GROUP_NAME, elevSpeed, elevForce);
 					break;
 				case 'f':
-					setElevPropsCall.request.force = parseFloat(inputStr.substr(1));
-					set_elev_props_client.call(setElevPropsCall);
+					elevForce = parseFloat(inputStr.substr(1));
+					client.setElevProps(CONTROL_GROUP_NAME, elevSpeed, elevForce);
 					break;
 				default:
 					try {
-						targetFloorCall.request.target_floor = std::stoi(inputStr);
-						target_floor_elev_client.call(targetFloorCall);
+						client.gotoFloor(CONTROL_GROUP_NAME, std::stoi(inputStr));
 					} catch(std::exception const & e) {
 						std::cout << "Unknown command" << std::endl;
 					}
 			};
 		}
 
-		void executeDoorServices(char input[])
+		void executeDoorServices(const std::string &inputStr)
 		{
-			std::string inputStr(input);
-
-			switch(input[0]) {
+			switch(inputStr[0]) {
 
 				case 'o':
-					open_close_doors_client.call(openDoorsCall);
+					client.openDoors(CONTROL_GROUP_NAME);
 					break;
 				case 'c':
-					open_close_doors_client.call(closeDoorsCall);
+					client.closeDoors(CONTROL_GROUP_NAME);
 					break;
 				case 'l':
-					setVelDoorsCall.request.lin_x = setVelDoorsCall.request.lin_y = parseFloat(inputStr.substr(1));
-					set_vel_doors_client.call(setVelDoorsCall);
+					slideSpeed = parseFloat(inputStr.substr(1));
+					client.setDoorVel(CONTROL_GROUP_NAME, slideSpeed, flipSpeed);
 					break;
 				case 'a':
-					setVelDoorsCall.request.ang_z = parseFloat(inputStr.substr(1));
-					set_vel_doors_client.call(setVelDoorsCall);
+					flipSpeed = parseFloat(inputStr.substr(1));
+					client.setDoorVel(CONTROL_GROUP_NAME, slideSpeed, flipSpeed);
 					break;
 				default:
 					std::cout << "Unknown command" << std::endl;
@@ -325,10 +296,51 @@ class KeyboardOp
 
 int main(int argc, char** argv)
 {
-
   ros::init(argc, argv, "keyboard_op_model_dynamics_control");
+
+  namespace po = boost::program_options;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "print this message")
+    ("script,s", po::value<std::string>(), "run the commands of a script file ('-' for stdin / a pipe) instead of the interactive controls")
+    ("workers,w", po::value<int>()->default_value(DEFAULT_SCRIPT_WORKERS), "number of workers issuing the commands of a script");
+
+  po::variables_map args;
+
+  try {
+    po::store(po::parse_command_line(argc, argv, options), args);
+    po::notify(args);
+  } catch (po::error &e) {
+    std::cerr << e.what() << std::endl << options << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (args.count("help")) {
+    std::cout << options << std::endl;
+    return EXIT_SUCCESS;
+  }
+
   ros::NodeHandle nh;
 
+  if (args.count("script")) {
+    std::string path = args["script"].as<std::string>();
+    ScriptRunner runner(nh, args["workers"].as<int>());
+
+    if (path == "-") {
+      return runner.run(std::cin);
+    }
+
+    std::ifstream script(path.c_str());
+
+    if (!script) {
+      ROS_ERROR("Keyboard Op: can't open script '%s'", path.c_str());
+      return EXIT_FAILURE;
+    }
+
+    return runner.run(script);
+  }
+
   KeyboardOp controller(nh);
   controller.start();
-}
\ No newline at end of file
+}
@@ -0,0 +1,223 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/program_options.hpp>
+
+#include <ros/ros.h>
+
+#include <dynamic_gazebo_models/dynamics_client.h>
+
+#define BENCHMARK_GROUP_PREFIX "manager_benchmark_"
+#define DEFAULT_FIRST_UNIT 65000 // unit ids of the benchmark groups; a world without these units doesn't move
+
+/*
+
+Manager benchmark, against a running dynamics manager:
+	Adds --groups door groups, then has 1, 4, 16 (--threads) client threads call the manager for --duration seconds
+	each: door open / close commands on random groups, with a --list-share of list_groups calls (one page of the
+	benchmark groups) mixed in. Each thread has its own client, so the calls only contend in the manager.
+	For each thread count, it reports the calls per second (and the speedup over the first count) and the median &
+	99th percentile latency of the commands and of the listings. Compare with the manager's ~service_threads.
+
+	The groups refer to the units --first-unit and up, so a world without those units isn't disturbed. They are
+	deleted at the end.
+
+*/
+
+namespace po = boost::program_options;
+
+struct ClientStats
+{
+	std::vector<double> commandLatencies, listLatencies; // in ms
+	size_t numFailed;
+
+	ClientStats() : numFailed(0) {}
+};
+
+struct ClientRun
+{
+	int numGroups;
+	double listShare;
+	uint32_t pageSize;
+	ros::WallTime deadline;
+	unsigned int seed;
+
+	void operator()(ClientStats &stats)
+	{
+		dynamic_gazebo_models::DynamicsClient client;
+
+		dynamic_gazebo_models::ListGroups::Request listReq;
+		listReq.prefix = BENCHMARK_GROUP_PREFIX;
+		listReq.max_results = pageSize;
+		listReq.omit_units = true;
+
+		while (ros::WallTime::now() < deadline && ros::ok()) {
+			bool isList = rand_r(&seed) < listShare * RAND_MAX;
+			ros::WallTime start = ros::WallTime::now();
+			bool isSuccess;
+
+			if (isList) {
+				dynamic_gazebo_models::ListGroups::Response listRes;
+				isSuccess = client.listGroups(listReq, listRes);
+			} else {
+				std::ostringstream group;
+				group << BENCHMARK_GROUP_PREFIX << rand_r(&seed) % numGroups;
+				isSuccess = rand_r(&seed) % 2 ? client.openDoors(group.str()) : client.closeDoors(group.str());
+			}
+
+			double latency = (ros::WallTime::now() - start).toSec() * 1000;
+			(isList ? stats.listLatencies : stats.commandLatencies).push_back(latency);
+			stats.numFailed += isSuccess ? 0 : 1;
+		}
+	}
+};
+
+static double percentile(std::vector<double> &values, double fraction)
+{
+	if (values.empty()) {
+		return 0;
+	}
+
+	size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+
+	return values[index];
+}
+
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "manager_benchmark", ros::init_options::AnonymousName); // takes out the ROS arguments first
+
+	std::vector<int> defaultThreads;
+	defaultThreads.push_back(1);
+	defaultThreads.push_back(4);
+	defaultThreads.push_back(16);
+
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("threads,t", po::value<std::vector<int> >()->multitoken()->default_value(defaultThreads, "1 4 16"), "client thread counts to run")
+		("groups,g", po::value<int>()->default_value(1000), "number of door groups")
+		("units,u", po::value<int>()->default_value(50), "units per group")
+		("first-unit", po::value<uint32_t>()->default_value(DEFAULT_FIRST_UNIT), "first unit id of the groups")
+		("duration,d", po::value<double>()->default_value(5.0), "time per thread count, in s")
+		("list-share", po::value<double>()->default_value(0.1), "share of the calls that are list_groups")
+		("page", po::value<uint32_t>()->default_value(100), "groups per listing");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+
+		if (args.count("help")) {
+			std::cout << options << std::endl;
+			return EXIT_SUCCESS;
+		}
+
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int numGroups = args["groups"].as<int>();
+
+	if (numGroups < 1) {
+		std::cerr << "--groups must be at least 1" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ros::NodeHandle nh;
+	dynamic_gazebo_models::DynamicsClient client;
+
+	std::vector<uint32_t> units(args["units"].as<int>());
+	for (size_t i=0; i<units.size(); i++) {
+		units[i] = args["first-unit"].as<uint32_t>() + i;
+	}
+
+	for (int i=0; i<numGroups; i++) {
+		std::ostringstream group;
+		group << BENCHMARK_GROUP_PREFIX << i;
+
+		client.deleteGroup(group.str()); // left over from an interrupted run
+
+		if (!client.addGroup(group.str(), "door", units)) {
+			std::cerr << "Couldn't add the benchmark groups (is the dynamics manager running?)" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::vector<int> threadCounts = args["threads"].as<std::vector<int> >();
+	double firstRate = 0;
+
+	printf("threads    calls/s  speedup   cmd p50 (ms)   cmd p99 (ms)  list p50 (ms)  list p99 (ms)  failed\n");
+
+	for (size_t i=0; i<threadCounts.size() && ros::ok(); i++) {
+		int numThreads = std::max(1, threadCounts[i]);
+		std::vector<ClientStats> stats(numThreads);
+		boost::thread_group threads;
+
+		ros::WallTime start = ros::WallTime::now();
+
+		for (int j=0; j<numThreads; j++) {
+			ClientRun run;
+			run.numGroups = numGroups;
+			run.listShare = args["list-share"].as<double>();
+			run.pageSize = args["page"].as<uint32_t>();
+			run.deadline = start + ros::WallDuration(args["duration"].as<double>());
+			run.seed = j + 1;
+
+			threads.create_thread(boost::bind<void>(run, boost::ref(stats[j])));
+		}
+
+		threads.join_all();
+
+		double elapsed = (ros::WallTime::now() - start).toSec();
+		ClientStats total;
+
+		for (int j=0; j<numThreads; j++) {
+			total.commandLatencies.insert(total.commandLatencies.end(), stats[j].commandLatencies.begin(), stats[j].commandLatencies.end());
+			total.listLatencies.insert(total.listLatencies.end(), stats[j].listLatencies.begin(), stats[j].listLatencies.end());
+			total.numFailed += stats[j].numFailed;
+		}
+
+		double rate = (total.commandLatencies.size() + total.listLatencies.size()) / elapsed;
+		firstRate = i == 0 ? rate : firstRate;
+
+		printf("%7d %10.0f %7.2fx %14.3f %14.3f %14.3f %14.3f %7zu\n", numThreads, rate, firstRate > 0 ? rate / firstRate : 0,
+			percentile(total.commandLatencies, 0.5), percentile(total.commandLatencies, 0.99),
+			percentile(total.listLatencies, 0.5), percentile(total.listLatencies, 0.99), total.numFailed);
+		fflush(stdout);
+	}
+
+	for (int i=0; i<numGroups; i++) {
+		std::ostringstream group;
+		group << BENCHMARK_GROUP_PREFIX << i;
+		client.deleteGroup(group.str());
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_MESSAGE_POOL_H
+#define DYNAMIC_GAZEBO_MODELS_MESSAGE_POOL_H
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/pool/pool_alloc.hpp>
+
+/*
+
+Pool of reusable ROS messages:
+	acquire() hands out a boost::shared_ptr whose deleter puts the message back into the pool once roscpp (and everyone
+	else) is done with it. Recycled messages keep the capacity of their arrays, and the shared_ptr control blocks come
+	from a boost pool, so steady-state publishing doesn't go through the global allocator.
+
+	Note: recycled messages still hold their previous contents; callers have to set every field they publish.
+
+*/
+
+template <class M>
+class MessagePool
+{
+	private:
+
+		struct FreeList
+		{
+			boost::mutex mutex;
+			std::vector<M*> messages;
+
+			~FreeList()
+			{
+				for (size_t i=0; i<messages.size(); i++) {
+					delete messages[i];
+				}
+			}
+		};
+
+		struct Recycler
+		{
+			boost::weak_ptr<FreeList> freeList;
+
+			Recycler(const boost::shared_ptr<FreeList> &freeList) : freeList(freeList) {}
+
+			void operator()(M *msg)
+			{
+				boost::shared_ptr<FreeList> pool = freeList.lock();
+
+				if (!pool) {
+					delete msg; // the pool is already gone
+					return;
+				}
+
+				boost::mutex::scoped_lock lock(pool->mutex);
+				pool->messages.push_back(msg);
+			}
+		};
+
+		boost::shared_ptr<FreeList> freeList;
+
+	public:
+
+		MessagePool(size_t initialSize = 0) : freeList(new FreeList())
+		{
+			freeList->messages.reserve(initialSize);
+
+			for (size_t i=0; i<initialSize; i++) {
+				freeList->messages.push_back(new M());
+			}
+		}
+
+		boost::shared_ptr<M> acquire()
+		{
+			M *msg = NULL;
+
+			{
+				boost::mutex::scoped_lock lock(freeList->mutex);
+
+				if (!freeList->messages.empty()) {
+					msg = freeList->messages.back();
+					freeList->messages.pop_back();
+				}
+			}
+
+			if (msg == NULL) {
+				msg = new M(); // pool exhausted: grow
+			}
+
+			return boost::shared_ptr<M>(msg, Recycler(freeList), boost::fast_pool_allocator<M>());
+		}
+};
+
+#endif
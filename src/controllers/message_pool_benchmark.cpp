@@ -0,0 +1,198 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+#include <ros/ros.h>
+#include <geometry_msgs/Twist.h>
+
+#include <dynamic_gazebo_models/ActiveUnits.h>
+
+#include "message_pool.h"
+
+#define WARMUP_PUBLISHES 1000 // not counted; the pool & roscpp settle in
+
+/*
+
+Message pool benchmark:
+	Publishes the two kinds of messages the dynamics manager sends for every command, a Twist and an active unit list
+	of --units ids, once with a new message per publish (as the manager used to) and once through a MessagePool. For
+	each, it reports the heap allocations per publish and the time per publish. A counting operator new only counts
+	on the publishing thread, so roscpp's own threads don't show up.
+
+	Without subscribers, roscpp doesn't serialize, so the counts are the manager's own. With subscribers (e.g. start
+	'rostopic hz /message_pool_benchmark/units' first and pass --wait-subscribers), the serialization buffer roscpp
+	allocates per publish shows up in both columns. Needs a ROS master.
+
+*/
+
+namespace po = boost::program_options;
+
+static __thread bool isCounting = false;
+static uint64_t numAllocations = 0; // only counted on the publishing thread
+
+void* operator new(size_t size)
+{
+	if (isCounting) {
+		numAllocations++;
+	}
+
+	void *ptr = malloc(size == 0 ? 1 : size);
+
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+	free(ptr);
+}
+
+struct PublishResult
+{
+	double allocations; // per publish
+	double time; // per publish, in us
+};
+
+static void fill(geometry_msgs::Twist &msg, size_t i, const std::vector<uint32_t> &units)
+{
+	msg = geometry_msgs::Twist();
+	msg.linear.x = (i % 2) ? 1 : -1;
+	msg.angular.z = (i % 2) ? 1.57 : -1.57;
+}
+
+static void fill(dynamic_gazebo_models::ActiveUnits &msg, size_t i, const std::vector<uint32_t> &units)
+{
+	msg.seq = i;
+	msg.units.assign(units.begin(), units.end());
+}
+
+// pool == NULL: a new message per publish
+template <class M>
+static PublishResult publish(ros::Publisher &pub, MessagePool<M> *pool, size_t numPublishes, const std::vector<uint32_t> &units)
+{
+	uint64_t allocations = 0;
+	ros::WallTime start;
+
+	for (size_t i=0; i < WARMUP_PUBLISHES + numPublishes; i++) {
+		if (i == WARMUP_PUBLISHES) {
+			allocations = numAllocations;
+			start = ros::WallTime::now();
+		}
+
+		isCounting = true;
+
+		boost::shared_ptr<M> msg = pool ? pool->acquire() : boost::shared_ptr<M>(new M());
+		fill(*msg, i, units);
+		pub.publish(msg);
+		msg.reset();
+
+		isCounting = false;
+	}
+
+	PublishResult result;
+	result.time = (ros::WallTime::now() - start).toSec() * 1e6 / numPublishes;
+	result.allocations = static_cast<double>(numAllocations - allocations) / numPublishes;
+
+	return result;
+}
+
+template <class M>
+static void compare(const char *name, ros::Publisher &pub, size_t numPublishes, const std::vector<uint32_t> &units)
+{
+	MessagePool<M> pool(16);
+
+	PublishResult plain = publish<M>(pub, NULL, numPublishes, units);
+	PublishResult pooled = publish<M>(pub, &pool, numPublishes, units);
+
+	printf("%-12s %14.2f %14.2f %14.3f %14.3f\n", name, plain.allocations, pooled.allocations, plain.time, pooled.time);
+}
+
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "message_pool_benchmark", ros::init_options::AnonymousName); // takes out the ROS arguments first
+
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("publishes,p", po::value<size_t>()->default_value(100000), "publishes per measurement")
+		("units,u", po::value<size_t>()->default_value(1000), "ids in the active unit list")
+		("wait-subscribers", "wait for a subscriber on both topics before publishing");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+
+		if (args.count("help")) {
+			std::cout << options << std::endl;
+			return EXIT_SUCCESS;
+		}
+
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t numPublishes = std::max<size_t>(1, args["publishes"].as<size_t>());
+
+	ros::NodeHandle nh;
+	ros::Publisher twistPub = nh.advertise<geometry_msgs::Twist>("/message_pool_benchmark/twist", 100);
+	ros::Publisher unitsPub = nh.advertise<dynamic_gazebo_models::ActiveUnits>("/message_pool_benchmark/units", 100);
+
+	if (args.count("wait-subscribers")) {
+		printf("Waiting for subscribers on /message_pool_benchmark/twist and /message_pool_benchmark/units\n");
+
+		while (ros::ok() && (twistPub.getNumSubscribers() == 0 || unitsPub.getNumSubscribers() == 0)) {
+			ros::WallDuration(0.1).sleep();
+		}
+	}
+
+	std::vector<uint32_t> units(args["units"].as<size_t>());
+	for (size_t i=0; i<units.size(); i++) {
+		units[i] = i;
+	}
+
+	printf("message      allocs/publish allocs/publish   us/publish     us/publish\n");
+	printf("             (new message)  (pool)          (new message)  (pool)\n");
+
+	compare<geometry_msgs::Twist>("twist", twistPub, numPublishes, units);
+	compare<dynamic_gazebo_models::ActiveUnits>("active list", unitsPub, numPublishes, units);
+
+	return EXIT_SUCCESS;
+}
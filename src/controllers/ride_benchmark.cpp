@@ -0,0 +1,566 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <boost/program_options.hpp>
+
+#include <ros/ros.h>
+#include <std_msgs/Int32.h>
+#include <gazebo_msgs/ModelStates.h>
+#include <gazebo_msgs/GetModelState.h>
+#include <gazebo_msgs/GetPhysicsProperties.h>
+#include <gazebo_msgs/SpawnModel.h>
+#include <gazebo_msgs/DeleteModel.h>
+
+#include <dynamic_gazebo_models/dynamics_client.h>
+
+#define BENCHMARK_GROUP "ride_benchmark"
+#define REST_SPEED 0.005 // in m/s; a car slower than this at its floor is at rest
+#define DEFAULT_SETTLE_TIME 1.0 // in s (sim time); the car must stay at rest this long to have arrived
+#define DEFAULT_RIDE_TIMEOUT 120.0 // in s (sim time)
+
+#define SPAWNED_RIDER_PREFIX "ride_benchmark_rider_"
+#define SPAWNED_RIDER_SIZE 0.3 // in m; riders are cubes
+#define SPAWNED_RIDER_MASS 20.0 // in kg
+#define SPAWNED_RIDER_SPACING 0.45 // in m, between the riders' centres
+#define SPAWNED_RIDER_COLUMNS 4
+#define SPAWNED_RIDER_LANDING_TIME 2.0 // in s (sim time); spawned riders come to rest on the car floor before the rides
+#define DEFAULT_RIDER_HEIGHT 0.5 // in m, above the car model's origin
+
+#define SPAWNED_PAYLOAD_NAME "ride_benchmark_payload"
+#define SPAWNED_PAYLOAD_SIZE 0.4 // in m; the payload is one cube in the middle of the car
+
+/*
+
+Ride benchmark, against a running world:
+	Sends one elevator through a sequence of floors and samples the car and its riders from /gazebo/model_states, which
+	gazebo_ros publishes every physics step. For each ride, it reports:
+		step time: wall time per physics step over the ride, and the real time factor
+		smoothness: peak & RMS vertical acceleration and peak jerk of the car and of each rider, and the largest
+		horizontal drift & tilt of the car
+		arrival: ride time, the final height of the car, and how far it overshot that height
+
+	Accelerations are finite differences of the sampled velocities, so a pose reset or a velocity jump on the car
+	shows up as a spike. Run it on the same world with different builds or settings (e.g. <attach_riders>) to compare.
+
+	Riders are robots already in the car (--rider), and / or cubes the benchmark spawns in the car (--spawn-riders)
+	and deletes afterwards. With --sweep, the rides are repeated with 1, 2, ... spawned riders, and the step time for
+	each rider count is summed up at the end: the solver load the riders add.
+
+	With --payloads, the rides are repeated with a cube of each given mass (in kg; 0 for none) in the car, and the ride
+	time & overshoot for each load are summed up at the end. The cube only counts as payload if the elevator lists it
+	in <payload_models>; leave it out to see the car without payload compensation.
+
+*/
+
+namespace po = boost::program_options;
+
+struct MotionStats
+{
+	std::string name;
+	int index; // in the model states; -1 if not found yet
+	double prevVel, prevAccel, prevTime;
+	int numSamples;
+	double peakAccel, sumSqAccel, peakJerk;
+};
+
+struct RideResult
+{
+	double stepTime; // in ms
+	double realTimeFactor;
+	double peakRiderAccel; // over all riders, in m/s^2
+	double rideTime; // in s, until the car came to rest at the floor
+	double overshoot; // in m, past the final height in the direction of travel
+};
+
+class RideBenchmark
+{
+	private:
+
+		ros::NodeHandle nh;
+		ros::Subscriber states_sub, floor_sub;
+
+		MotionStats car;
+		std::vector<MotionStats> riders;
+		double startX, startY, peakDrift, peakTilt;
+		double startHeight, minHeight, maxHeight, height, vertVel;
+		bool hasStart;
+		int estimatedFloor;
+
+	public:
+
+		RideBenchmark(const std::string &elevatorName) : estimatedFloor(-1)
+		{
+			car.name = elevatorName;
+			car.index = -1;
+
+			states_sub = nh.subscribe<gazebo_msgs::ModelStates>("/gazebo/model_states", 100, &RideBenchmark::states_cb, this);
+			floor_sub = nh.subscribe<std_msgs::Int32>("/elevator_controller/" + elevatorName + "/estimated_current_floor", 10, &RideBenchmark::floor_cb, this);
+		}
+
+		void setRiders(const std::vector<std::string> &names)
+		{
+			riders.resize(names.size());
+
+			for (size_t i=0; i<names.size(); i++) {
+				riders[i].name = names[i];
+				riders[i].index = -1;
+			}
+		}
+
+		// Returns false if the car didn't come to rest at the floor in time
+		bool ride(dynamic_gazebo_models::DynamicsClient &client, int floor, double settleTime, double timeout, double timeStep, RideResult &result)
+		{
+			resetStats();
+
+			ros::Time simStart = ros::Time::now();
+			ros::WallTime wallStart = ros::WallTime::now();
+			ros::Time restStart;
+			bool isAtRest = false;
+
+			if (!client.gotoFloor(BENCHMARK_GROUP, floor)) {
+				std::cerr << "Couldn't send the elevator to floor " << floor << std::endl;
+				return false;
+			}
+
+			while (ros::ok()) {
+				ros::spinOnce();
+				ros::WallDuration(0.001).sleep();
+
+				ros::Time now = ros::Time::now();
+
+				if ((now - simStart).toSec() > timeout) {
+					std::cerr << "Floor " << floor << ": the car didn't arrive within " << timeout << " s" << std::endl;
+					return false;
+				}
+
+				bool atRest = hasStart && estimatedFloor == floor && fabs(vertVel) < REST_SPEED;
+
+				if (atRest && !isAtRest) {
+					restStart = now;
+				}
+
+				isAtRest = atRest;
+
+				if (isAtRest && (now - restStart).toSec() >= settleTime) {
+					break;
+				}
+			}
+
+			double simElapsed = (ros::Time::now() - simStart).toSec();
+			double wallElapsed = (ros::WallTime::now() - wallStart).toSec();
+			double numSteps = simElapsed / timeStep;
+
+			result.stepTime = numSteps > 0 ? wallElapsed * 1000 / numSteps : 0;
+			result.realTimeFactor = wallElapsed > 0 ? simElapsed / wallElapsed : 0;
+			result.peakRiderAccel = 0;
+			result.rideTime = simElapsed - settleTime;
+			result.overshoot = height > startHeight ? maxHeight - height : height - minHeight;
+
+			printf("floor %3d: ride %6.2f s, final height %8.4f m, overshoot %.4f m | step %6.3f ms (RTF %5.2f) | drift %.5f m, tilt %.5f rad\n",
+				floor, result.rideTime, height, result.overshoot, result.stepTime, result.realTimeFactor, peakDrift, peakTilt);
+
+			printMotion(car);
+
+			for (size_t i=0; i<riders.size(); i++) {
+				printMotion(riders[i]);
+				result.peakRiderAccel = std::max(result.peakRiderAccel, riders[i].peakAccel);
+			}
+
+			return true;
+		}
+
+		// Waits for the given sim time, while keeping the model states coming in
+		void wait(double duration)
+		{
+			ros::Time start = ros::Time::now();
+
+			while (ros::ok() && (ros::Time::now() - start).toSec() < duration) {
+				ros::spinOnce();
+				ros::WallDuration(0.001).sleep();
+			}
+		}
+
+	private:
+
+		void resetStats()
+		{
+			resetMotion(car);
+
+			for (size_t i=0; i<riders.size(); i++) {
+				resetMotion(riders[i]);
+			}
+
+			peakDrift = peakTilt = 0;
+			vertVel = 0;
+			hasStart = false;
+		}
+
+		static void resetMotion(MotionStats &motion)
+		{
+			motion.prevTime = -1;
+			motion.numSamples = 0;
+			motion.peakAccel = motion.sumSqAccel = motion.peakJerk = 0;
+		}
+
+		static void printMotion(const MotionStats &motion)
+		{
+			if (motion.index < 0) {
+				printf("    %-24s not found in the model states\n", motion.name.c_str());
+				return;
+			}
+
+			printf("    %-24s accel peak %7.3f m/s^2, rms %7.3f m/s^2 | jerk peak %9.2f m/s^3\n", motion.name.c_str(), motion.peakAccel,
+				motion.numSamples > 0 ? sqrt(motion.sumSqAccel / motion.numSamples) : 0.0, motion.peakJerk);
+		}
+
+		static int findModel(const gazebo_msgs::ModelStates &states, const std::string &name, int cached)
+		{
+			if (cached >= 0 && cached < (int) states.name.size() && states.name[cached] == name) {
+				return cached;
+			}
+
+			for (size_t i=0; i<states.name.size(); i++) {
+				if (states.name[i] == name) {
+					return i;
+				}
+			}
+
+			return -1;
+		}
+
+		static void sample(MotionStats &motion, double vel, double time)
+		{
+			if (motion.prevTime < 0) {
+				motion.prevVel = vel;
+				motion.prevAccel = 0;
+				motion.prevTime = time;
+				return;
+			}
+
+			double dt = time - motion.prevTime;
+
+			if (dt <= 0) {
+				return; // same step
+			}
+
+			double accel = (vel - motion.prevVel) / dt;
+			double jerk = (accel - motion.prevAccel) / dt;
+
+			motion.peakAccel = std::max(motion.peakAccel, fabs(accel));
+			motion.sumSqAccel += accel * accel;
+			motion.peakJerk = motion.numSamples > 0 ? std::max(motion.peakJerk, fabs(jerk)) : 0; // the first jerk has no previous accel
+			motion.numSamples++;
+
+			motion.prevVel = vel;
+			motion.prevAccel = accel;
+			motion.prevTime = time;
+		}
+
+		void states_cb(const gazebo_msgs::ModelStates::ConstPtr &states)
+		{
+			double time = ros::Time::now().toSec();
+
+			car.index = findModel(*states, car.name, car.index);
+
+			if (car.index < 0) {
+				return;
+			}
+
+			const geometry_msgs::Pose &pose = states->pose[car.index];
+
+			if (!hasStart) {
+				startX = pose.position.x;
+				startY = pose.position.y;
+				startHeight = minHeight = maxHeight = pose.position.z;
+				hasStart = true;
+			}
+
+			height = pose.position.z;
+			minHeight = std::min(minHeight, height);
+			maxHeight = std::max(maxHeight, height);
+			vertVel = states->twist[car.index].linear.z;
+			peakDrift = std::max(peakDrift, hypot(pose.position.x - startX, pose.position.y - startY));
+			peakTilt = std::max(peakTilt, 2 * asin(std::min(1.0, sqrt(pose.orientation.x * pose.orientation.x + pose.orientation.y * pose.orientation.y))));
+
+			sample(car, vertVel, time);
+
+			for (size_t i=0; i<riders.size(); i++) {
+				riders[i].index = findModel(*states, riders[i].name, riders[i].index);
+
+				if (riders[i].index >= 0) {
+					sample(riders[i], states->twist[riders[i].index].linear.z, time);
+				}
+			}
+		}
+
+		void floor_cb(const std_msgs::Int32::ConstPtr &msg)
+		{
+			estimatedFloor = msg->data;
+		}
+};
+
+static std::string cubeSdf(double size, double mass)
+{
+	std::ostringstream sdf;
+	double inertia = mass * size * size / 6;
+
+	sdf << "<sdf version='1.4'><model name='cube'><link name='body'>"
+		<< "<inertial><mass>" << mass << "</mass><inertia><ixx>" << inertia << "</ixx><iyy>" << inertia << "</iyy><izz>" << inertia
+		<< "</izz><ixy>0</ixy><ixz>0</ixz><iyz>0</iyz></inertia></inertial>"
+		<< "<collision name='collision'><geometry><box><size>" << size << " " << size << " " << size << "</size></box></geometry></collision>"
+		<< "<visual name='visual'><geometry><box><size>" << size << " " << size << " " << size << "</size></box></geometry></visual>"
+		<< "</link></model></sdf>";
+
+	return sdf.str();
+}
+
+static bool getCarPose(const std::string &elevatorName, geometry_msgs::Pose &pose)
+{
+	gazebo_msgs::GetModelState carState;
+	carState.request.model_name = elevatorName;
+
+	if (!ros::service::call("/gazebo/get_model_state", carState) || !carState.response.success) {
+		std::cerr << "Couldn't find the elevator '" << elevatorName << "'" << std::endl;
+		return false;
+	}
+
+	pose = carState.response.pose;
+	return true;
+}
+
+// Spawns the riders in a grid around the centre of the car; returns false (with the spawned ones in names) on failure
+static bool spawnRiders(const std::string &elevatorName, int numRiders, double riderHeight, std::vector<std::string> &names)
+{
+	geometry_msgs::Pose carPose;
+
+	if (!getCarPose(elevatorName, carPose)) {
+		return false;
+	}
+
+	int numRows = (numRiders + SPAWNED_RIDER_COLUMNS - 1) / SPAWNED_RIDER_COLUMNS;
+	int numColumns = std::min(numRiders, SPAWNED_RIDER_COLUMNS);
+
+	for (int i=0; i<numRiders; i++) {
+		std::ostringstream name;
+		name << SPAWNED_RIDER_PREFIX << i;
+
+		gazebo_msgs::SpawnModel spawn;
+		spawn.request.model_name = name.str();
+		spawn.request.model_xml = cubeSdf(SPAWNED_RIDER_SIZE, SPAWNED_RIDER_MASS);
+		spawn.request.initial_pose.position.x = carPose.position.x + (i % SPAWNED_RIDER_COLUMNS - (numColumns - 1) / 2.0) * SPAWNED_RIDER_SPACING;
+		spawn.request.initial_pose.position.y = carPose.position.y + (i / SPAWNED_RIDER_COLUMNS - (numRows - 1) / 2.0) * SPAWNED_RIDER_SPACING;
+		spawn.request.initial_pose.position.z = carPose.position.z + riderHeight;
+		spawn.request.initial_pose.orientation.w = 1;
+
+		if (!ros::service::call("/gazebo/spawn_sdf_model", spawn) || !spawn.response.success) {
+			std::cerr << "Couldn't spawn the rider '" << name.str() << "'" << std::endl;
+			return false;
+		}
+
+		names.push_back(name.str());
+	}
+
+	return true;
+}
+
+// Spawns a cube of the given mass in the middle of the car
+static bool spawnPayload(const std::string &elevatorName, double mass, double height)
+{
+	geometry_msgs::Pose carPose;
+
+	if (!getCarPose(elevatorName, carPose)) {
+		return false;
+	}
+
+	gazebo_msgs::SpawnModel spawn;
+	spawn.request.model_name = SPAWNED_PAYLOAD_NAME;
+	spawn.request.model_xml = cubeSdf(SPAWNED_PAYLOAD_SIZE, mass);
+	spawn.request.initial_pose.position = carPose.position;
+	spawn.request.initial_pose.position.z += height;
+	spawn.request.initial_pose.orientation.w = 1;
+
+	if (!ros::service::call("/gazebo/spawn_sdf_model", spawn) || !spawn.response.success) {
+		std::cerr << "Couldn't spawn the payload '" << SPAWNED_PAYLOAD_NAME << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+static void deleteRiders(const std::vector<std::string> &names)
+{
+	for (size_t i=0; i<names.size(); i++) {
+		gazebo_msgs::DeleteModel remove;
+		remove.request.model_name = names[i];
+		ros::service::call("/gazebo/delete_model", remove);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "ride_benchmark", ros::init_options::AnonymousName); // takes out the ROS arguments first
+
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("elevator,e", po::value<std::string>()->default_value("elevator_0"), "model name of the elevator")
+		("unit,u", po::value<uint32_t>()->default_value(0), "unit id of the elevator")
+		("floors,f", po::value<std::vector<int> >()->multitoken()->required(), "floors to ride to, in order")
+		("rider,r", po::value<std::vector<std::string> >()->multitoken(), "model names of robots riding the car")
+		("spawn-riders", po::value<int>()->default_value(0), "number of cubes to spawn in the car as riders")
+		("sweep", "repeat the rides with 1, 2, ... spawn-riders riders")
+		("payloads", po::value<std::vector<double> >()->multitoken(), "repeat the rides with a payload cube of each mass in the car, in kg (0 for none)")
+		("rider-height", po::value<double>()->default_value(DEFAULT_RIDER_HEIGHT), "spawn height of the riders above the car model's origin, in m")
+		("settle", po::value<double>()->default_value(DEFAULT_SETTLE_TIME), "time the car must stay at rest at a floor, in s")
+		("timeout", po::value<double>()->default_value(DEFAULT_RIDE_TIMEOUT), "time limit of a ride, in s");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+
+		if (args.count("help")) {
+			std::cout << options << std::endl;
+			return EXIT_SUCCESS;
+		}
+
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ros::NodeHandle nh;
+	gazebo_msgs::GetPhysicsProperties physics;
+
+	if (!ros::service::waitForService("/gazebo/get_physics_properties", ros::Duration(10)) || !ros::service::call("/gazebo/get_physics_properties", physics)) {
+		std::cerr << "Couldn't get the physics properties from Gazebo" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	dynamic_gazebo_models::DynamicsClient client;
+	std::vector<uint32_t> units(1, args["unit"].as<uint32_t>());
+
+	if (!client.addGroup(BENCHMARK_GROUP, "elevator", units)) {
+		std::cerr << "Couldn't add the elevator to a control group (is the dynamics manager running?)" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string elevatorName = args["elevator"].as<std::string>();
+	std::vector<std::string> robots = args.count("rider") ? args["rider"].as<std::vector<std::string> >() : std::vector<std::string>();
+	std::vector<int> floors = args["floors"].as<std::vector<int> >();
+
+	int maxSpawned = args["spawn-riders"].as<int>();
+	int minSpawned = args.count("sweep") && maxSpawned > 0 ? 1 : maxSpawned;
+	std::vector<double> payloads = args.count("payloads") ? args["payloads"].as<std::vector<double> >() : std::vector<double>(1, 0.0);
+
+	if (args.count("payloads") && maxSpawned > 0) {
+		std::cerr << "--payloads can't be combined with --spawn-riders: the payload takes the middle of the car" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (*std::min_element(payloads.begin(), payloads.end()) < 0) {
+		std::cerr << "--payloads must not be negative" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	RideBenchmark benchmark(elevatorName);
+	std::vector<std::string> summary;
+	int result = EXIT_SUCCESS;
+
+	// one of the two sweeps runs at most, since they can't be combined:
+	for (size_t load=0; load<payloads.size() && result == EXIT_SUCCESS; load++)
+	for (int numSpawned = minSpawned; numSpawned <= maxSpawned && result == EXIT_SUCCESS; numSpawned++) {
+		std::vector<std::string> spawned;
+
+		if (payloads[load] > 0) {
+			printf("--- %.1f kg payload\n", payloads[load]);
+
+			if (!spawnPayload(elevatorName, payloads[load], args["rider-height"].as<double>())) {
+				result = EXIT_FAILURE;
+				break;
+			}
+
+			spawned.push_back(SPAWNED_PAYLOAD_NAME);
+			benchmark.wait(SPAWNED_RIDER_LANDING_TIME);
+		} else if (args.count("payloads")) {
+			printf("--- no payload\n");
+		}
+
+		if (numSpawned > 0) {
+			printf("--- %d spawned riders\n", numSpawned);
+
+			if (!spawnRiders(elevatorName, numSpawned, args["rider-height"].as<double>(), spawned)) {
+				deleteRiders(spawned);
+				result = EXIT_FAILURE;
+				break;
+			}
+
+			benchmark.wait(SPAWNED_RIDER_LANDING_TIME);
+		}
+
+		std::vector<std::string> riders = robots;
+		riders.insert(riders.end(), spawned.begin(), spawned.end());
+		benchmark.setRiders(riders);
+
+		double totalStepTime = 0, minRealTimeFactor = 0, peakRiderAccel = 0, totalRideTime = 0, peakOvershoot = 0;
+
+		for (size_t i=0; i<floors.size(); i++) {
+			RideResult ride;
+
+			if (!benchmark.ride(client, floors[i], args["settle"].as<double>(), args["timeout"].as<double>(), physics.response.time_step, ride)) {
+				result = EXIT_FAILURE;
+				break;
+			}
+
+			totalStepTime += ride.stepTime;
+			minRealTimeFactor = i == 0 ? ride.realTimeFactor : std::min(minRealTimeFactor, ride.realTimeFactor);
+			peakRiderAccel = std::max(peakRiderAccel, ride.peakRiderAccel);
+			totalRideTime += ride.rideTime;
+			peakOvershoot = std::max(peakOvershoot, ride.overshoot);
+		}
+
+		deleteRiders(spawned);
+
+		if (result == EXIT_SUCCESS) {
+			char line[160];
+			snprintf(line, sizeof(line), "%12.1f %7zu %14.3f %12.2f %24.3f %13.2f %18.4f", payloads[load], riders.size(),
+				totalStepTime / floors.size(), minRealTimeFactor, peakRiderAccel, totalRideTime / floors.size(), peakOvershoot);
+			summary.push_back(line);
+		}
+	}
+
+	if (summary.size() > 1) {
+		printf("\npayload (kg)  riders   mean step (ms)   lowest RTF   peak rider accel (m/s^2)  mean ride (s)  peak overshoot (m)\n");
+
+		for (size_t i=0; i<summary.size(); i++) {
+			printf("%s\n", summary[i].c_str());
+		}
+	}
+
+	client.deleteGroup(BENCHMARK_GROUP);
+	return result;
+}
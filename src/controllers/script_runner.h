@@ -0,0 +1,335 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_SCRIPT_RUNNER_H
+#define DYNAMIC_GAZEBO_MODELS_SCRIPT_RUNNER_H
+
+#include <deque>
+#include <iostream>
+#include <stdio.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <ros/ros.h>
+
+#include <dynamic_gazebo_models/dynamics_client.h>
+
+#define DEFAULT_SCRIPT_WORKERS 4
+
+/*
+
+Command language of keyboard_op (one command per line, '#' starts a comment):
+	group <name> <door|elevator> <unit,unit,..>   create a control group
+	delete <name>                                 delete a control group
+	add_units <name> <unit,unit,..>               add units to a group
+	remove_units <name> <unit,unit,..>            remove units from a group
+	open <name> | close <name>                    open / close the doors of a group
+	vel <name> <linear> <angular>                 set the door velocities of a group
+	opening <name> <0..1>                         move the doors of a group to an opening (0: closed, 1: open)
+	floor <name> <floor>                          send the elevators of a group to a floor
+	elev_open <name> | elev_close <name>          force the elevator doors of a group open / closed
+	props <name> <speed> <force>                  set the speed & force of the elevators of a group
+	list [prefix]                                 list groups (unit counts only)
+	wait                                          wait until every queued command is done
+
+	Commands run asynchronously on a pool of workers, each with its own DynamicsClient (persistent connections). Commands
+	naming the same group always go to the same worker, so they run in order; different groups run in parallel.
+	Every command prints '<line> <ok|FAILED> <latency in ms> <command>' once its call returns.
+
+*/
+
+struct ScriptCommand
+{
+	size_t line;
+	std::string text;
+	std::vector<std::string> args;
+};
+
+class ScriptRunner
+{
+	private:
+
+		struct Worker
+		{
+			boost::thread thread;
+			boost::mutex mutex;
+			boost::condition_variable hasWork;
+			std::deque<ScriptCommand> queue;
+			bool isStopping;
+
+			dynamic_gazebo_models::DynamicsClient client; // only used by this worker's thread
+
+			Worker(const ros::NodeHandle &nh) : isStopping(false), client(nh) {}
+		};
+
+		ros::NodeHandle rosNode;
+		std::vector<Worker*> workers;
+
+		boost::mutex pendingMutex, outputMutex;
+		boost::condition_variable isIdle;
+		size_t numPending, numDone, numFailed;
+
+	public:
+
+		ScriptRunner(ros::NodeHandle &nh, int numWorkers) : rosNode(nh), numPending(0), numDone(0), numFailed(0)
+		{
+			if (numWorkers < 1) {
+				numWorkers = 1;
+			}
+
+			for (int i=0; i<numWorkers; i++) {
+				Worker *worker = new Worker(rosNode);
+				worker->thread = boost::thread(boost::bind(&ScriptRunner::workerLoop, this, worker));
+				workers.push_back(worker);
+			}
+		}
+
+		~ScriptRunner()
+		{
+			for (size_t i=0; i<workers.size(); i++) {
+				{
+					boost::mutex::scoped_lock lock(workers[i]->mutex);
+					workers[i]->isStopping = true;
+				}
+
+				workers[i]->hasWork.notify_one();
+				workers[i]->thread.join();
+				delete workers[i];
+			}
+		}
+
+		// Returns EXIT_SUCCESS if every command succeeded
+		int run(std::istream &input)
+		{
+			ros::WallTime start = ros::WallTime::now();
+			std::string line;
+			size_t lineNum = 0;
+
+			while (ros::ok() && std::getline(input, line)) {
+				lineNum++;
+
+				ScriptCommand cmd;
+				cmd.line = lineNum;
+
+				if (!parseLine(line, cmd)) {
+					continue; // blank line or comment
+				}
+
+				if (cmd.args[0] == "wait") {
+					waitIdle();
+				} else if (!isKnownCommand(cmd.args[0])) {
+					report(cmd, false, 0.0);
+				} else {
+					enqueue(cmd);
+				}
+			}
+
+			waitIdle();
+
+			double elapsed = (ros::WallTime::now() - start).toSec();
+			fprintf(stderr, "%zu commands, %zu failed, %.3f s (%.1f commands/s)\n", numDone, numFailed, elapsed, elapsed > 0 ? numDone / elapsed : 0.0);
+
+			return numFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+	private:
+
+		bool parseLine(const std::string &line, ScriptCommand &cmd)
+		{
+			cmd.text = line.substr(0, line.find('#'));
+			boost::trim(cmd.text);
+
+			if (cmd.text.empty()) {
+				return false;
+			}
+
+			boost::split(cmd.args, cmd.text, boost::is_any_of(" \t"), boost::token_compress_on);
+			return true;
+		}
+
+		bool isKnownCommand(const std::string &name)
+		{
+			static const char *names[] = {"group", "delete", "add_units", "remove_units", "open", "close", "vel", "opening", "floor", "elev_open", "elev_close", "props", "list"};
+
+			for (size_t i=0; i<sizeof(names) / sizeof(names[0]); i++) {
+				if (name == names[i]) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void enqueue(const ScriptCommand &cmd)
+		{
+			{
+				boost::mutex::scoped_lock lock(pendingMutex);
+				numPending++;
+			}
+
+			// commands on the same group share a worker, so they keep their order:
+			size_t workerIndex = cmd.args.size() > 1 ? boost::hash<std::string>()(cmd.args[1]) % workers.size() : 0;
+			Worker *worker = workers[workerIndex];
+
+			{
+				boost::mutex::scoped_lock lock(worker->mutex);
+				worker->queue.push_back(cmd);
+			}
+
+			worker->hasWork.notify_one();
+		}
+
+		void waitIdle()
+		{
+			boost::mutex::scoped_lock lock(pendingMutex);
+
+			while (numPending > 0) {
+				isIdle.wait(lock);
+			}
+		}
+
+		void workerLoop(Worker *worker)
+		{
+			while (true) {
+				ScriptCommand cmd;
+
+				{
+					boost::mutex::scoped_lock lock(worker->mutex);
+
+					while (worker->queue.empty() && !worker->isStopping) {
+						worker->hasWork.wait(lock);
+					}
+
+					if (worker->queue.empty()) {
+						return; // stopping
+					}
+
+					cmd = worker->queue.front();
+					worker->queue.pop_front();
+				}
+
+				ros::WallTime start = ros::WallTime::now();
+				bool isSuccess = execute(*worker, cmd);
+				report(cmd, isSuccess, (ros::WallTime::now() - start).toSec() * 1000.0);
+
+				boost::mutex::scoped_lock lock(pendingMutex);
+				if (--numPending == 0) {
+					isIdle.notify_all();
+				}
+			}
+		}
+
+		void report(const ScriptCommand &cmd, bool isSuccess, double latency)
+		{
+			boost::mutex::scoped_lock lock(outputMutex);
+
+			numDone++;
+			numFailed += isSuccess ? 0 : 1;
+
+			printf("%zu\t%s\t%.3f\t%s\n", cmd.line, isSuccess ? "ok" : "FAILED", latency, cmd.text.c_str());
+			fflush(stdout);
+		}
+
+		bool execute(Worker &worker, const ScriptCommand &cmd)
+		{
+			const std::vector<std::string> &args = cmd.args;
+
+			dynamic_gazebo_models::DynamicsClient &client = worker.client;
+
+			try {
+				if (args[0] == "group" && args.size() == 4) {
+					return client.addGroup(args[1], args[2], parseUnits(args[3]));
+				} else if (args[0] == "delete" && args.size() == 2) {
+					return client.deleteGroup(args[1]);
+				} else if (args[0] == "add_units" && args.size() == 3) {
+					return client.addUnits(args[1], parseUnits(args[2]));
+				} else if (args[0] == "remove_units" && args.size() == 3) {
+					return client.removeUnits(args[1], parseUnits(args[2]));
+				} else if (args[0] == "open" && args.size() == 2) {
+					return client.openDoors(args[1]);
+				} else if (args[0] == "close" && args.size() == 2) {
+					return client.closeDoors(args[1]);
+				} else if (args[0] == "vel" && args.size() == 4) {
+					return client.setDoorVel(args[1], boost::lexical_cast<float>(args[2]), boost::lexical_cast<float>(args[3]));
+				} else if (args[0] == "opening" && args.size() == 3) {
+					return client.setDoorOpening(args[1], boost::lexical_cast<float>(args[2]));
+				} else if (args[0] == "floor" && args.size() == 3) {
+					return client.gotoFloor(args[1], boost::lexical_cast<int>(args[2]));
+				} else if (args[0] == "elev_open" && args.size() == 2) {
+					return client.openElevDoors(args[1]);
+				} else if (args[0] == "elev_close" && args.size() == 2) {
+					return client.closeElevDoors(args[1]);
+				} else if (args[0] == "props" && args.size() == 4) {
+					return client.setElevProps(args[1], boost::lexical_cast<float>(args[2]), boost::lexical_cast<float>(args[3]));
+				} else if (args[0] == "list" && args.size() <= 2) {
+					return list(client, args.size() == 2 ? args[1] : "");
+				}
+			} catch (boost::bad_lexical_cast &e) {
+				// invalid number: falls through to the syntax error below
+			}
+
+			boost::mutex::scoped_lock lock(outputMutex);
+			fprintf(stderr, "line %zu: invalid arguments for '%s'\n", cmd.line, args[0].c_str());
+
+			return false;
+		}
+
+		bool list(dynamic_gazebo_models::DynamicsClient &client, const std::string &prefix)
+		{
+			dynamic_gazebo_models::ListGroups::Request req;
+			dynamic_gazebo_models::ListGroups::Response res;
+			req.prefix = prefix;
+			req.omit_units = true;
+
+			if (!client.listGroups(req, res)) {
+				return false;
+			}
+
+			boost::mutex::scoped_lock lock(outputMutex);
+
+			for (size_t i=0; i<res.groups.size(); i++) {
+				printf("  %s (%s): %u units\n", res.groups[i].group_name.c_str(), res.groups[i].type.c_str(), res.unit_counts[i]);
+			}
+
+			return true;
+		}
+
+		std::vector<uint32_t> parseUnits(const std::string &csv)
+		{
+			std::vector<std::string> tokens;
+			boost::split(tokens, csv, boost::is_any_of(","), boost::token_compress_on);
+
+			std::vector<uint32_t> units;
+
+			for (size_t i=0; i<tokens.size(); i++) {
+				if (!tokens[i].empty()) {
+					units.push_back(boost::lexical_cast<uint32_t>(tokens[i]));
+				}
+			}
+
+			return units;
+		}
+};
+
+#endif
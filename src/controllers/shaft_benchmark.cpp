@@ -0,0 +1,417 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <deque>
+#include <boost/program_options.hpp>
+
+#include "../plugins/shaft_coordinator.h"
+
+#define DEFAULT_NUM_FLOORS 20
+#define DEFAULT_FLOOR_SPACING 3.5 // in m
+#define DEFAULT_CAR_HEIGHT 3.0 // in m, above the car's reference point (its floor)
+#define DEFAULT_SPEED 1.5 // in m/s
+#define DEFAULT_DWELL 10.0 // in s, at each stop
+#define DEFAULT_NUM_TRIPS 500
+#define DEFAULT_ARRIVAL_RATE 0.05 // in trips/s; saturates a single car with the defaults
+
+#define TIME_STEP 0.01 // in s
+#define MAX_SIM_TIME 86400 // in s
+
+/*
+
+Trace-driven throughput of one shaft:
+	Replays a trace of trips (request time, origin floor, destination floor) through a shaft with one car, and
+	through the same shaft with several cars run by the ShaftCoordinator, and reports trips per hour for both.
+
+	Cars move kinematically at a fixed speed and stop for a fixed dwell time at each origin and destination. Car i is
+	below car i+1, and the cars can't get closer than the car height plus the clearance, so the lowest car can't reach
+	the top floors, and so on. So that every car still serves every floor, the shaft has parking stops below the lowest
+	and above the highest floor for the cars that are out of the way (as TWIN shafts do). A free car takes the oldest waiting trip that it can serve and that stays clear of the
+	trips of the other cars; the coordinator keeps the cars apart on the way (parking idle cars that are in the way).
+
+	Trace file: one trip per line, "time origin destination" (in s, floors from 0). Without a trace, a random one
+	(uniform floors, Poisson arrivals) is generated.
+
+*/
+
+using namespace gazebo;
+namespace po = boost::program_options;
+
+struct Trip
+{
+	double requestTime;
+	int origin, destination;
+};
+
+struct SimCar
+{
+	ShaftCar car;
+	std::vector<float> floorHeights;
+	int firstFloor; // floorHeights[0] is this floor of the building
+
+	bool hasTrip, isDropping, isParking, isServed; // isServed: the car has reached the origin
+	Trip trip;
+	double dwellLeft;
+};
+
+struct SimResult
+{
+	int completedTrips;
+	double duration, totalWait; // in s
+	int conflicts;
+};
+
+class ShaftBenchmark
+{
+	private:
+		int numFloors, separation; // floors between two neighbouring cars
+		int shaftFloors, offset; // stops of the shaft including the parking ones, and those below floor 0
+		float floorSpacing, carHeight, speed, dwell, clearance;
+
+	public:
+		ShaftBenchmark(int numFloors, float floorSpacing, float carHeight, float speed, float dwell, float clearance) :
+			numFloors(numFloors), floorSpacing(floorSpacing), carHeight(carHeight), speed(speed), dwell(dwell), clearance(clearance)
+		{
+			separation = ceil((carHeight + clearance) / floorSpacing - SHAFT_LEVEL_TOLERANCE);
+		}
+
+		SimResult run(const std::vector<Trip> &trace, int numCars)
+		{
+			std::vector<SimCar> cars(numCars);
+			std::string shaftName = numCars == 1 ? "single" : "shared";
+
+			offset = (numCars - 1) * separation;
+			shaftFloors = numFloors + 2 * offset;
+
+			for (int i=0; i<numCars; i++) {
+				initCar(cars[i], i, numCars);
+			}
+
+			for (int i=0; i<numCars; i++) {
+				ShaftCoordinator::instance().add(shaftName, &cars[i].car, clearance);
+			}
+
+			SimResult result = {0, 0, 0, 0};
+			std::deque<Trip> waiting;
+			size_t nextTrip = 0;
+			uint64_t step = 0;
+			double time = 0;
+
+			while ((nextTrip < trace.size() || !waiting.empty() || anyBusy(cars)) && time < MAX_SIM_TIME) {
+				while (nextTrip < trace.size() && trace[nextTrip].requestTime <= time) {
+					waiting.push_back(trace[nextTrip++]);
+				}
+
+				for (int i=0; i<numCars; i++) {
+					SimCar &sim = cars[i];
+
+					if (!sim.hasTrip) {
+						assignTrip(cars, i, waiting, step);
+					}
+
+					if (sim.car.parkingFloor != NO_PARKING_FLOOR) {
+						// made way for a neighbour; a trip leg is resumed once the car has parked
+						setTarget(sim, sim.firstFloor + sim.car.parkingFloor, step);
+						sim.car.parkingFloor = NO_PARKING_FLOOR;
+						sim.isParking = true;
+						sim.dwellLeft = dwell;
+					} else if (sim.isParking) {
+						sim.isParking = !sim.car.isIdle();
+					} else if (sim.hasTrip) {
+						advanceTrip(sim, time, step, result);
+					}
+
+					float target = ShaftCoordinator::instance().clampTarget(shaftName, &sim.car);
+					float move = std::max(-speed * (float) TIME_STEP, std::min(speed * (float) TIME_STEP, target - sim.car.height));
+					sim.car.height += move;
+				}
+
+				result.conflicts += countConflicts(cars);
+				time += TIME_STEP;
+				step++;
+			}
+
+			for (int i=0; i<numCars; i++) {
+				ShaftCoordinator::instance().remove(shaftName, &cars[i].car);
+			}
+
+			result.duration = time;
+			return result;
+		}
+
+	private:
+
+		// in stops of the shaft
+		void initCar(SimCar &sim, int index, int numCars)
+		{
+			sim.firstFloor = index * separation;
+
+			for (int floor = sim.firstFloor; floor <= lastFloor(index, numCars); floor++) {
+				sim.floorHeights.push_back(floor * floorSpacing);
+			}
+
+			sim.car.height = sim.car.targetHeight = sim.firstFloor * floorSpacing;
+			sim.car.below = 0;
+			sim.car.above = carHeight;
+			sim.car.floorHeights = &sim.floorHeights;
+			sim.car.requestIteration = 0;
+			sim.car.parkingFloor = NO_PARKING_FLOOR;
+
+			sim.hasTrip = sim.isParking = false;
+			sim.dwellLeft = 0;
+		}
+
+		int lastFloor(int index, int numCars)
+		{
+			return shaftFloors - 1 - (numCars - 1 - index) * separation;
+		}
+
+		void setTarget(SimCar &sim, int floor, uint64_t step)
+		{
+			sim.car.targetHeight = floor * floorSpacing;
+			sim.car.requestIteration = step;
+		}
+
+		// Picks up, then drops off, waiting for the dwell time at both stops
+		void advanceTrip(SimCar &sim, double time, uint64_t step, SimResult &result)
+		{
+			int legFloor = sim.isDropping ? sim.trip.destination : sim.trip.origin;
+
+			if (fabs(sim.car.targetHeight - legFloor * floorSpacing) > SHAFT_LEVEL_TOLERANCE) {
+				setTarget(sim, legFloor, step); // back from parking
+			}
+
+			if (!sim.car.isIdle()) {
+				return;
+			}
+
+			if (!sim.isServed) {
+				result.totalWait += time - sim.trip.requestTime;
+				sim.isServed = true;
+			}
+
+			sim.dwellLeft -= TIME_STEP;
+
+			if (sim.dwellLeft > 0) {
+				return;
+			}
+
+			if (sim.isDropping) {
+				sim.hasTrip = false;
+				result.completedTrips++;
+			} else {
+				sim.isDropping = true;
+				sim.dwellLeft = dwell;
+				setTarget(sim, sim.trip.destination, step);
+			}
+		}
+
+		void assignTrip(std::vector<SimCar> &cars, int index, std::deque<Trip> &waiting, uint64_t step)
+		{
+			SimCar &sim = cars[index];
+
+			for (std::deque<Trip>::iterator it = waiting.begin(); it != waiting.end(); ++it) {
+				if (!canServe(cars, index, *it)) {
+					continue;
+				}
+
+				sim.trip = *it;
+				sim.trip.origin += offset;
+				sim.trip.destination += offset;
+				sim.hasTrip = true;
+				sim.isDropping = sim.isServed = false;
+				sim.dwellLeft = dwell;
+				setTarget(sim, sim.trip.origin, step);
+
+				waiting.erase(it);
+				return;
+			}
+		}
+
+		// The trip's floors are within the car's range, and leave room for the cars in between and the busy ones
+		bool canServe(const std::vector<SimCar> &cars, int index, const Trip &trip)
+		{
+			int low = std::min(trip.origin, trip.destination) + offset;
+			int high = std::max(trip.origin, trip.destination) + offset;
+			int numCars = cars.size();
+
+			if (low < index * separation || high > lastFloor(index, numCars)) {
+				return false;
+			}
+
+			for (int i=0; i<numCars; i++) {
+				if (i == index || !cars[i].hasTrip) {
+					continue;
+				}
+
+				int otherLow = std::min(cars[i].trip.origin, cars[i].trip.destination);
+				int otherHigh = std::max(cars[i].trip.origin, cars[i].trip.destination);
+
+				if (i > index ? high + (i - index) * separation > otherLow : otherHigh + (index - i) * separation > low) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		static bool anyBusy(const std::vector<SimCar> &cars)
+		{
+			for (size_t i=0; i<cars.size(); i++) {
+				if (cars[i].hasTrip) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		// cars keep their order, so only neighbours can overlap
+		int countConflicts(const std::vector<SimCar> &cars)
+		{
+			int conflicts = 0;
+
+			for (size_t i=1; i<cars.size(); i++) {
+				const ShaftCar &lower = cars[i-1].car;
+				const ShaftCar &upper = cars[i].car;
+
+				if (lower.height + lower.above + clearance > upper.height - upper.below + SHAFT_LEVEL_TOLERANCE) {
+					conflicts++;
+				}
+			}
+
+			return conflicts;
+		}
+};
+
+static bool loadTrace(const std::string &path, int numFloors, std::vector<Trip> &trace)
+{
+	std::ifstream file(path.c_str());
+
+	if (!file) {
+		std::cerr << "Couldn't open the trace '" << path << "'" << std::endl;
+		return false;
+	}
+
+	Trip trip;
+
+	while (file >> trip.requestTime >> trip.origin >> trip.destination) {
+		if (trip.origin < 0 || trip.origin >= numFloors || trip.destination < 0 || trip.destination >= numFloors) {
+			std::cerr << "Trip at " << trip.requestTime << " s: floor out of range" << std::endl;
+			return false;
+		}
+
+		trace.push_back(trip);
+	}
+
+	return true;
+}
+
+static void generateTrace(int numTrips, double arrivalRate, int numFloors, unsigned int seed, std::vector<Trip> &trace)
+{
+	srand(seed);
+	double time = 0;
+
+	for (int i=0; i<numTrips; i++) {
+		time += -log(1.0 - rand() / (RAND_MAX + 1.0)) / arrivalRate;
+
+		Trip trip;
+		trip.requestTime = time;
+		trip.origin = rand() % numFloors;
+
+		do {
+			trip.destination = rand() % numFloors;
+		} while (trip.destination == trip.origin);
+
+		trace.push_back(trip);
+	}
+}
+
+static void printResult(const char *label, const SimResult &result)
+{
+	printf("%-12s %6d trips in %8.0f s: %7.1f trips/h, mean wait %6.1f s, %d conflicting steps\n", label, result.completedTrips, result.duration,
+		result.completedTrips * 3600.0 / result.duration, result.completedTrips > 0 ? result.totalWait / result.completedTrips : 0.0, result.conflicts);
+}
+
+int main(int argc, char** argv)
+{
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("trace,t", po::value<std::string>(), "trace file, one 'time origin destination' trip per line (default: a random trace)")
+		("cars,c", po::value<int>()->default_value(2), "number of cars in the shared shaft")
+		("floors,f", po::value<int>()->default_value(DEFAULT_NUM_FLOORS), "number of floors")
+		("spacing", po::value<float>()->default_value(DEFAULT_FLOOR_SPACING), "floor spacing in m")
+		("car-height", po::value<float>()->default_value(DEFAULT_CAR_HEIGHT), "car height in m")
+		("clearance", po::value<float>()->default_value(DEFAULT_CAR_CLEARANCE), "gap kept between two cars in m")
+		("speed", po::value<float>()->default_value(DEFAULT_SPEED), "car speed in m/s")
+		("dwell", po::value<float>()->default_value(DEFAULT_DWELL), "time spent at each stop in s")
+		("trips", po::value<int>()->default_value(DEFAULT_NUM_TRIPS), "number of trips of a random trace")
+		("rate", po::value<double>()->default_value(DEFAULT_ARRIVAL_RATE), "arrival rate of a random trace in trips/s")
+		("seed", po::value<unsigned int>()->default_value(1), "seed of a random trace");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (args.count("help")) {
+		std::cout << options << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	int numFloors = args["floors"].as<int>();
+	int numCars = args["cars"].as<int>();
+
+	if (numCars < 1) {
+		std::cerr << "The shaft needs at least one car" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Trip> trace;
+
+	if (args.count("trace")) {
+		if (!loadTrace(args["trace"].as<std::string>(), numFloors, trace)) {
+			return EXIT_FAILURE;
+		}
+	} else {
+		generateTrace(args["trips"].as<int>(), args["rate"].as<double>(), numFloors, args["seed"].as<unsigned int>(), trace);
+	}
+
+	ShaftBenchmark benchmark(numFloors, args["spacing"].as<float>(), args["car-height"].as<float>(), args["speed"].as<float>(),
+		args["dwell"].as<float>(), args["clearance"].as<float>());
+
+	printResult("single car", benchmark.run(trace, 1));
+
+	char label[32];
+	snprintf(label, sizeof(label), "%d cars", numCars);
+	printResult(label, benchmark.run(trace, numCars));
+
+	return EXIT_SUCCESS;
+}
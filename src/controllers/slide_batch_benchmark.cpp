@@ -0,0 +1,224 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <boost/program_options.hpp>
+
+#include "../plugins/slide_clamp.h"
+
+#define DEFAULT_OVERSHOOT 0.01 // fraction of the doors outside their limits in each step
+#define DEFAULT_MIN_TIME 0.2 // in s, per kernel & door count
+#define SLIDE_RANGE 0.711305 // in m; the default travel of a sliding door
+
+/*
+
+Microbenchmark of the slide clamp kernels (see slide_clamp.h):
+	Clamps the travels of N doors, a given fraction of them past their limits as after a physics step, with each kernel
+	the CPU supports, and reports the time per door and the speedup over the scalar kernel. The output of each kernel
+	is checked against the scalar one.
+
+	Every run starts from the same unclamped travels; the time to restore them is measured on its own and taken out.
+
+*/
+
+namespace po = boost::program_options;
+typedef std::chrono::steady_clock Clock;
+
+struct KernelEntry
+{
+	const char *name;
+	SlideClampKernel kernel;
+};
+
+struct DoorArrays
+{
+	std::vector<float> travel, initialTravel, minTravel, maxTravel;
+	std::vector<uint32_t> changed;
+};
+
+static void generateDoors(size_t numDoors, double overshoot, unsigned int seed, DoorArrays &doors)
+{
+	srand(seed);
+
+	doors.travel.resize(numDoors);
+	doors.initialTravel.resize(numDoors);
+	doors.minTravel.resize(numDoors);
+	doors.maxTravel.resize(numDoors);
+	doors.changed.resize(numDoors);
+
+	for (size_t i=0; i<numDoors; i++) {
+		bool isRight = rand() % 2 == 0; // right doors travel the other way (see slide_axis.h)
+		doors.minTravel[i] = isRight ? -SLIDE_RANGE : 0;
+		doors.maxTravel[i] = isRight ? 0 : SLIDE_RANGE;
+
+		float fraction = rand() / (RAND_MAX + 1.0);
+
+		if (rand() / (RAND_MAX + 1.0) < overshoot) {
+			fraction = fraction < 0.5 ? -0.05 * fraction : 1 + 0.05 * fraction; // a few mm past one of the ends
+		}
+
+		doors.initialTravel[i] = doors.minTravel[i] + fraction * SLIDE_RANGE;
+	}
+
+	doors.travel = doors.initialTravel;
+}
+
+static size_t runKernel(SlideClampKernel kernel, DoorArrays &doors)
+{
+	SlideClampArrays arrays = {&doors.travel[0], &doors.minTravel[0], &doors.maxTravel[0]};
+	return kernel(arrays, 0, doors.travel.size(), &doors.changed[0]);
+}
+
+static void restore(DoorArrays &doors)
+{
+	memcpy(&doors.travel[0], &doors.initialTravel[0], doors.travel.size() * sizeof(float));
+}
+
+// in ns per door; the number of runs doubles until they take minTime
+static double timeRuns(SlideClampKernel kernel, DoorArrays &doors, double minTime)
+{
+	for (size_t runs = 1; ; runs *= 2) {
+		Clock::time_point start = Clock::now();
+
+		for (size_t r=0; r<runs; r++) {
+			restore(doors);
+
+			if (kernel) {
+				runKernel(kernel, doors);
+			}
+		}
+
+		double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (elapsed >= minTime) {
+			return elapsed * 1e9 / (runs * doors.travel.size());
+		}
+	}
+}
+
+// the same doors changed, in the same order, to the same travels as with the scalar kernel
+static bool checkKernel(SlideClampKernel kernel, DoorArrays &doors)
+{
+	restore(doors);
+	size_t numExpected = runKernel(clampSlideScalar, doors);
+	std::vector<float> expectedTravel = doors.travel;
+	std::vector<uint32_t> expectedChanged(doors.changed.begin(), doors.changed.begin() + numExpected);
+
+	restore(doors);
+	size_t numChanged = runKernel(kernel, doors);
+
+	return numChanged == numExpected && doors.travel == expectedTravel && std::equal(expectedChanged.begin(), expectedChanged.end(), doors.changed.begin());
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<size_t> defaultCounts;
+	defaultCounts.push_back(1000);
+	defaultCounts.push_back(10000);
+	defaultCounts.push_back(100000);
+	defaultCounts.push_back(1000000);
+
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("doors,d", po::value<std::vector<size_t> >()->multitoken()->default_value(defaultCounts, "1000 10000 100000 1000000"), "door counts")
+		("overshoot,o", po::value<double>()->default_value(DEFAULT_OVERSHOOT), "fraction of the doors past their limits")
+		("min-time", po::value<double>()->default_value(DEFAULT_MIN_TIME), "minimum time per measurement, in s")
+		("seed", po::value<unsigned int>()->default_value(1), "seed of the door travels");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (args.count("help")) {
+		std::cout << options << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	std::vector<KernelEntry> kernels;
+	KernelEntry scalar = {"scalar", clampSlideScalar};
+	kernels.push_back(scalar);
+
+#ifdef SLIDE_CLAMP_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse2")) {
+		KernelEntry sse = {"sse2", clampSlideSSE};
+		kernels.push_back(sse);
+	}
+
+	if (__builtin_cpu_supports("avx2")) {
+		KernelEntry avx = {"avx2", clampSlideAVX2};
+		kernels.push_back(avx);
+	}
+#endif
+
+	std::vector<size_t> counts = args["doors"].as<std::vector<size_t> >();
+	double minTime = args["min-time"].as<double>();
+	int result = EXIT_SUCCESS;
+
+	printf("%10s", "doors");
+	for (size_t k=0; k<kernels.size(); k++) {
+		printf(" %12s %8s", (std::string(kernels[k].name) + " ns/door").c_str(), "speedup");
+	}
+	printf("\n");
+
+	for (size_t c=0; c<counts.size(); c++) {
+		DoorArrays doors;
+		generateDoors(counts[c], args["overshoot"].as<double>(), args["seed"].as<unsigned int>(), doors);
+
+		double restoreTime = timeRuns(NULL, doors, minTime);
+		double scalarTime = 0;
+
+		printf("%10zu", counts[c]);
+
+		for (size_t k=0; k<kernels.size(); k++) {
+			if (!checkKernel(kernels[k].kernel, doors)) {
+				std::cerr << std::endl << "The " << kernels[k].name << " kernel doesn't match the scalar one for " << counts[c] << " doors" << std::endl;
+				result = EXIT_FAILURE;
+				continue;
+			}
+
+			double time = std::max(0.0, timeRuns(kernels[k].kernel, doors, minTime) - restoreTime);
+
+			if (k == 0) {
+				scalarTime = time;
+			}
+
+			printf(" %12.3f %7.2fx", time, time > 0 ? scalarTime / time : 0.0);
+		}
+
+		printf("\n");
+	}
+
+	return result;
+}
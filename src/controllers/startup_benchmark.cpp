@@ -0,0 +1,340 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <boost/thread.hpp>
+#include <boost/program_options.hpp>
+
+#include <ros/ros.h>
+#include <gazebo_msgs/SpawnModel.h>
+#include <gazebo_msgs/DeleteModel.h>
+
+#include <dynamic_gazebo_models/dynamics_client.h>
+#include <dynamic_gazebo_models/DoorStates.h>
+
+#define BENCHMARK_GROUP "startup_benchmark"
+#define MODEL_PREFIX "door_" // the domain space of the door models
+#define MAX_UNIT_ID 65535 // see unit_registry.h
+#define DEFAULT_FIRST_ID 50000 // ids of the spawned doors; keep clear of the doors already in the world
+#define COMMAND_PERIOD 1.0 // in s; the open command is repeated for the doors that registered after the last one
+
+/*
+
+Startup benchmark, against a running world:
+	Spawns 100, 1,000 and 10,000 (--counts) copies of a door model, as fast as --spawners parallel spawn calls go, then
+	sends them an open command until every door has reported that it moved on /door_controller/state. For each count,
+	it reports:
+		load: time until the last spawn call returned, i.e. Gazebo has loaded the model & run the plugin Load
+		ready: time until the last door moved, i.e. its deferred ROS setup has finished and it takes commands
+
+	The doors are deleted after each count. To compare with the plugin setup done inside Load, restart the world with
+	the /model_dynamics_manager/init_threads param set to 0 (see init_pool.h). Like the doors of a building, every copy
+	has its own <unit_id> in its plugin reference, which the config cache leaves out of its key (see config_cache.h).
+	With --distinct-configs, every copy also gets an extra element, so the cache parses each copy again: compare its
+	load time with a run without it. The model must be a door whose plugin reference has 'door_' as its domain space,
+	e.g. models/slide_left.sdf.
+
+*/
+
+namespace po = boost::program_options;
+
+class DoorWatch
+{
+	private:
+
+		boost::mutex mutex;
+		std::set<std::string> moved;
+		ros::Subscriber sub;
+
+	public:
+
+		void init(ros::NodeHandle &nh)
+		{
+			sub = nh.subscribe<dynamic_gazebo_models::DoorStates>("/door_controller/state", 1000, &DoorWatch::state_cb, this);
+		}
+
+		void clear()
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			moved.clear();
+		}
+
+		size_t numMoved()
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			return moved.size();
+		}
+
+	private:
+
+		void state_cb(const dynamic_gazebo_models::DoorStates::ConstPtr &states)
+		{
+			boost::mutex::scoped_lock lock(mutex);
+
+			for (size_t i=0; i<states->doors.size(); i++) {
+				const dynamic_gazebo_models::DoorState &door = states->doors[i];
+
+				if (door.model_name.compare(0, strlen(MODEL_PREFIX), MODEL_PREFIX) == 0 && (door.state == dynamic_gazebo_models::DoorState::OPEN || door.state == dynamic_gazebo_models::DoorState::PARTIAL)) {
+					moved.insert(door.model_name);
+				}
+			}
+		}
+};
+
+static std::string modelName(uint32_t id)
+{
+	std::ostringstream name;
+	name << MODEL_PREFIX << id;
+	return name.str();
+}
+
+// The model with its own <unit_id> in the plugin reference, as each door in a building has; with isDistinct, also with
+// an element that makes its config differ from the other copies
+static std::string doorConfig(const std::string &modelXml, uint32_t unitId, bool isDistinct)
+{
+	std::string xml = modelXml;
+	size_t end = xml.find("</plugin>");
+
+	if (end != std::string::npos) {
+		std::ostringstream tags;
+		tags << "<unit_id>" << unitId << "</unit_id>";
+
+		if (isDistinct) {
+			tags << "<benchmark_copy>" << unitId << "</benchmark_copy>";
+		}
+
+		xml.insert(end, tags.str());
+	}
+
+	return xml;
+}
+
+// Spawns (or deletes) the doors with index = first, first + stride, ...; counts the failures
+struct SpawnRun
+{
+	const std::string *modelXml;
+	uint32_t firstId;
+	size_t first, stride, count, columns;
+	double spacing;
+	bool isDelete, isDistinct;
+
+	void operator()(size_t &numFailed)
+	{
+		ros::NodeHandle nh;
+		ros::ServiceClient spawnClient = nh.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model", true);
+		ros::ServiceClient deleteClient = nh.serviceClient<gazebo_msgs::DeleteModel>("/gazebo/delete_model", true);
+
+		for (size_t i = first; i < count && ros::ok(); i += stride) {
+			bool isSuccess;
+
+			if (isDelete) {
+				gazebo_msgs::DeleteModel srv;
+				srv.request.model_name = modelName(firstId + i);
+				isSuccess = deleteClient.call(srv) && srv.response.success;
+			} else {
+				gazebo_msgs::SpawnModel srv;
+				srv.request.model_name = modelName(firstId + i);
+				srv.request.model_xml = doorConfig(*modelXml, firstId + i, isDistinct);
+				srv.request.reference_frame = "world";
+				srv.request.initial_pose.position.x = (i % columns) * spacing;
+				srv.request.initial_pose.position.y = (i / columns) * spacing;
+				srv.request.initial_pose.orientation.w = 1;
+				isSuccess = spawnClient.call(srv) && srv.response.success;
+			}
+
+			numFailed += isSuccess ? 0 : 1;
+		}
+	}
+};
+
+static size_t runSpawners(const SpawnRun &prototype, size_t numSpawners)
+{
+	std::vector<size_t> numFailed(numSpawners, 0);
+	boost::thread_group threads;
+
+	for (size_t i=0; i<numSpawners; i++) {
+		SpawnRun run = prototype;
+		run.first = i;
+		run.stride = numSpawners;
+		threads.create_thread(boost::bind<void>(run, boost::ref(numFailed[i])));
+	}
+
+	threads.join_all();
+
+	size_t total = 0;
+	for (size_t i=0; i<numSpawners; i++) {
+		total += numFailed[i];
+	}
+
+	return total;
+}
+
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "startup_benchmark", ros::init_options::AnonymousName); // takes out the ROS arguments first
+
+	std::vector<size_t> defaultCounts;
+	defaultCounts.push_back(100);
+	defaultCounts.push_back(1000);
+	defaultCounts.push_back(10000);
+
+	po::options_description options("Options");
+	options.add_options()
+		("help,h", "print this help")
+		("model,m", po::value<std::string>()->required(), "SDF file of the door model")
+		("counts,c", po::value<std::vector<size_t> >()->multitoken()->default_value(defaultCounts, "100 1000 10000"), "numbers of doors to spawn")
+		("spawners,s", po::value<size_t>()->default_value(8), "parallel spawn calls")
+		("first-id", po::value<uint32_t>()->default_value(DEFAULT_FIRST_ID), "unit id of the first door")
+		("spacing", po::value<double>()->default_value(2.0), "distance between the doors, in m")
+		("distinct-configs", "give every copy its own plugin reference, so none of them share a parsed config")
+		("timeout", po::value<double>()->default_value(300.0), "time limit for the doors to get ready, in s");
+
+	po::variables_map args;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), args);
+
+		if (args.count("help")) {
+			std::cout << options << std::endl;
+			return EXIT_SUCCESS;
+		}
+
+		po::notify(args);
+	} catch (po::error &e) {
+		std::cerr << e.what() << std::endl << options << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ifstream modelFile(args["model"].as<std::string>().c_str());
+	std::stringstream modelXml;
+	modelXml << modelFile.rdbuf();
+
+	if (!modelFile || modelXml.str().empty()) {
+		std::cerr << "Couldn't read " << args["model"].as<std::string>() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ros::NodeHandle nh;
+
+	if (!ros::service::waitForService("/gazebo/spawn_sdf_model", ros::Duration(10))) {
+		std::cerr << "Couldn't reach Gazebo" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	DoorWatch watch;
+	watch.init(nh);
+
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+
+	dynamic_gazebo_models::DynamicsClient client;
+	std::vector<size_t> counts = args["counts"].as<std::vector<size_t> >();
+	size_t numSpawners = std::max<size_t>(1, args["spawners"].as<size_t>());
+	uint32_t firstId = args["first-id"].as<uint32_t>();
+	int result = EXIT_SUCCESS;
+
+	printf("  doors   load (s)  load/door (ms)  ready (s)\n");
+
+	for (size_t c=0; c<counts.size() && result == EXIT_SUCCESS && ros::ok(); c++) {
+		size_t count = counts[c];
+
+		if (firstId + count - 1 > MAX_UNIT_ID) {
+			std::cerr << "Unit ids beyond " << MAX_UNIT_ID << "; lower --first-id" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::string xml = modelXml.str();
+
+		SpawnRun spawn;
+		spawn.modelXml = &xml;
+		spawn.firstId = firstId;
+		spawn.count = count;
+		spawn.columns = std::max<size_t>(1, static_cast<size_t>(sqrt(count)));
+		spawn.spacing = args["spacing"].as<double>();
+		spawn.isDelete = false;
+		spawn.isDistinct = args.count("distinct-configs") > 0;
+
+		watch.clear();
+		ros::WallTime start = ros::WallTime::now();
+
+		if (runSpawners(spawn, numSpawners) > 0) {
+			std::cerr << "Couldn't spawn all doors" << std::endl;
+			result = EXIT_FAILURE;
+		}
+
+		double loadTime = (ros::WallTime::now() - start).toSec();
+		double readyTime = -1;
+
+		std::vector<uint32_t> units(count);
+		for (size_t i=0; i<count; i++) {
+			units[i] = firstId + i;
+		}
+
+		client.deleteGroup(BENCHMARK_GROUP); // left over from an interrupted run
+
+		if (result == EXIT_SUCCESS && !client.addGroup(BENCHMARK_GROUP, "door", units)) {
+			std::cerr << "Couldn't add the doors to a control group (is the dynamics manager running?)" << std::endl;
+			result = EXIT_FAILURE;
+		}
+
+		ros::WallTime nextCommand = ros::WallTime::now();
+
+		while (result == EXIT_SUCCESS && ros::ok()) {
+			if (watch.numMoved() >= count) {
+				readyTime = (ros::WallTime::now() - start).toSec();
+				break;
+			}
+
+			if ((ros::WallTime::now() - start).toSec() > args["timeout"].as<double>()) {
+				std::cerr << "Only " << watch.numMoved() << " of " << count << " doors got ready in time" << std::endl;
+				result = EXIT_FAILURE;
+				break;
+			}
+
+			// doors that join the registry after a command don't get it, so it's repeated:
+			if (ros::WallTime::now() >= nextCommand) {
+				client.openDoors(BENCHMARK_GROUP);
+				nextCommand += ros::WallDuration(COMMAND_PERIOD);
+			}
+
+			ros::WallDuration(0.01).sleep();
+		}
+
+		if (result == EXIT_SUCCESS) {
+			printf("%7zu %10.2f %15.3f %10.2f\n", count, loadTime, loadTime * 1000 / count, readyTime);
+			fflush(stdout);
+		}
+
+		client.deleteGroup(BENCHMARK_GROUP);
+
+		spawn.isDelete = true;
+		runSpawners(spawn, numSpawners);
+	}
+
+	spinner.stop();
+	return result;
+}
@@ -31,22 +31,25 @@
 #include <std_msgs/UInt8.h>
 #include <std_msgs/Int32.h>
 
+#include "robot_tracker.h"
+#include "lod_scheduler.h"
+#include "door_state_publisher.h"
+#include "slide_axis.h"
+#include "init_pool.h"
+#include "unit_registry.h"
+#include "param_watch.h"
+#include "plugin_log.h"
+#include "obstruction_monitor.h"
+
 #define DEFAULT_SLIDE_DISTANCE 0.711305
 #define DEFAULT_SLIDE_SPEED 1 // in m/s
 
-#define HEIGHT_LEVEL_TOLERANCE 1.5
+#define DEFAULT_LEVEL_TOLERANCE 1.5 // in m; tunable as auto_door/level_tolerance
 
 #define ELEV_DOOR_STATE_OPEN 1
 #define ELEV_DOOR_STATE_CLOSE 0
 #define ELEV_DOOR_STATE_FREE 2
 
-/*
-
-Limitations:
-	The door must be facing either the x axis or the y axis; not skewed in any sense
-
-*/
-
 enum DoorDirection {LEFT, RIGHT};
 
 namespace gazebo
@@ -55,24 +58,35 @@ namespace gazebo
 	{
 		private:
 			ros::NodeHandle *rosNode;
+			DeferredInit deferredInit;
 			event::ConnectionPtr updateConnection;
-			ros::Subscriber target_floor_sub, est_floor_sub, open_close_sub, active_elevs_sub;
+			ros::Subscriber est_floor_sub;
 
 			physics::ModelPtr model, elevatorModel;
 			physics::LinkPtr doorLink;
 
 			std::string model_domain_space, elevator_ref_name, elevator_domain_space;
-			int elevator_ref_num, targetFloor, estCurrFloor;
+			uint32_t elevator_ref_num;
+			int targetFloor, estCurrFloor;
 			DoorDirection direction;
 			uint doorState;
 
-			float openVel, closeVel, slide_speed;
-			float max_trans_dist, maxPosX, maxPosY, minPosX, minPosY;
-			bool isActive;
+			float openVel, closeVel, slide_speed, slideVel;
+			float max_trans_dist, levelTolerance;
+			SlideAxis slideAxis;
+			TuningState tuning;
+			bool lodEnabled, isFrozen, isCommandPending, hasUnitId;
+			LodState lod;
+			DoorStatePublisher statePublisher;
+
+			ObstructionMonitor obstruction;
+			common::Time backOffUntil; // after an obstruction, the door holds backOffVel until then
+			float backOffVel;
+			bool isCarBehind;
 
 		public: 
 
-			AutoElevDoorPlugin()
+			AutoElevDoorPlugin() : elevator_ref_num(0), hasUnitId(false)
 			{
 		      std::string name = "auto_elevator_door_plugin";
 		      int argc = 0;
@@ -81,6 +95,12 @@ namespace gazebo
 
 			~AutoElevDoorPlugin()
 			{
+				deferredInit.wait();
+
+				if (hasUnitId) {
+					UnitRegistry<AutoElevDoorPlugin>::instance().remove(elevator_ref_num, this);
+				}
+
 				delete rosNode;
 			}
 
@@ -89,17 +109,45 @@ namespace gazebo
 				determineDomainSpace(_sdf);
 				determineCorresElev(_sdf);				
 				determineDoorDirection(_sdf);
-				determineConstraints(_sdf);								
-				establishLinks(_parent);				
-				initVars();				
+				determineConstraints(_sdf);
+				determineLod(_sdf);
+				establishLinks(_parent);
+				resolveUnit(_sdf);
+				determineObstruction(_sdf);
+				initVars();
+
+				PluginLog::instance().unitLoaded("auto_door", direction == RIGHT ? "right" : "left");
+
+				deferredInit.start(boost::bind(&AutoElevDoorPlugin::initRos, this), boost::bind(&AutoElevDoorPlugin::registerUnit, this));
 			}
 
 		private:
 			void OnUpdate()
 			{
+				if (!deferredInit.isReady()) {
+					return;
+				}
+
 				ros::spinOnce();
+				PluginLog::instance().reportLoads();
+
+				const ParamTuning *newTuning = tuning.update(model->GetWorld()->GetIterations());
+				if (newTuning) {
+					applyTuning(*newTuning);
+				}
+
+				if (lodEnabled && !updateLod()) {
+					return;
+				}
+
 				activateDoors();
+
+				if (obstruction.getIsEnabled()) {
+					checkObstruction();
+				}
+
 				checkSlideConstraints();
+				statePublisher.update(computeOpening());
 			}
 
 			void determineDomainSpace(sdf::ElementPtr _sdf)
@@ -111,13 +159,11 @@ namespace gazebo
 					model_domain_space = _sdf->GetElement("model_domain_space")->Get<std::string>();
 				}
 
-				rosNode = new ros::NodeHandle("");
-
-				if (!rosNode->hasParam("/model_dynamics_manager/elevator_domain_space")) {
+				if (!ros::param::has("/model_dynamics_manager/elevator_domain_space")) {
 					ROS_ERROR("The parameter 'elevator_domain_space' does not exist. Check that the elevator plugin sets this param");
 					std::exit(EXIT_FAILURE);
 				} else {
-					rosNode->getParam("/model_dynamics_manager/elevator_domain_space", elevator_domain_space);
+					ros::param::get("/model_dynamics_manager/elevator_domain_space", elevator_domain_space);
 				}
 			}
 
@@ -159,47 +205,169 @@ namespace gazebo
 				}
 			}
 
+			// the car runs right past its doors, so it doesn't count as an obstruction
+			void determineObstruction(sdf::ElementPtr _sdf)
+			{
+				if (!_sdf->HasElement("obstruction_detection") || _sdf->GetElement("obstruction_detection")->Get<bool>()) {
+					obstruction.init(model->GetName(), elevator_ref_num, doorLink, elevator_ref_name);
+				}
+			}
+
+			void determineLod(sdf::ElementPtr _sdf)
+			{
+				lodEnabled = _sdf->HasElement("lod") && _sdf->GetElement("lod")->Get<bool>();
+
+				if (lodEnabled) {
+					RobotTracker::instance().addRobotsFromSdf(_sdf);
+				}
+			}
+
+			// Returns true if the door should do its plugin work during this iteration
+			bool updateLod()
+			{
+				physics::WorldPtr world = model->GetWorld();
+				RobotTracker::instance().refresh(world);
+
+				uint64_t iteration = world->GetIterations();
+				lod.reclassify(iteration, model->GetWorldPose().pos);
+
+				// a door that still has to carry out a command is never frozen or slowed down
+				bool isIdle = isCommandDone();
+				bool freeze = isIdle && lod.getLevel() == LOD_FAR;
+
+				if (freeze != isFrozen) {
+					isFrozen = freeze;
+
+					if (isFrozen) {
+						slideVel = 0;
+						doorLink->SetLinearVel(math::Vector3(0, 0, 0));
+					}
+
+					model->SetEnabled(!isFrozen);
+				}
+
+				return !isIdle || lod.shouldRun(iteration);
+			}
+
+			// True once the door has reached the end it was last driven to, and no command came in since
+			bool isCommandDone()
+			{
+				if (isCommandPending || model->GetWorld()->GetSimTime() < backOffUntil) {
+					return false;
+				}
+
+				float opening = computeOpening();
+
+				if (slideVel == openVel) {
+					return opening >= DOOR_OPEN_THRESHOLD;
+				} else if (slideVel == closeVel) {
+					return opening <= DOOR_CLOSED_THRESHOLD;
+				}
+
+				return true;
+			}
+
 			void establishLinks(physics::ModelPtr _parent)
 			{
 				model = _parent;
 				doorLink = model->GetLink("door");
 
-				target_floor_sub = rosNode->subscribe<std_msgs::Int32>("/elevator_controller/target_floor", 50, &AutoElevDoorPlugin::target_floor_cb, this);
+				updateConnection = event::Events::ConnectWorldUpdateBegin(boost::bind(&AutoElevDoorPlugin::OnUpdate, this));
+			}
+
+			// deferred to the init pool (see init_pool.h)
+			void initRos()
+			{
+				rosNode = new ros::NodeHandle("");
+
 				est_floor_sub = rosNode->subscribe<std_msgs::Int32>("/elevator_controller/" + elevator_ref_name + "/estimated_current_floor", 50, &AutoElevDoorPlugin::est_floor_cb, this);
-				open_close_sub = rosNode->subscribe<std_msgs::UInt8>("/elevator_controller/door", 50, &AutoElevDoorPlugin::open_close_cb, this);
-				active_elevs_sub = rosNode->subscribe<std_msgs::UInt32MultiArray>("/elevator_controller/active", 50, &AutoElevDoorPlugin::active_elevs_cb, this);
 
-				updateConnection = event::Events::ConnectWorldUpdateBegin(boost::bind(&AutoElevDoorPlugin::OnUpdate, this));
+				statePublisher.advertise();
+				tuning.init();
+
+				if (obstruction.getIsEnabled()) {
+					obstruction.advertise(rosNode);
+				}
 			}
 
-			void initVars()
+			// auto_door/max_trans_dist, auto_door/speed & auto_door/level_tolerance; addressed by the id of the elevator
+			void applyTuning(const ParamTuning &newTuning)
 			{
-				// parse elevator reference number:
-				std::string elevator_ref_num_str = elevator_ref_name;
-				replaceSubstring(elevator_ref_num_str, elevator_domain_space, "");
-				elevator_ref_num = atoi(elevator_ref_num_str.c_str());
+				if (lodEnabled) {
+					LodScheduler::instance().tune(newTuning);
+				}
 
-				ROS_ASSERT(direction == LEFT || direction == RIGHT);
+				float dist = max_trans_dist, speed = slide_speed;
+				newTuning.get("auto_door", elevator_ref_num, "max_trans_dist", dist);
+				newTuning.get("auto_door", elevator_ref_num, "speed", speed);
+				newTuning.get("auto_door", elevator_ref_num, "level_tolerance", levelTolerance);
 
-				// compute open-close velocities
-				openVel = direction == RIGHT ? -slide_speed : slide_speed;
-				closeVel = direction == RIGHT ? slide_speed : -slide_speed;
+				if (dist != max_trans_dist) {
+					max_trans_dist = dist;
+					slideAxis.setMaxTransDist(max_trans_dist);
+				}
 
-				// compute slide constraints
-				float spawnPosX = model->GetWorldPose().pos.x;
-				minPosX = direction == RIGHT ? spawnPosX - max_trans_dist : spawnPosX;
-				maxPosX = direction == RIGHT ? spawnPosX : spawnPosX + max_trans_dist;
+				if (speed != slide_speed) {
+					slide_speed = speed;
+					initSlideVels();
+				}
+			}
 
-				float spawnPosY = model->GetWorldPose().pos.y;
-				minPosY = direction == RIGHT ? spawnPosY - max_trans_dist : spawnPosY;
-				maxPosY = direction == RIGHT ? spawnPosY : spawnPosY + max_trans_dist;
+			// an auto door is addressed by the id of its elevator (see unit_registry.h); <unit_id> overrides the one in the elevator's name
+			void resolveUnit(sdf::ElementPtr _sdf)
+			{
+				hasUnitId = resolveUnitId(_sdf, elevator_ref_name, elevator_domain_space, elevator_ref_num);
+			}
+
+			// after the ROS setup, so routed commands only reach a ready door
+			void registerUnit()
+			{
+				if (!hasUnitId) {
+					return;
+				}
+
+				UnitRegistry<AutoElevDoorPlugin> &registry = UnitRegistry<AutoElevDoorPlugin>::instance();
+
+				if (registry.init("/elevator_controller")) {
+					registry.route<std_msgs::Int32>("/elevator_controller/target_floor", 50, &AutoElevDoorPlugin::target_floor_cb);
+					registry.route<std_msgs::UInt8>("/elevator_controller/door", 50, &AutoElevDoorPlugin::open_close_cb);
+				}
+
+				registry.add(elevator_ref_num, this);
+			}
+
+			void initVars()
+			{
+				ROS_ASSERT(direction == LEFT || direction == RIGHT);
+
+				initSlideVels();
+				levelTolerance = DEFAULT_LEVEL_TOLERANCE;
+				slideVel = backOffVel = 0;
+				isCarBehind = isFrozen = isCommandPending = false;
+
+				// the slide axis & travel range are fixed at spawn, so the door can face any direction
+				slideAxis.init(model->GetWorldPose().pos, doorLink->GetWorldPose().rot, max_trans_dist, direction == RIGHT);
 
 				elevatorModel = model->GetWorld()->GetModel(elevator_ref_name);
+
+				if (lodEnabled) {
+					lod.init("auto_door", model->GetId());
+				}
+
+				statePublisher.init(model->GetName(), doorLink);
+			}
+
+			void initSlideVels()
+			{
+				openVel = direction == RIGHT ? -slide_speed : slide_speed;
+				closeVel = direction == RIGHT ? slide_speed : -slide_speed;
 			}
 
 			void activateDoors()
 			{
-				if (!isActive) {
+				isCommandPending = false;
+
+				if (!hasUnitId || !UnitRegistry<AutoElevDoorPlugin>::instance().isActive(elevator_ref_num)) {
 					return;
 				}
 
@@ -208,7 +376,9 @@ namespace gazebo
 				float doorElevHeightDiff = fabs(currElevHeight - currDoorHeight);
 
 				// Primary condition: the elevator is behind the doors
-				if (doorElevHeightDiff > HEIGHT_LEVEL_TOLERANCE || estCurrFloor != targetFloor) {
+				isCarBehind = doorElevHeightDiff <= levelTolerance && estCurrFloor == targetFloor;
+
+				if (!isCarBehind) {
 					setDoorSlideVel(closeVel);
 					return;
 				}
@@ -228,70 +398,78 @@ namespace gazebo
 
 			void setDoorSlideVel(float vel)
 			{
-				doorLink->SetLinearVel(math::Vector3(vel, vel, 0)); // we set the vel for both x & y directions since we don't know which direction the door is facing 
+				if (model->GetWorld()->GetSimTime() < backOffUntil) {
+					vel = backOffVel;
+				}
+
+				slideVel = vel;
+				doorLink->SetLinearVel(slideAxis.velocity(vel));
 			}
 
-			void checkSlideConstraints()
+			// A door that keeps pushing against something backs off for a while, then tries again (see obstruction_monitor.h)
+			void checkObstruction()
 			{
-				float currDoorPosX = model->GetWorldPose().pos.x;
-				float currDoorPosY = model->GetWorldPose().pos.y;
+				physics::WorldPtr world = model->GetWorld();
+				common::Time now = world->GetSimTime();
 
-				math::Pose constrainedPose;
+				float opening = computeOpening();
+				bool isClosing = slideVel == closeVel && opening > DOOR_CLOSED_THRESHOLD;
+				bool isMoving = isClosing || (slideVel == openVel && opening < DOOR_OPEN_THRESHOLD);
 
-				if (currDoorPosX > maxPosX) {
-					constrainedPose.pos.x = maxPosX;
-				} else if (currDoorPosX < minPosX) {
-					constrainedPose.pos.x = minPosX;
-				} else {
-					constrainedPose.pos.x = currDoorPosX;
+				if (!obstruction.update(world->GetIterations(), now, isMoving)) {
+					return;
 				}
 
-				if (currDoorPosY > maxPosY) {
-					constrainedPose.pos.y = maxPosY;
-				} else if (currDoorPosY < minPosY) {
-					constrainedPose.pos.y = minPosY;
-				} else {
-					constrainedPose.pos.y = currDoorPosY;
+				// reopen only with the car behind the doors; otherwise, there's nothing to open onto:
+				bool isReopening = isClosing && isCarBehind;
+
+				backOffVel = isReopening ? openVel : 0;
+				backOffUntil = now + common::Time(OBSTRUCTION_HOLD_TIME);
+				setDoorSlideVel(backOffVel);
+
+				obstruction.report(isReopening ? dynamic_gazebo_models::DoorObstruction::REOPENED : dynamic_gazebo_models::DoorObstruction::STOPPED, now);
+			}
+
+			void checkSlideConstraints()
+			{
+				math::Pose currPose = model->GetWorldPose();
+				float travel = slideAxis.project(currPose.pos);
+
+				if (travel >= slideAxis.getMinTravel() && travel <= slideAxis.getMaxTravel()) {
+					return;
 				}
 
-			    constrainedPose.pos.z = model->GetWorldPose().pos.z;
-			    constrainedPose.rot.x = model->GetWorldPose().rot.x;
-			    constrainedPose.rot.y = model->GetWorldPose().rot.y;
-			    constrainedPose.rot.z = model->GetWorldPose().rot.z;
+				travel = travel > slideAxis.getMaxTravel() ? slideAxis.getMaxTravel() : slideAxis.getMinTravel();
+				currPose.pos = slideAxis.pointAt(travel, currPose.pos.z);
 
-				model->SetWorldPose(constrainedPose);
+				model->SetWorldPose(currPose, true, false); // not queued for publishing (it allocates); the physics step publishes the moving door
 			}
 
+			// 0: closed (as spawned) ... 1: fully open
+			float computeOpening()
+			{
+				return std::min(1.0f, fabsf(slideAxis.project(model->GetWorldPose().pos)) / max_trans_dist);
+			}
+
+			// routed to the doors of active elevators only
 			void target_floor_cb(const std_msgs::Int32::ConstPtr& msg)
 			{
 				targetFloor = msg->data;
+				isCommandPending = true;
 			}
 
 			void est_floor_cb(const std_msgs::Int32::ConstPtr& msg)
 			{
 				estCurrFloor = msg->data;
+				isCommandPending = true; // the car may have arrived behind the door
 			}
 
+			// routed to the doors of active elevators only
 			void open_close_cb(const std_msgs::UInt8::ConstPtr& msg)
 			{
 				doorState = msg->data;
+				isCommandPending = true;
 			}
-
-			void active_elevs_cb(const std_msgs::UInt32MultiArray::ConstPtr& array)
-			{
-				isActive = false;
-
-			    for (std::vector<uint32_t>::const_iterator it = array->data.begin(); it != array->data.end(); ++it) {
-			        if (*it == elevator_ref_num) {
-			          isActive = true;
-			        }
-	      		}
-			}	
-
-		    std::string replaceSubstring(std::string &s, std::string toReplace, std::string replaceWith)
-		    {
-		      return(s.replace(s.find(toReplace), toReplace.length(), replaceWith));
-		    }
 	};
 
 	GZ_REGISTER_MODEL_PLUGIN(AutoElevDoorPlugin);
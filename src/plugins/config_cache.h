@@ -0,0 +1,116 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_CONFIG_CACHE_H
+#define DYNAMIC_GAZEBO_MODELS_CONFIG_CACHE_H
+
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <gazebo/gazebo.hh>
+
+#define PER_INSTANCE_ELEMENTS "unit_id" // elements that differ from copy to copy of a model and aren't part of its config
+
+/*
+
+Parse-once plugin configuration:
+	Every copy of a model carries the same plugin element, so its configuration is parsed & validated only for the first
+	copy and then shared (immutable) by the others. The cache is keyed by the serialized content of the element, less
+	the per-instance elements (PER_INSTANCE_ELEMENTS) that the plugins read from their own element instead: any other
+	difference in the element - even an extra tag - gets its own entry. Warnings about missing settings are therefore
+	printed once per distinct configuration, not once per model.
+
+*/
+
+namespace gazebo
+{
+	template <class Config>
+	class ConfigCache
+	{
+		public:
+
+			typedef boost::shared_ptr<const Config> ConfigPtr;
+			typedef void (*ParseFunction)(sdf::ElementPtr, Config&);
+
+		private:
+
+			boost::mutex mutex;
+			boost::unordered_map<std::string, ConfigPtr> configs;
+
+			ConfigCache() {}
+
+		public:
+
+			static ConfigCache& instance()
+			{
+				static ConfigCache cache;
+				return cache;
+			}
+
+			ConfigPtr get(sdf::ElementPtr _sdf, ParseFunction parse)
+			{
+				std::string key = makeKey(_sdf);
+
+				boost::mutex::scoped_lock lock(mutex);
+
+				typename boost::unordered_map<std::string, ConfigPtr>::const_iterator it = configs.find(key);
+
+				if (it != configs.end()) {
+					return it->second;
+				}
+
+				boost::shared_ptr<Config> config(new Config());
+				parse(_sdf, *config);
+
+				configs[key] = config;
+
+				return config;
+			}
+
+		private:
+
+			static std::string makeKey(sdf::ElementPtr _sdf)
+			{
+				static const char *perInstance[] = {PER_INSTANCE_ELEMENTS};
+				sdf::ElementPtr keyElement;
+
+				for (size_t i=0; i<sizeof(perInstance) / sizeof(perInstance[0]); i++) {
+					if (!_sdf->HasElement(perInstance[i])) {
+						continue;
+					}
+
+					if (!keyElement) {
+						keyElement = _sdf->Clone(); // the plugin still reads them from its own element
+					}
+
+					while (keyElement->HasElement(perInstance[i])) {
+						keyElement->RemoveChild(keyElement->GetElement(perInstance[i]));
+					}
+				}
+
+				return (keyElement ? keyElement : _sdf)->ToString("");
+			}
+	};
+}
+
+#endif
@@ -36,12 +36,30 @@
 
 #include <ros/ros.h>
 #include <std_msgs/UInt32MultiArray.h>
+#include <std_msgs/Float32MultiArray.h>
 #include <geometry_msgs/Twist.h>
 #include <geometry_msgs/Pose.h>
 
-#define DEFAULT_OPEN_VEL -1.57
-#define DEFAULT_CLOSE_VEL 1.57
+#include "robot_tracker.h"
+#include "lod_scheduler.h"
+#include "door_state_publisher.h"
+#include "slide_clamp.h"
+#include "slide_axis.h"
+#include "config_cache.h"
+#include "init_pool.h"
+#include "unit_registry.h"
+#include "param_watch.h"
+#include "plugin_log.h"
+#include "opening_controller.h"
+#include "obstruction_monitor.h"
+
+#define DEFAULT_FLIP_SPEED 1.57 // in rad/s
+#define DEFAULT_SLIDE_SPEED 1.0 // in m/s
 #define DEFAULT_SLIDE_DISTANCE 0.711305
+#define DEFAULT_FLIP_ANGLE 1.57 // in rad; fully open flip door
+#define MAX_SLIDE_ACCEL 2.0 // in m/s^2
+#define MAX_FLIP_ACCEL 3.14 // in rad/s^2
+#define MAX_CONTROL_STEP 0.1 // in s; longer gaps between updates (e.g. LOD) don't allow bigger velocity jumps
 
 #define TYPE_FLIP_OPEN "flip"
 #define TYPE_SLIDE_OPEN "slide"
@@ -51,42 +69,163 @@
 #define DIRECTION_SLIDE_LEFT "left"
 #define DIRECTION_SLIDE_RIGHT "right"
 
-#define CONTEXT_SPACE_X_RANGE 2.0 // in m
-#define CONTEXT_SPACE_Y_RANGE 2.0
-#define CONTEXT_SPACE_Z_RANGE 2.0
-
 
 namespace gazebo
 { 
   enum DoorType {FLIP, SLIDE};
 
+  // Plugin settings; shared by all doors with the same plugin element (see config_cache.h)
+  struct DoorConfig
+  {
+    DoorType type;
+    std::string door_type, door_direction, model_domain_space;
+    float max_trans_dist;
+    bool autoOpen, lodEnabled, obstructionDetection;
+  };
+
+  // World-level slide constraints: the travels of all sliding doors are gathered & clamped in one batch after each physics step
+  class SlideDoorBatch
+  {
+  private:
+    std::vector<physics::ModelPtr> models;
+    std::vector<SlideAxis> axes;
+    std::vector<float> travel, minTravel, maxTravel;
+    std::vector<uint32_t> changed;
+
+    event::ConnectionPtr updateConnection;
+
+    SlideDoorBatch() {}
+
+  public:
+    static SlideDoorBatch& instance()
+    {
+      static SlideDoorBatch batch;
+      return batch;
+    }
+
+    void addDoor(physics::ModelPtr model, const SlideAxis &axis)
+    {
+      if (!updateConnection) {
+        updateConnection = event::Events::ConnectWorldUpdateEnd(boost::bind(&SlideDoorBatch::OnUpdateEnd, this));
+      }
+
+      models.push_back(model);
+      axes.push_back(axis);
+      minTravel.push_back(axis.getMinTravel());
+      maxTravel.push_back(axis.getMaxTravel());
+
+      travel.resize(models.size());
+      changed.resize(models.size());
+    }
+
+    // after a live change of the travel range
+    void updateDoor(physics::ModelPtr model, const SlideAxis &axis)
+    {
+      std::vector<physics::ModelPtr>::iterator it = std::find(models.begin(), models.end(), model);
+
+      if (it == models.end()) {
+        return;
+      }
+
+      size_t index = it - models.begin();
+
+      axes[index] = axis;
+      minTravel[index] = axis.getMinTravel();
+      maxTravel[index] = axis.getMaxTravel();
+    }
+
+    void removeDoor(physics::ModelPtr model)
+    {
+      std::vector<physics::ModelPtr>::iterator it = std::find(models.begin(), models.end(), model);
+
+      if (it == models.end()) {
+        return;
+      }
+
+      // swap with the last door to keep the arrays packed
+      size_t index = it - models.begin(), last = models.size() - 1;
+
+      models[index] = models[last];
+      axes[index] = axes[last];
+      minTravel[index] = minTravel[last];
+      maxTravel[index] = maxTravel[last];
+
+      models.pop_back();
+      axes.pop_back();
+      minTravel.pop_back();
+      maxTravel.pop_back();
+
+      travel.resize(models.size());
+      changed.resize(models.size());
+    }
+
+    void OnUpdateEnd()
+    {
+      size_t numDoors = models.size();
+
+      if (numDoors == 0) {
+        return;
+      }
+
+      for (size_t i=0; i<numDoors; i++) {
+        travel[i] = axes[i].project(models[i]->GetWorldPose().pos);
+      }
+
+      SlideClampArrays doors = {&travel[0], &minTravel[0], &maxTravel[0]};
+      size_t numChanged = clampSlideBatch(doors, numDoors, &changed[0]);
+
+      // only the doors that overshot their limits are written back (which also takes out any sideways drift); the pose
+      // isn't queued for publishing, which would allocate for every clamped door: the physics step publishes moving doors
+      for (size_t k=0; k<numChanged; k++) {
+        uint32_t i = changed[k];
+
+        math::Pose constrainedPose = models[i]->GetWorldPose();
+        constrainedPose.pos = axes[i].pointAt(travel[i], constrainedPose.pos.z);
+
+        models[i]->SetWorldPose(constrainedPose, true, false);
+      }
+    }
+  };
+
   class DoorPlugin : public ModelPlugin
   {
 
   private:
     physics::ModelPtr model;
     physics::LinkPtr doorLink;
-    math::Pose currPose, currFpvPose; 
+    math::Pose spawnPose;
+
+    math::Vector3 cmd_vel, appliedVel; // commanded, and actually set on the link (ramped towards cmd_vel)
+    common::Time lastUpdateTime;
 
-    math::Vector3 cmd_vel;
+    OpeningController openingController; // position commands (SetDoorOpening) & reopening after an obstruction
+    bool isSettled; // reached the commanded opening: the link is left alone until the next command
+    float openSign; // +1 / -1: the sign of an opening move along the slide axis (slide) or in yaw (flip)
 
-    bool isActive;
-    int activeDoors[100];
+    bool autoOpen, isBotNearby, lodEnabled, isFrozen, hasUnitId;
+    LodState lod;
+    DoorStatePublisher statePublisher;
+    ObstructionMonitor obstruction;
     DoorType type;
     
-    int door_ref_num;
-    std::string door_type, door_model_name, door_direction, model_domain_space;
-    float max_trans_dist, maxPosX, maxPosY, minPosX, minPosY;
+    uint32_t door_ref_num;
+    std::string door_model_name;
+    ConfigCache<DoorConfig>::ConfigPtr config;
+    SlideAxis slideAxis;
+
+    // start out with the plugin settings; live tuning overrides them (see param_watch.h):
+    TuningState tuning;
+    float maxTransDist, autoSlideSpeed, autoFlipSpeed;
 
     ros::NodeHandle* rosNode;
+    DeferredInit deferredInit;
     transport::NodePtr gazeboNode;
     event::ConnectionPtr updateConnection;
 
-    transport::SubscriberPtr subFpvPose, subGzRequest;
-    ros::Subscriber sub, sub_active;
+    transport::SubscriberPtr subGzRequest;
 
   public:
-    DoorPlugin()
+    DoorPlugin() : hasUnitId(false), door_ref_num(0)
     {
       std::string name = "door_plugin_node";
       int argc = 0;
@@ -95,116 +234,235 @@ namespace gazebo
     }
     ~DoorPlugin()
     {
+      deferredInit.wait();
+
+      if (hasUnitId) {
+        UnitRegistry<DoorPlugin>::instance().remove(door_ref_num, this);
+      }
+
+      if (type == SLIDE) {
+        SlideDoorBatch::instance().removeDoor(model);
+      }
+
       delete rosNode;
     }
 
     void Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
     {
       establishLinks(_parent);
-      determineDoorType(_sdf);
-      determineDoorDirection(_sdf);
-      determineModelDomain(_sdf);
-      determineConstraints(_sdf);
+
+      // every copy of a door model carries the same plugin element, which is only parsed for the first one:
+      config = ConfigCache<DoorConfig>::instance().get(_sdf, &DoorPlugin::parseConfig);
+      type = config->type;
+      autoOpen = config->autoOpen;
+      lodEnabled = config->lodEnabled;
+
+      PluginLog::instance().unitLoaded("door", config->door_type + " " + config->door_direction + " in '" + config->model_domain_space + "'");
+
+      resolveUnit(_sdf);
       initVars();
+
+      deferredInit.start(boost::bind(&DoorPlugin::initRos, this), boost::bind(&DoorPlugin::registerUnit, this));
     }
 
     void OnUpdate()
     {
+      if (!deferredInit.isReady()) {
+        return;
+      }
+
       ros::spinOnce();
-      updateLinkVel();
-      applyConstraints();
+      PluginLog::instance().reportLoads();
+
+      const ParamTuning *newTuning = tuning.update(model->GetWorld()->GetIterations());
+      if (newTuning) {
+        applyTuning(*newTuning);
+      }
+
+      if (lodEnabled && !updateLod()) {
+        return;
+      }
+
+      if (autoOpen) {
+        checkProximity();
+      }
+
+      if (obstruction.getIsEnabled()) {
+        checkObstruction();
+      }
+
+      float dt = std::min(MAX_CONTROL_STEP, (model->GetWorld()->GetSimTime() - lastUpdateTime).Double());
+      lastUpdateTime = model->GetWorld()->GetSimTime();
+
+      updateOpeningControl(dt);
+      updateLinkVel(dt);
+      statePublisher.update(computeOpening());
     }
 
   private:
-    void determineDoorType(sdf::ElementPtr _sdf)
+    static void parseConfig(sdf::ElementPtr _sdf, DoorConfig &config)
+    {
+      determineDoorType(_sdf, config);
+      determineDoorDirection(_sdf, config);
+      determineModelDomain(_sdf, config);
+      determineConstraints(_sdf, config);
+      determineAutoOpen(_sdf, config);
+      determineLod(_sdf, config);
+      determineObstruction(_sdf, config);
+    }
+
+    static void determineDoorType(sdf::ElementPtr _sdf, DoorConfig &config)
     {
       if (!_sdf->HasElement("door_type")) {
         ROS_WARN("Door Type not specified. Defaulting to 'flip'");
-        door_type = "flip";
+        config.door_type = "flip";
       } else {
-        door_type = _sdf->GetElement("door_type")->Get<std::string>();
+        config.door_type = _sdf->GetElement("door_type")->Get<std::string>();
       }
 
-      if (door_type.compare(TYPE_SLIDE_OPEN) == 0) {
-        type = SLIDE;
+      if (config.door_type.compare(TYPE_SLIDE_OPEN) == 0) {
+        config.type = SLIDE;
       } else {
-        type = FLIP;
+        config.type = FLIP;
       }
     }
 
-    void determineDoorDirection(sdf::ElementPtr _sdf)
+    static void determineDoorDirection(sdf::ElementPtr _sdf, DoorConfig &config)
     {
       if (!_sdf->HasElement("door_direction")) {
-        if (type == FLIP) {
+        if (config.type == FLIP) {
           ROS_WARN("Door direction not specified in the plugin reference. Defaulting to 'clockwise'");
-          door_direction = DIRECTION_FLIP_CLOCKWISE;
-        } else if (type == SLIDE) {
+          config.door_direction = DIRECTION_FLIP_CLOCKWISE;
+        } else if (config.type == SLIDE) {
           ROS_WARN("Door direction not specified in the plugin reference. Defaulting to 'left'");
-          door_direction = DIRECTION_SLIDE_LEFT;
+          config.door_direction = DIRECTION_SLIDE_LEFT;
         } 
       } else {
-        door_direction = _sdf->GetElement("door_direction")->Get<std::string>();
-        checkDirectionValidity();
+        config.door_direction = _sdf->GetElement("door_direction")->Get<std::string>();
+        checkDirectionValidity(config);
       }
     }
 
-    void determineConstraints(sdf::ElementPtr _sdf)
+    static void determineConstraints(sdf::ElementPtr _sdf, DoorConfig &config)
     {
-      if (type == SLIDE) {
+      config.max_trans_dist = 0;
+
+      if (config.type == SLIDE) {
         if (!_sdf->HasElement("max_trans_dist")) {
           ROS_WARN("Max Translation Distance for sliding door not specified in the plugin reference. Defaulting to '0.711305' m");
-          max_trans_dist = DEFAULT_SLIDE_DISTANCE;
+          config.max_trans_dist = DEFAULT_SLIDE_DISTANCE;
         } else {
-          max_trans_dist = _sdf->GetElement("max_trans_dist")->Get<float>();
+          config.max_trans_dist = _sdf->GetElement("max_trans_dist")->Get<float>();
         }
       }
     }
 
-    void checkDirectionValidity()
+    static void determineAutoOpen(sdf::ElementPtr _sdf, DoorConfig &config)
     {
-      if (type == FLIP) {
-        if (door_direction.compare(DIRECTION_FLIP_CLOCKWISE) != 0 && door_direction.compare(DIRECTION_FLIP_COUNTER_CLOCKWISE) != 0) {
+      config.autoOpen = _sdf->HasElement("auto_open") && _sdf->GetElement("auto_open")->Get<bool>();
+
+      if (!config.autoOpen) {
+        return;
+      }
+
+      RobotTracker::instance().addRobotsFromSdf(_sdf);
+
+      if (RobotTracker::instance().isEmpty()) {
+        ROS_WARN("Door plugin: auto_open is set, but no 'bot_pose_topics' or 'bot_model_names' are specified. The doors will never open on their own");
+      }
+    }
+
+    static void determineLod(sdf::ElementPtr _sdf, DoorConfig &config)
+    {
+      config.lodEnabled = _sdf->HasElement("lod") && _sdf->GetElement("lod")->Get<bool>();
+
+      if (config.lodEnabled) {
+        RobotTracker::instance().addRobotsFromSdf(_sdf);
+      }
+    }
+
+    static void determineObstruction(sdf::ElementPtr _sdf, DoorConfig &config)
+    {
+      config.obstructionDetection = !_sdf->HasElement("obstruction_detection") || _sdf->GetElement("obstruction_detection")->Get<bool>();
+    }
+
+    static void checkDirectionValidity(DoorConfig &config)
+    {
+      if (config.type == FLIP) {
+        if (config.door_direction.compare(DIRECTION_FLIP_CLOCKWISE) != 0 && config.door_direction.compare(DIRECTION_FLIP_COUNTER_CLOCKWISE) != 0) {
           ROS_WARN("Invalid door direction specified. Only two states possible: 'clockwise' OR 'counter_clockwise'. Defaulting to 'clockwise'");
-          door_direction = DIRECTION_FLIP_CLOCKWISE;
+          config.door_direction = DIRECTION_FLIP_CLOCKWISE;
         }
-      } else if (type == SLIDE) {
-        if (door_direction.compare(DIRECTION_SLIDE_LEFT) != 0 && door_direction.compare(DIRECTION_SLIDE_RIGHT) != 0) {
+      } else if (config.type == SLIDE) {
+        if (config.door_direction.compare(DIRECTION_SLIDE_LEFT) != 0 && config.door_direction.compare(DIRECTION_SLIDE_RIGHT) != 0) {
           ROS_WARN("Invalid door direction specified. Only two states possible: 'left' OR 'right'. Defaulting to 'left'");
-          door_direction = DIRECTION_SLIDE_LEFT;
+          config.door_direction = DIRECTION_SLIDE_LEFT;
         }
       }
     }
 
-    void determineModelDomain(sdf::ElementPtr _sdf)
+    static void determineModelDomain(sdf::ElementPtr _sdf, DoorConfig &config)
     {
       if (!_sdf->HasElement("model_domain_space")) {
         ROS_WARN("Model Domain Space not specified in the plugin reference. Defaulting to 'door_'");
-        model_domain_space = "door_";
+        config.model_domain_space = "door_";
       } else {
-        model_domain_space = _sdf->GetElement("model_domain_space")->Get<std::string>();
+        config.model_domain_space = _sdf->GetElement("model_domain_space")->Get<std::string>();
       }
+    }
 
-      ROS_INFO("Door '%s' initialized - Type: %s, Direction: %s, Domain Space: %s\n", door_type.c_str(), door_model_name.c_str(), door_direction.c_str(), model_domain_space.c_str());
+    void resolveUnit(sdf::ElementPtr _sdf)
+    {
+      hasUnitId = resolveUnitId(_sdf, door_model_name, config->model_domain_space, door_ref_num);
+    }
+
+    // the door only gets commands once it's in the registry (see unit_registry.h), after its ROS setup
+    void registerUnit()
+    {
+      if (!hasUnitId) {
+        return;
+      }
+
+      UnitRegistry<DoorPlugin> &registry = UnitRegistry<DoorPlugin>::instance();
+
+      if (registry.init("/door_controller")) {
+        registry.route<geometry_msgs::Twist>("/door_controller/command", 1000, &DoorPlugin::cmd_ang_cb);
+        registry.route<std_msgs::Float32MultiArray>("/door_controller/opening", 1000, &DoorPlugin::opening_cb);
+      }
+
+      registry.add(door_ref_num, this);
     }
 
     void initVars()
     {
-      isActive = false;
+      isBotNearby = isSettled = isFrozen = false;
+      spawnPose = doorLink->GetWorldPose();
+      lastUpdateTime = model->GetWorld()->GetSimTime();
+
+      if (type == SLIDE) {
+        openSign = config->door_direction.compare(DIRECTION_SLIDE_LEFT) == 0 ? 1 : -1;
+      } else {
+        openSign = config->door_direction.compare(DIRECTION_FLIP_CLOCKWISE) == 0 ? -1 : 1;
+      }
 
-      // find the elevator reference number
-      std::string door_ref_num_str = door_model_name; 
-      replaceSubstring(door_ref_num_str, model_domain_space, "");
-      door_ref_num = atoi(door_ref_num_str.c_str());
+      maxTransDist = config->max_trans_dist;
+      autoSlideSpeed = DEFAULT_SLIDE_SPEED;
+      autoFlipSpeed = DEFAULT_FLIP_SPEED;
 
       if (type == SLIDE) {
-        // compute slide constraints
-        float spawnPosX = model->GetWorldPose().pos.x;
-        minPosX = door_direction.compare(DIRECTION_SLIDE_RIGHT) == 0 ? spawnPosX - max_trans_dist : spawnPosX;
-        maxPosX = door_direction.compare(DIRECTION_SLIDE_RIGHT) == 0 ? spawnPosX : spawnPosX + max_trans_dist;
+        // the slide axis is fixed at spawn; each step only projects onto & clamps along that axis
+        slideAxis.init(model->GetWorldPose().pos, spawnPose.rot, maxTransDist, config->door_direction.compare(DIRECTION_SLIDE_RIGHT) == 0);
+        SlideDoorBatch::instance().addDoor(model, slideAxis);
+      }
+
+      if (lodEnabled) {
+        lod.init("door", door_ref_num);
+      }
+
+      statePublisher.init(door_model_name, doorLink);
 
-        float spawnPosY = model->GetWorldPose().pos.y;
-        minPosY = door_direction.compare(DIRECTION_SLIDE_RIGHT) == 0 ? spawnPosY - max_trans_dist : spawnPosY;
-        maxPosY = door_direction.compare(DIRECTION_SLIDE_RIGHT) == 0 ? spawnPosY : spawnPosY + max_trans_dist;
+      if (config->obstructionDetection) {
+        obstruction.init(door_model_name, door_ref_num, doorLink);
       }
     }
 
@@ -214,131 +472,303 @@ namespace gazebo
       doorLink = model->GetLink("door");
       door_model_name = model->GetName();
 
-      rosNode = new ros::NodeHandle("");
+      updateConnection = event::Events::ConnectWorldUpdateBegin(boost::bind(&DoorPlugin::OnUpdate, this));
+    }
 
-      sub = rosNode->subscribe<geometry_msgs::Twist>("/door_controller/command", 1000, &DoorPlugin::cmd_ang_cb, this );
-      sub_active = rosNode->subscribe<std_msgs::UInt32MultiArray>("/door_controller/active", 1000, &DoorPlugin::active_doors_cb, this);
+    // deferred to the init pool (see init_pool.h)
+    void initRos()
+    {
+      rosNode = new ros::NodeHandle("");
+      statePublisher.advertise();
+      tuning.init();
 
-      updateConnection = event::Events::ConnectWorldUpdateBegin(boost::bind(&DoorPlugin::OnUpdate, this));
+      if (obstruction.getIsEnabled()) {
+        obstruction.advertise(rosNode);
+      }
     }
 
-    void cmd_ang_cb(const geometry_msgs::Twist::ConstPtr& msg)
+    // door/max_trans_dist (sliding doors), door/auto_slide_speed & door/auto_flip_speed (auto-open speeds)
+    void applyTuning(const ParamTuning &newTuning)
     {
-      if (isActive) {
-        if (type == FLIP) {
-          setAngularVel(msg->angular.z);
-          ROS_INFO("Door '%s' - Angular z: [%f]", door_model_name.c_str(), msg->angular.z);
-        } else if (type == SLIDE) {
-          setLinearVel(msg->linear.x, msg->linear.y);
-          ROS_INFO("Door '%s' - Linear x: [%f], y: [%f]", door_model_name.c_str(), msg->linear.x, msg->linear.y);
-        }
+      if (lodEnabled) {
+        LodScheduler::instance().tune(newTuning);
+      }
+
+      float dist = maxTransDist;
+      newTuning.get("door", door_ref_num, "max_trans_dist", dist);
+
+      if (type == SLIDE && dist != maxTransDist) {
+        PluginLog::instance().unitInfo("door", door_ref_num, "Max translation distance: [%f]", dist);
+
+        maxTransDist = dist;
+        slideAxis.setMaxTransDist(maxTransDist);
+        SlideDoorBatch::instance().updateDoor(model, slideAxis);
+      }
+
+      newTuning.get("door", door_ref_num, "auto_slide_speed", autoSlideSpeed);
+      newTuning.get("door", door_ref_num, "auto_flip_speed", autoFlipSpeed);
+
+      if (autoOpen && !openingController.getIsActive() && !isSettled && cmd_vel != math::Vector3()) {
+        setAutoOpenVel(); // a door that's been moved keeps going, at the new speed
       }
     }
 
-    void updateLinkVel()
+    // routed to the active doors only
+    void cmd_ang_cb(const geometry_msgs::Twist::ConstPtr& msg)
     {
+      openingController.stop(); // back to velocity control
+      isSettled = false;
+
       if (type == FLIP) {
-        doorLink->SetAngularVel(cmd_vel);
+        setAngularVel(msg->angular.z);
+        PluginLog::instance().unitInfo("door", door_ref_num, "Angular z: [%f]", msg->angular.z);
       } else if (type == SLIDE) {
-        doorLink->SetLinearVel(cmd_vel);
+        setSlideVel(msg->linear.x);
+        PluginLog::instance().unitInfo("door", door_ref_num, "Slide speed: [%f]", msg->linear.x);
       }
     }
 
-    void applyConstraints()
+    // routed to the active doors only; [opening, slide speed, flip speed], a speed <= 0 is the default one
+    void opening_cb(const std_msgs::Float32MultiArray::ConstPtr& msg)
     {
-      if (type == SLIDE) {
-        float currDoorPosX = model->GetWorldPose().pos.x;
-        float currDoorPosY = model->GetWorldPose().pos.y;
+      if (msg->data.size() < 3) {
+        ROS_ERROR("Door '%s': Malformed opening command", door_model_name.c_str());
+        return;
+      }
 
-        math::Pose constrainedPose;
+      startOpeningControl(msg->data[0], type == SLIDE ? msg->data[1] : msg->data[2]);
+      PluginLog::instance().unitInfo("door", door_ref_num, "Target opening: [%f]", msg->data[0]);
+    }
 
-        if (currDoorPosX > maxPosX) {
-          constrainedPose.pos.x = maxPosX;
-        } else if (currDoorPosX < minPosX) {
-          constrainedPose.pos.x = minPosX;
-        } else {
-          constrainedPose.pos.x = currDoorPosX;
-        }
+    // Returns true if the door should do its plugin work during this iteration
+    bool updateLod()
+    {
+      physics::WorldPtr world = model->GetWorld();
+      RobotTracker::instance().refresh(world);
 
-        if (currDoorPosY > maxPosY) {
-          constrainedPose.pos.y = maxPosY;
-        } else if (currDoorPosY < minPosY) {
-          constrainedPose.pos.y = minPosY;
-        } else {
-          constrainedPose.pos.y = currDoorPosY;
+      uint64_t iteration = world->GetIterations();
+      lod.reclassify(iteration, spawnPose.pos);
+
+      // a door that still has to carry out a command is never frozen or slowed down
+      bool isIdle = isCommandDone();
+      bool freeze = isIdle && lod.getLevel() == LOD_FAR;
+
+      if (freeze != isFrozen) {
+        isFrozen = freeze;
+
+        if (isFrozen) {
+          // nothing moves until a robot comes back within range or a new command comes in
+          appliedVel = math::Vector3();
+          model->SetLinearVel(math::Vector3(0, 0, 0));
+          model->SetAngularVel(math::Vector3(0, 0, 0));
         }
 
-          constrainedPose.pos.z = model->GetWorldPose().pos.z;
-          constrainedPose.rot.x = model->GetWorldPose().rot.x;
-          constrainedPose.rot.y = model->GetWorldPose().rot.y;
-          constrainedPose.rot.z = model->GetWorldPose().rot.z;
+        model->SetEnabled(!isFrozen);
+      }
+
+      return !isIdle || lod.shouldRun(iteration);
+    }
+
+    // True once the door has reached what it was commanded to do: settled at its opening, or up against the end a
+    // velocity command pushes it to
+    bool isCommandDone()
+    {
+      if (openingController.getIsActive()) {
+        return false;
+      }
+
+      float rate = velocityToRate(cmd_vel);
 
-        model->SetWorldPose(constrainedPose);
+      if (isSettled || rate == 0) {
+        return true;
       }
+
+      float opening = getSignedOpening();
+      return (rate > 0 && opening >= 1 - OPENING_TOLERANCE) || (rate < 0 && opening <= OPENING_TOLERANCE);
     }
 
-    void setAngularVel(float rot_z)
+    void checkProximity()
     {
-      cmd_vel = math::Vector3();
+      RobotTracker &tracker = RobotTracker::instance();
+      tracker.refresh(model->GetWorld());
 
-      if (door_direction.compare(DIRECTION_FLIP_CLOCKWISE) == 0) { 
-        cmd_vel.z = rot_z;
-      } else {
-        cmd_vel.z = -rot_z; 
+      const math::Vector3 &doorPos = spawnPose.pos;
+      bool botNearby = tracker.getGrid().anyWithin(doorPos.x, doorPos.y, doorPos.z, CONTEXT_SPACE_X_RANGE, CONTEXT_SPACE_Y_RANGE, CONTEXT_SPACE_Z_RANGE);
+
+      if (botNearby == isBotNearby) {
+        return;
       }
+
+      isBotNearby = botNearby;
+
+      openingController.stop();
+      isSettled = false;
+      setAutoOpenVel();
     }
 
-    void setLinearVel(float lin_x, float lin_y) 
+    // same velocities the dynamics manager sends for an open/close request (unless tuned):
+    void setAutoOpenVel()
     {
-      cmd_vel = math::Vector3();
+      if (type == FLIP) {
+        setAngularVel(isBotNearby ? -autoFlipSpeed : autoFlipSpeed);
+      } else if (type == SLIDE) {
+        setSlideVel(isBotNearby ? -autoSlideSpeed : autoSlideSpeed);
+      }
+    }
 
-      if (door_direction.compare(DIRECTION_SLIDE_LEFT) == 0) {
-        cmd_vel.x = -lin_x;
-        cmd_vel.y = -lin_y;
-      } else {
-        cmd_vel.x = lin_x;
-        cmd_vel.y = lin_y;
+    // speed <= 0: the default one
+    void startOpeningControl(float target, float speed)
+    {
+      // the controller works on opening fractions, so speeds & accelerations are scaled by the door's range:
+      float span = type == SLIDE ? maxTransDist : DEFAULT_FLIP_ANGLE;
+      speed = speed > 0 ? speed : (type == SLIDE ? DEFAULT_SLIDE_SPEED : DEFAULT_FLIP_SPEED);
+      float accel = type == SLIDE ? MAX_SLIDE_ACCEL : MAX_FLIP_ACCEL;
+
+      openingController.setTarget(target, speed / span, accel / span, velocityToRate(appliedVel));
+      isSettled = false;
+    }
+
+    // A door that keeps pushing against something backs off (see obstruction_monitor.h)
+    void checkObstruction()
+    {
+      physics::WorldPtr world = model->GetWorld();
+      float rate = velocityToRate(appliedVel), opening = getSignedOpening();
+      bool isMoving = !isSettled && ((rate < 0 && opening > DOOR_CLOSED_THRESHOLD) || (rate > 0 && opening < DOOR_OPEN_THRESHOLD));
+
+      if (!obstruction.update(world->GetIterations(), world->GetSimTime(), isMoving)) {
+        return;
+      }
+
+      if (rate < 0) {
+        // closing: open up again; under position control, so the door goes idle once it's open
+        startOpeningControl(1, 0);
+        obstruction.report(dynamic_gazebo_models::DoorObstruction::REOPENED, world->GetSimTime());
+        return;
+      }
+
+      // opening: stop where it is & leave the link alone until the next command
+      openingController.stop();
+      cmd_vel = appliedVel = math::Vector3();
+      doorLink->SetLinearVel(math::Vector3(0, 0, 0));
+      doorLink->SetAngularVel(math::Vector3(0, 0, 0));
+      isSettled = true;
+
+      obstruction.report(dynamic_gazebo_models::DoorObstruction::STOPPED, world->GetSimTime());
+    }
+
+    void updateOpeningControl(float dt)
+    {
+      if (!openingController.getIsActive()) {
+        return;
+      }
+
+      float rate = openingController.update(getSignedOpening(), dt);
+
+      if (!openingController.getIsActive()) {
+        isSettled = true;
+      }
+
+      // negative speeds open the door (see setAngularVel / setSlideVel):
+      if (type == FLIP) {
+        setAngularVel(-rate * DEFAULT_FLIP_ANGLE);
+      } else if (type == SLIDE) {
+        setSlideVel(-rate * maxTransDist);
       }
     }
 
-    void active_doors_cb(const std_msgs::UInt32MultiArray::ConstPtr& array) 
+    // The velocity is ramped to the commanded one, so reversals don't hit the solver with a large impulse
+    void updateLinkVel(float dt)
     {
-      isActive = false;
-      
-      int i=0;
+      if (isSettled) {
+        appliedVel = math::Vector3();
+        return;
+      }
+
+      math::Vector3 targetVel = cmd_vel;
 
-      for (std::vector<uint32_t>::const_iterator it = array->data.begin(); it != array->data.end(); ++it) {
-        activeDoors[i] = *it;
-        i++;
+      // flip doors stop at closed & fully open instead of spinning on:
+      if (type == FLIP) {
+        float opening = getSignedOpening();
+        float openingRate = velocityToRate(cmd_vel);
 
-        if (*it == door_ref_num) {
-          isActive = true;
+        if ((openingRate > 0 && opening >= 1) || (openingRate < 0 && opening <= 0)) {
+          targetVel = math::Vector3();
         }
       }
+
+      math::Vector3 step = targetVel - appliedVel;
+      double maxStep = (type == SLIDE ? MAX_SLIDE_ACCEL : MAX_FLIP_ACCEL) * dt;
+
+      if (step.GetLength() > maxStep) {
+        step = step.Normalize() * maxStep;
+      }
+
+      appliedVel += step;
+
+      if (type == FLIP) {
+        doorLink->SetAngularVel(appliedVel);
+      } else if (type == SLIDE) {
+        doorLink->SetLinearVel(appliedVel);
+      }
     }
 
-    std::string replaceSubstring(std::string &s, std::string toReplace, std::string replaceWith)
+    // 0: closed ... 1: fully open; unlike computeOpening, a flip door turned the other way is < 0
+    float getSignedOpening()
     {
-      return(s.replace(s.find(toReplace), toReplace.length(), replaceWith));
+      if (type == SLIDE) {
+        return openSign * slideAxis.project(model->GetWorldPose().pos) / maxTransDist;
+      }
+
+      double yawDiff = doorLink->GetWorldPose().rot.GetYaw() - spawnPose.rot.GetYaw();
+      yawDiff = atan2(sin(yawDiff), cos(yawDiff));
+
+      return openSign * yawDiff / DEFAULT_FLIP_ANGLE;
     }
 
-    // Deprecated function:
-    std::vector<std::string> parseTopicStr(std::string bot_pose_topics_str)
+    // link velocity -> rate of the opening fraction
+    float velocityToRate(const math::Vector3 &vel)
     {
-      std::vector<std::string> bot_pose_topic_list;
+      if (type == SLIDE) {
+        return openSign * vel.Dot(slideAxis.getDir()) / maxTransDist;
+      }
 
-      // parse csv-style input (also remove whitespace):
-      std::string::iterator end_pos = std::remove(bot_pose_topics_str.begin(), bot_pose_topics_str.end(), ' ');
-      bot_pose_topics_str.erase(end_pos, bot_pose_topics_str.end());
+      return openSign * vel.z / DEFAULT_FLIP_ANGLE;
+    }
 
-      std::istringstream ss(bot_pose_topics_str);
-      std::string token;
+    // 0: closed (as spawned) ... 1: fully open
+    float computeOpening()
+    {
+      math::Pose currPose = doorLink->GetWorldPose();
 
-      while (std::getline(ss, token, ',')) {
-        bot_pose_topic_list.push_back(token.c_str());
+      if (type == SLIDE) {
+        return std::min(1.0f, fabsf(slideAxis.project(model->GetWorldPose().pos)) / maxTransDist);
       }
 
-      return bot_pose_topic_list;
+      double yawDiff = currPose.rot.GetYaw() - spawnPose.rot.GetYaw();
+      yawDiff = atan2(sin(yawDiff), cos(yawDiff));
+
+      return std::min(1.0, fabs(yawDiff) / DEFAULT_FLIP_ANGLE);
+    }
+
+    void setAngularVel(float rot_z)
+    {
+      cmd_vel = math::Vector3();
+
+      if (config->door_direction.compare(DIRECTION_FLIP_CLOCKWISE) == 0) { 
+        cmd_vel.z = rot_z;
+      } else {
+        cmd_vel.z = -rot_z; 
+      }
+    }
+
+    // the slide speed is along the door's own axis, whichever way the door faces
+    void setSlideVel(float speed)
+    {
+      if (config->door_direction.compare(DIRECTION_SLIDE_LEFT) == 0) {
+        cmd_vel = slideAxis.velocity(-speed);
+      } else {
+        cmd_vel = slideAxis.velocity(speed);
+      }
     }
 
   };
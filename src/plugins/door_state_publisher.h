@@ -0,0 +1,262 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_DOOR_STATE_PUBLISHER_H
+#define DYNAMIC_GAZEBO_MODELS_DOOR_STATE_PUBLISHER_H
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#include <ros/ros.h>
+#include <dynamic_gazebo_models/DoorState.h>
+#include <dynamic_gazebo_models/DoorStates.h>
+
+#define DOOR_STATE_TOPIC "/door_controller/state"
+
+#define DOOR_CLOSED_THRESHOLD 0.05 // opening fraction below which a door counts as closed
+#define DOOR_OPEN_THRESHOLD 0.95 // opening fraction above which a door counts as open
+
+/*
+
+Publishes the footprints & states of the doors for the door grid layer:
+	Each door checks its opening fraction every tick, but only reports when it crosses one of the thresholds. The
+	reports of all doors of a plugin go to one board (per process), which sends the changes of a physics step in one
+	DoorStates message. A subscriber that connects later isn't served by latching (that would only keep the last
+	message): the board sends it a snapshot of all its doors as soon as it connects, and the changes from then on.
+	The snapshot is sent under the board's lock, so no change can be queued between taking it and sending it. A door
+	that is deleted is reported one last time, as REMOVED, so subscribers can clear its footprint.
+
+	A report only notes the slot of the door; the message is put together at the end of the step, and only if someone
+	subscribes (a later subscriber gets the states in its snapshot anyway). Reporting doesn't allocate once the slot
+	list has grown to the number of doors.
+
+*/
+
+namespace gazebo
+{
+	class DoorStateBoard
+	{
+		private:
+
+			boost::mutex mutex; // the connect callback & the init pool threads get here too
+			std::vector<dynamic_gazebo_models::DoorState> doors; // by slot
+			std::vector<bool> isKnown; // slot in use & reported at least once
+			std::vector<uint32_t> freeSlots;
+
+			std::vector<uint32_t> changedSlots; // reported during the current step
+			std::vector<dynamic_gazebo_models::DoorState> removedDoors; // removed during the current step
+			dynamic_gazebo_models::DoorStates changes;
+
+			boost::scoped_ptr<ros::NodeHandle> rosNode;
+			ros::Publisher states_pub;
+			event::ConnectionPtr updateConnection;
+
+			DoorStateBoard() {}
+
+		public:
+
+			static DoorStateBoard& instance()
+			{
+				static DoorStateBoard board;
+				return board;
+			}
+
+			// Gazebo thread (plugin Load)
+			uint32_t add(const dynamic_gazebo_models::DoorState &door)
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				if (!updateConnection) {
+					updateConnection = event::Events::ConnectWorldUpdateEnd(boost::bind(&DoorStateBoard::OnUpdateEnd, this));
+				}
+
+				uint32_t slot = doors.size();
+
+				if (freeSlots.empty()) {
+					doors.push_back(door);
+					isKnown.push_back(false);
+					changedSlots.reserve(doors.size());
+				} else {
+					slot = freeSlots.back();
+					freeSlots.pop_back();
+					doors[slot] = door;
+					isKnown[slot] = false;
+				}
+
+				return slot;
+			}
+
+			void remove(uint32_t slot)
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				if (isKnown[slot]) {
+					removedDoors.push_back(doors[slot]);
+					removedDoors.back().state = dynamic_gazebo_models::DoorState::REMOVED;
+				}
+
+				isKnown[slot] = false;
+				freeSlots.push_back(slot);
+			}
+
+			// init pool; the first door advertises for all of them
+			void advertise()
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				if (rosNode) {
+					return;
+				}
+
+				rosNode.reset(new ros::NodeHandle(""));
+				states_pub = rosNode->advertise<dynamic_gazebo_models::DoorStates>(DOOR_STATE_TOPIC, 100, boost::bind(&DoorStateBoard::connect_cb, this, _1));
+			}
+
+			// Gazebo thread: the change goes out at the end of the step
+			void report(uint32_t slot, float opening, uint8_t state)
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				doors[slot].opening = opening;
+				doors[slot].state = state;
+				isKnown[slot] = true;
+
+				changedSlots.push_back(slot);
+			}
+
+		private:
+
+			void OnUpdateEnd()
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				if (changedSlots.empty() && removedDoors.empty()) {
+					return;
+				}
+
+				// before it's advertised or subscribed to, there's no one to send the changes to (subscribers get a snapshot on connect anyway)
+				if (states_pub && states_pub.getNumSubscribers() > 0) {
+					changes.doors = removedDoors;
+
+					for (size_t i=0; i<changedSlots.size(); i++) {
+						if (isKnown[changedSlots[i]]) { // not removed (and reused) since it reported
+							changes.doors.push_back(doors[changedSlots[i]]);
+						}
+					}
+
+					states_pub.publish(changes);
+				}
+
+				changedSlots.clear();
+				removedDoors.clear();
+			}
+
+			// a new subscriber gets every door this board knows of, and only the changes after that; sent under the lock, so
+			// a change reported meanwhile goes out after the snapshot instead of being overwritten by it
+			void connect_cb(const ros::SingleSubscriberPublisher &subscriber)
+			{
+				dynamic_gazebo_models::DoorStates snapshot;
+
+				boost::mutex::scoped_lock lock(mutex);
+
+				for (size_t i=0; i<doors.size(); i++) {
+					if (isKnown[i]) {
+						snapshot.doors.push_back(doors[i]);
+					}
+				}
+
+				subscriber.publish(snapshot);
+			}
+	};
+
+	class DoorStatePublisher
+	{
+		private:
+
+			uint32_t slot;
+			uint8_t state;
+			bool isAdded, isPublished;
+
+		public:
+
+			DoorStatePublisher() : slot(0), state(0), isAdded(false), isPublished(false) {}
+
+			~DoorStatePublisher()
+			{
+				if (isAdded) {
+					DoorStateBoard::instance().remove(slot);
+				}
+			}
+
+			// the footprint is the footprint of the door link as spawned (i.e. closed)
+			void init(const std::string &modelName, physics::LinkPtr doorLink)
+			{
+				dynamic_gazebo_models::DoorState door;
+				door.model_name = modelName;
+
+				math::Box bbox = doorLink->GetBoundingBox();
+				double cornersX[4] = {bbox.min.x, bbox.max.x, bbox.max.x, bbox.min.x};
+				double cornersY[4] = {bbox.min.y, bbox.min.y, bbox.max.y, bbox.max.y};
+
+				door.footprint.resize(4);
+				for (int i=0; i<4; i++) {
+					door.footprint[i].x = cornersX[i];
+					door.footprint[i].y = cornersY[i];
+					door.footprint[i].z = bbox.min.z;
+				}
+
+				slot = DoorStateBoard::instance().add(door);
+				isAdded = true;
+			}
+
+			// update() must not be called before this
+			void advertise()
+			{
+				DoorStateBoard::instance().advertise();
+			}
+
+			void update(float opening)
+			{
+				uint8_t newState = dynamic_gazebo_models::DoorState::PARTIAL;
+
+				if (opening < DOOR_CLOSED_THRESHOLD) {
+					newState = dynamic_gazebo_models::DoorState::CLOSED;
+				} else if (opening > DOOR_OPEN_THRESHOLD) {
+					newState = dynamic_gazebo_models::DoorState::OPEN;
+				}
+
+				if (isPublished && newState == state) {
+					return;
+				}
+
+				state = newState;
+				DoorStateBoard::instance().report(slot, opening, state);
+
+				isPublished = true;
+			}
+	};
+}
+
+#endif
@@ -20,11 +20,13 @@
 
 #include <stdio.h>
 #include <map>
+#include <limits>
 #include <math.h>
 
 #include <boost/bind.hpp>
 #include <gazebo/gazebo.hh>
 #include <gazebo/physics/physics.hh>
+#include <gazebo/physics/ode/ODEJoint.hh>
 #include <gazebo/common/common.hh>
 
 #include <ros/ros.h>
@@ -35,42 +37,101 @@
 #include <std_msgs/Bool.h>
 #include <geometry_msgs/Twist.h>
 
+#include "robot_tracker.h"
+#include "lod_scheduler.h"
+#include "config_cache.h"
+#include "init_pool.h"
+#include "unit_registry.h"
+#include "shaft_coordinator.h"
+#include "param_watch.h"
+#include "plugin_log.h"
+#include "rider_attachment.h"
+
 #define DEFAULT_LIFT_SPEED 1.5
 #define DEFAULT_LIFT_FORCE 100
 
 #define UNKNOWN_FLOOR -100
-#define HEIGHT_LEVEL_TOLERANCE 0.01
+#define HEIGHT_LEVEL_TOLERANCE 0.01 // in m; tunable as elevator/level_tolerance
+#define MAX_LIFT_ACCEL 1.0 // in m/s^2
+#define LEVELING_GAIN 2.0 // in 1/s; the speed per m to go when the car levels in at its target
+#define MAX_CONTROL_STEP 0.1 // in s; longer gaps between updates don't allow bigger speed changes
+#define LIFT_JOINT "translation_constraint" // prismatic joint of the car to the world
+#define RIDER_RELEASE_SPEED 0.01 // in m/s; attached riders are released once the car is this slow at its target floor
+#define PAYLOAD_MASS_TOLERANCE 0.5 // in kg; smaller payload changes aren't logged
+#define SHAFT_POSITION_TOLERANCE 0.01 // in m; cars spawned this close (in x, y) share a shaft
 
 namespace gazebo
 {   
+  // Plugin settings; shared by all elevators with the same plugin element (see config_cache.h)
+  struct ElevatorConfig
+  {
+    std::string model_domain_space;
+    std::vector<float> floorHeights; // indexed by floor, sorted
+    float speed, force;
+    bool lodEnabled;
+
+    std::vector<std::string> payloadModels; // models whose mass counts while they're inside the car
+    float payloadMass; // fixed payload, in kg
+
+    bool sharedShaft; // cars spawned at the same x, y share a shaft (see shaft_coordinator.h)
+    float carClearance;
+
+    bool attachRiders; // see rider_attachment.h
+    std::vector<std::string> riderModels; // empty: the robots given as bot_model_names
+  };
+
   class ElevatorPlugin : public ModelPlugin
   {
 
     private: 
 
       ros::NodeHandle *rosNode;
+      DeferredInit deferredInit;
       event::ConnectionPtr updateConnection;
 
       physics::ModelPtr model;
       physics::LinkPtr bodyLink;
+      physics::JointPtr liftJoint;
+      physics::ODEJointPtr odeLiftJoint; // under ODE; its motor is set directly, since Joint::SetParam allocates a boost::any per value
+      double drivenForce, drivenVel; // last set on the motor; NaN before the first update
       std::string modelName;
 
-      ros::Subscriber target_floor_sub, active_elevs_sub, set_param_sub;
       ros::Publisher estimated_floor_pub;
 
-      std::string model_domain_space, floor_heights_str;
+      ConfigCache<ElevatorConfig>::ConfigPtr config;
       uint numFloors;
+      int publishedFloor;
 
-      std::map<int, float> floorHeightMap;
-      std::map<float, int> floorIndexMap;
+      bool lodEnabled, isFrozen, hasUnitId;
+      LodState lod;
 
-      bool isActive;
-      int targetFloor, elev_ref_num;
+      int targetFloor;
+      uint32_t elev_ref_num;
       float elevSpeed, elevForce, spawnPosX, spawnPosY;
+      float levelTolerance;
+      float liftVel, liftAxisSign; // commanded upward speed of the car (ramped); +1 / -1: joint axis up / down
+      common::Time lastUpdateTime;
+      float tunedSpeed, tunedForce; // last tuned values, so a new tuning doesn't undo a later SetElevProps; -1 if none
+      TuningState tuning;
+
+      // payload compensation:
+      std::vector<physics::ModelPtr> payloadModels; // indexed like config->payloadModels; NULL until spawned
+      std::vector<float> payloadModelMasses;
+      ModelLookupSchedule payloadLookup;
+      float payloadMass, loggedPayloadMass; // in kg
+
+      RiderAttachment riders;
+      float attachedMass; // of the attached riders that aren't payload models already, in kg
+      ModelLookupSchedule riderLookup;
+      bool isRiding;
+
+      ShaftCar shaftCar;
+      std::string shaftName;
+      bool isInShaft;
 
     public: 
 
-      ElevatorPlugin()
+      ElevatorPlugin() : hasUnitId(false), isInShaft(false), elev_ref_num(0)
       {
         std::string name = "elevator_plugin";
         int argc = 0;
@@ -79,129 +140,280 @@ namespace gazebo
 
       ~ElevatorPlugin()
       {
+        deferredInit.wait();
+
+        if (isInShaft) {
+          ShaftCoordinator::instance().remove(shaftName, &shaftCar);
+        }
+
+        if (hasUnitId) {
+          UnitRegistry<ElevatorPlugin>::instance().remove(elev_ref_num, this);
+        }
+
         delete rosNode;
       }
 
       void Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
       {
         establishLinks(_parent);
-        detemineModelDomain(_sdf);
-        loadFloorHeights(_sdf);
-        loadSpeedForce(_sdf);
+
+        // every copy of the elevator model carries the same plugin element, which is only parsed for the first one:
+        config = ConfigCache<ElevatorConfig>::instance().get(_sdf, &ElevatorPlugin::parseConfig);
+        numFloors = config->floorHeights.size();
+        elevSpeed = config->speed; // can be changed per elevator later on
+        elevForce = config->force;
+        lodEnabled = config->lodEnabled;
+
+        resolveUnit(_sdf);
         initVars();
+        joinShaft();
+
+        PluginLog::instance().unitLoaded("elevator", isInShaft ? "in shared shafts" : "");
+
+        deferredInit.start(boost::bind(&ElevatorPlugin::initRos, this), boost::bind(&ElevatorPlugin::registerUnit, this));
       }
 
     private:
 
       void OnUpdate()
       {
+        if (!deferredInit.isReady()) {
+          return;
+        }
+
         ros::spinOnce();
+        PluginLog::instance().reportLoads();
+
+        const ParamTuning *newTuning = tuning.update(model->GetWorld()->GetIterations());
+        if (newTuning) {
+          applyTuning(*newTuning);
+        }
+
+        // before the LOD check, so a frozen car still makes way when it's parked:
+        updateShaftCar();
+
+        if (lodEnabled && !updateLod()) {
+          return;
+        }
+
+        updatePayload();
         directElevator();
-        constrainHorizontalMovement();
         publishEstimatedPos();
       }
 
-      void detemineModelDomain(sdf::ElementPtr _sdf)
+      static void parseConfig(sdf::ElementPtr _sdf, ElevatorConfig &config)
+      {
+        detemineModelDomain(_sdf, config);
+        loadFloorHeights(_sdf, config);
+        loadSpeedForce(_sdf, config);
+        determineLod(_sdf, config);
+        loadPayload(_sdf, config);
+        loadShaft(_sdf, config);
+        loadRiders(_sdf, config);
+      }
+
+      static void detemineModelDomain(sdf::ElementPtr _sdf, ElevatorConfig &config)
       {
         if (!_sdf->HasElement("model_domain_space")) {
           ROS_WARN("Model Domain Space not specified in the plugin reference. Defaulting to 'elevator_'");
-          model_domain_space = "elevator_";
+          config.model_domain_space = "elevator_";
         } else {
-          model_domain_space = _sdf->GetElement("model_domain_space")->Get<std::string>();
+          config.model_domain_space = _sdf->GetElement("model_domain_space")->Get<std::string>();
         }
 
-        rosNode->setParam("/model_dynamics_manager/elevator_domain_space", model_domain_space);
+        ros::param::set("/model_dynamics_manager/elevator_domain_space", config.model_domain_space);
       }
 
-      void loadFloorHeights(sdf::ElementPtr _sdf)
+      static void loadFloorHeights(sdf::ElementPtr _sdf, ElevatorConfig &config)
       {
         if (!_sdf->HasElement("floor_heights")) {
           ROS_ERROR("Floor heights not specified in the plugin reference. The elevator model cannot function without known floor heights");
           std::exit(EXIT_FAILURE);
-        } else {
-          floor_heights_str = _sdf->GetElement("floor_heights")->Get<std::string>();
         }
 
-        parseFloorHeights(floor_heights_str);
-
+        parseFloorHeights(_sdf->GetElement("floor_heights")->Get<std::string>(), config);
       }
 
-      void loadSpeedForce(sdf::ElementPtr _sdf)
+      static void loadSpeedForce(sdf::ElementPtr _sdf, ElevatorConfig &config)
       {
         if (!_sdf->HasElement("speed")) {
           ROS_WARN("Elevator Speed not specified in the plugin reference. Defaulting to 1.5 m/s");
-          elevSpeed = DEFAULT_LIFT_SPEED;
+          config.speed = DEFAULT_LIFT_SPEED;
         } else {
-          elevSpeed = _sdf->GetElement("speed")->Get<float>();
+          config.speed = _sdf->GetElement("speed")->Get<float>();
         }
 
         if (!_sdf->HasElement("force")) {
           ROS_WARN("Elevator Speed not specified in the plugin reference. Defaulting to 100 N");
-          elevForce = DEFAULT_LIFT_FORCE;
+          config.force = DEFAULT_LIFT_FORCE;
         } else {
-          elevForce = _sdf->GetElement("force")->Get<float>();
+          config.force = _sdf->GetElement("force")->Get<float>();
         }
       }
 
+      static void determineLod(sdf::ElementPtr _sdf, ElevatorConfig &config)
+      {
+        config.lodEnabled = _sdf->HasElement("lod") && _sdf->GetElement("lod")->Get<bool>();
+
+        if (config.lodEnabled) {
+          RobotTracker::instance().addRobotsFromSdf(_sdf);
+        }
+      }
+
+      static void loadPayload(sdf::ElementPtr _sdf, ElevatorConfig &config)
+      {
+        config.payloadMass = _sdf->HasElement("payload_mass") ? _sdf->GetElement("payload_mass")->Get<float>() : 0;
+
+        if (_sdf->HasElement("payload_models")) {
+          config.payloadModels = RobotTracker::parseCsvStr(_sdf->GetElement("payload_models")->Get<std::string>());
+        }
+      }
+
+      static void loadShaft(sdf::ElementPtr _sdf, ElevatorConfig &config)
+      {
+        config.sharedShaft = _sdf->HasElement("shared_shaft") && _sdf->GetElement("shared_shaft")->Get<bool>();
+
+        config.carClearance = _sdf->HasElement("car_clearance") ? _sdf->GetElement("car_clearance")->Get<float>() : DEFAULT_CAR_CLEARANCE;
+      }
+
+      static void loadRiders(sdf::ElementPtr _sdf, ElevatorConfig &config)
+      {
+        config.attachRiders = _sdf->HasElement("attach_riders") && _sdf->GetElement("attach_riders")->Get<bool>();
+
+        if (!config.attachRiders) {
+          return;
+        }
+
+        if (_sdf->HasElement("rider_models")) {
+          config.riderModels = RobotTracker::parseCsvStr(_sdf->GetElement("rider_models")->Get<std::string>());
+        } else {
+          RobotTracker::instance().addRobotsFromSdf(_sdf);
+        }
+      }
+
+      // Returns true if the elevator should do its plugin work during this iteration
+      bool updateLod()
+      {
+        physics::WorldPtr world = model->GetWorld();
+        RobotTracker::instance().refresh(world);
+
+        uint64_t iteration = world->GetIterations();
+        lod.reclassify(iteration, bodyLink->GetWorldPose().pos);
+
+        // a car that still has to reach its target floor is never frozen or slowed down
+        bool isIdle = estimateCurrFloor() == targetFloor;
+        bool freeze = isIdle && lod.getLevel() == LOD_FAR;
+
+        if (freeze != isFrozen) {
+          isFrozen = freeze;
+
+          if (isFrozen) {
+            stopMotion();
+          }
+
+          model->SetEnabled(!isFrozen);
+        }
+
+        return !isIdle || lod.shouldRun(iteration);
+      }
+
       void establishLinks(physics::ModelPtr _parent)
       {
         model = _parent;
         bodyLink = model->GetLink("body");
+        liftJoint = model->GetJoint(LIFT_JOINT);
+        odeLiftJoint = boost::dynamic_pointer_cast<physics::ODEJoint>(liftJoint);
         modelName = model->GetName();
 
-        rosNode = new ros::NodeHandle("");
-
-        target_floor_sub = rosNode->subscribe<std_msgs::Int32>("/elevator_controller/target_floor", 100, &ElevatorPlugin::target_floor_cb, this);
-        active_elevs_sub = rosNode->subscribe<std_msgs::UInt32MultiArray>("/elevator_controller/active", 100, &ElevatorPlugin::active_elevs_cb, this);
-        set_param_sub = rosNode->subscribe<std_msgs::Float32MultiArray>("/elevator_controller/param", 100, &ElevatorPlugin::set_param_cb, this);
-        estimated_floor_pub = rosNode->advertise<std_msgs::Int32>("/elevator_controller/" + modelName + "/estimated_current_floor", 100);
+        if (!liftJoint) {
+          ROS_ERROR("Elevator '%s' has no prismatic joint '%s' to the world. It won't move", modelName.c_str(), LIFT_JOINT);
+        }
 
         updateConnection = event::Events::ConnectWorldUpdateBegin(boost::bind(&ElevatorPlugin::OnUpdate, this)); 
       }
 
-      void target_floor_cb(const std_msgs::Int32::ConstPtr& floorRef)
+      // deferred to the init pool (see init_pool.h)
+      void initRos()
       {
-        if (isActive && targetFloor != floorRef->data) {
-          if (floorHeightMap.count(floorRef->data) == 0) {
-            ROS_ERROR("Elevator %d: Floor %d does not exist!", elev_ref_num, floorRef->data);
-            return;
-          }
+        rosNode = new ros::NodeHandle("");
+        estimated_floor_pub = rosNode->advertise<std_msgs::Int32>("/elevator_controller/" + modelName + "/estimated_current_floor", 1, true);
+        tuning.init();
+      }
+
+      // elevator/speed, elevator/force & elevator/level_tolerance; a tuned speed or force holds until the next SetElevProps
+      void applyTuning(const ParamTuning &newTuning)
+      {
+        if (lodEnabled) {
+          LodScheduler::instance().tune(newTuning);
+        }
+
+        float speed = tunedSpeed, force = tunedForce;
 
-          targetFloor = floorRef->data;
-          ROS_INFO("Elevator %d: Target Floor - %d", elev_ref_num, targetFloor);
+        if (newTuning.get("elevator", elev_ref_num, "speed", speed) && speed != tunedSpeed) {
+          PluginLog::instance().unitInfo("elevator", elev_ref_num, "Lift speed tuned to: %f m/s", speed);
+          elevSpeed = tunedSpeed = speed;
         }
+
+        if (newTuning.get("elevator", elev_ref_num, "force", force) && force != tunedForce) {
+          PluginLog::instance().unitInfo("elevator", elev_ref_num, "Lift force tuned to: %f N", force);
+          elevForce = tunedForce = force;
+        }
+
+        newTuning.get("elevator", elev_ref_num, "level_tolerance", levelTolerance);
       }
 
-      void active_elevs_cb(const std_msgs::UInt32MultiArray::ConstPtr& activeList)
+      void resolveUnit(sdf::ElementPtr _sdf)
       {
-        isActive = false;
+        hasUnitId = resolveUnitId(_sdf, modelName, config->model_domain_space, elev_ref_num);
+      }
 
-        for (std::vector<uint32_t>::const_iterator it = activeList->data.begin(); it != activeList->data.end(); ++it)
-        {
-          if (*it == elev_ref_num) {
-            isActive = true;
+      // the elevator only gets commands once it's in the registry (see unit_registry.h), after its ROS setup
+      void registerUnit()
+      {
+        if (!hasUnitId) {
+          return;
+        }
+
+        UnitRegistry<ElevatorPlugin> &registry = UnitRegistry<ElevatorPlugin>::instance();
+
+        if (registry.init("/elevator_controller")) {
+          registry.route<std_msgs::Int32>("/elevator_controller/target_floor", 100, &ElevatorPlugin::target_floor_cb);
+          registry.route<std_msgs::Float32MultiArray>("/elevator_controller/param", 100, &ElevatorPlugin::set_param_cb);
+        }
+
+        registry.add(elev_ref_num, this);
+      }
+
+      // routed to the active elevators only
+      void target_floor_cb(const std_msgs::Int32::ConstPtr& floorRef)
+      {
+        if (targetFloor != floorRef->data) {
+          if (floorRef->data < 0 || floorRef->data >= (int) numFloors) {
+            ROS_ERROR("Elevator %u: Floor %d does not exist!", elev_ref_num, floorRef->data);
+            return;
           }
+
+          setTargetFloor(floorRef->data);
+          PluginLog::instance().unitInfo("elevator", elev_ref_num, "Target Floor - %d", targetFloor);
         }
       }
 
+      // routed to the active elevators only
       void set_param_cb(const std_msgs::Float32MultiArray::ConstPtr& param)
       {
-        if (isActive) {
-
-          if (param->data[0] != elevSpeed) {
-            ROS_INFO("Lift speed of '%s' set to: %f m/s\n", model->GetName().c_str(), param->data[0]);
-          }
+        if (param->data[0] != elevSpeed) {
+          PluginLog::instance().unitInfo("elevator", elev_ref_num, "Lift speed set to: %f m/s", param->data[0]);
+        }
 
-          if (param->data[1] != elevForce) {
-            ROS_INFO("Lift force of '%s' set to: %f N\n", model->GetName().c_str(), param->data[1]);
-          }
+        if (param->data[1] != elevForce) {
+          PluginLog::instance().unitInfo("elevator", elev_ref_num, "Lift force set to: %f N", param->data[1]);
+        }
 
-          elevSpeed = param->data[0];
-          elevForce = param->data[1];   
-        } 
+        elevSpeed = param->data[0];
+        elevForce = param->data[1];   
       }
 
-      void parseFloorHeights(std::string floor_heights_str)
+      static void parseFloorHeights(std::string floor_heights_str, ElevatorConfig &config)
       {
         std::vector<double> floor_heights;
 
@@ -227,66 +439,205 @@ namespace gazebo
           floor_heights.push_back(height);
         }
 
-        genFloorMap(floor_heights);
+        genFloorMap(floor_heights, config);
       }
 
-      void genFloorMap(std::vector<double> floor_heights)
+      static void genFloorMap(std::vector<double> floor_heights, ElevatorConfig &config)
       {
         sort(floor_heights.begin(), floor_heights.end());
 
         for (int floorIndex = 0; floorIndex < floor_heights.size(); floorIndex++)
         {
-           floorHeightMap[floorIndex] = floor_heights.at(floorIndex);
-           floorIndexMap[floor_heights.at(floorIndex)] = floorIndex;
+           config.floorHeights.push_back(floor_heights.at(floorIndex));
 
-           ROS_INFO("Mapped Floor%d to height: %f", floorIndex, floor_heights.at(floorIndex));
+           ROS_DEBUG("Mapped Floor%d to height: %f", floorIndex, floor_heights.at(floorIndex));
         }
 
-        numFloors = floor_heights.size();
-        ROS_DEBUG("Total number of floors initialized: %d", numFloors);
+        ROS_DEBUG("Total number of floors initialized: %zu", floor_heights.size());
       }
 
-      std::string replaceSubstring(std::string &s, std::string toReplace, std::string replaceWith)
+      void setTargetFloor(int floor)
       {
-        return(s.replace(s.find(toReplace), toReplace.length(), replaceWith));
+        targetFloor = floor;
+
+        shaftCar.targetHeight = config->floorHeights[targetFloor];
+        shaftCar.requestIteration = model->GetWorld()->GetIterations();
+      }
+
+      void joinShaft()
+      {
+        if (!config->sharedShaft) {
+          return;
+        }
+
+        // every copy of the model carries the same plugin element, so the shaft is identified by where the car runs:
+        std::ostringstream shaftPos;
+        shaftPos << round(spawnPosX / SHAFT_POSITION_TOLERANCE) << "," << round(spawnPosY / SHAFT_POSITION_TOLERANCE);
+        shaftName = shaftPos.str();
+
+        // the extent of the car around the point its floor heights are given for (its CoG):
+        math::Box car = bodyLink->GetBoundingBox();
+        float height = bodyLink->GetWorldCoGPose().pos.z;
+
+        // stacked cars can't all start out for floor 0; each one starts at the floor nearest to where it was spawned:
+        for (int i=1; i<numFloors; i++) {
+          if (fabs(height - config->floorHeights[i]) < fabs(height - config->floorHeights[targetFloor])) {
+            targetFloor = i;
+          }
+        }
+
+        shaftCar.height = height;
+        shaftCar.targetHeight = config->floorHeights[targetFloor];
+        shaftCar.below = height - car.min.z;
+        shaftCar.above = car.max.z - height;
+        shaftCar.floorHeights = &config->floorHeights;
+        shaftCar.requestIteration = 0;
+        shaftCar.parkingFloor = NO_PARKING_FLOOR;
+
+        ShaftCoordinator::instance().add(shaftName, &shaftCar, config->carClearance);
+        isInShaft = true;
+      }
+
+      void updateShaftCar()
+      {
+        if (!isInShaft) {
+          return;
+        }
+
+        shaftCar.height = bodyLink->GetWorldCoGPose().pos.z;
+
+        // a neighbour needs the floor this car is idling at:
+        if (shaftCar.parkingFloor != NO_PARKING_FLOOR) {
+          PluginLog::instance().unitInfo("elevator", elev_ref_num, "Parked at floor %d to make way in a shared shaft", shaftCar.parkingFloor);
+
+          setTargetFloor(shaftCar.parkingFloor);
+          shaftCar.parkingFloor = NO_PARKING_FLOOR;
+        }
       }
+
+      // The speed follows a trapezoidal profile: ramped up & down within MAX_LIFT_ACCEL, braking just in time for the
+      // target, and proportional to the distance for the last few cm, so the car levels in without a jolt and holds there
       void directElevator()
       {
-        float targetHeight = floorHeightMap[targetFloor];
+        physics::WorldPtr world = model->GetWorld();
+        float dt = std::min(MAX_CONTROL_STEP, (world->GetSimTime() - lastUpdateTime).Double());
+        lastUpdateTime = world->GetSimTime();
+
+        // in a shared shaft, the car only goes as far as its neighbours let it:
+        float targetHeight = isInShaft ? ShaftCoordinator::instance().clampTarget(shaftName, &shaftCar) : config->floorHeights[targetFloor];
         float currentHeight = bodyLink->GetWorldCoGPose().pos.z;
-        float heightDiff = currentHeight - targetHeight;
+        float distance = fabs(targetHeight - currentHeight);
 
-        if (heightDiff > HEIGHT_LEVEL_TOLERANCE || heightDiff < HEIGHT_LEVEL_TOLERANCE) {
-          if (heightDiff > 0.0) {
-            moveDown();
-          } else {
-            moveUp();
+        float speed = std::min(elevSpeed, std::min(sqrtf(2 * MAX_LIFT_ACCEL * distance), LEVELING_GAIN * distance));
+        float desiredVel = targetHeight > currentHeight ? speed : -speed;
+        float maxStep = MAX_LIFT_ACCEL * dt;
+
+        liftVel += std::max(-maxStep, std::min(maxStep, desiredVel - liftVel));
+
+        if (config->attachRiders) {
+          // arrival is at the target floor, not at a stop a neighbour in the shaft forces on the car:
+          updateRiders(fabs(config->floorHeights[targetFloor] - currentHeight));
+        }
+
+        driveJoint(liftVel);
+      }
+
+      // The riders are attached as the car departs (the moment its doors close) and released once it has arrived
+      void updateRiders(float targetDistance)
+      {
+        bool riding = targetDistance > levelTolerance || fabs(liftVel) > RIDER_RELEASE_SPEED;
+
+        // a rider deleted during the ride is dropped, and its weight with it:
+        if (riders.getIsAttached() && riderLookup.isDue(model->GetWorld()) && riders.dropGone()) {
+          updateAttachedMass();
+        }
+
+        if (riding == isRiding) {
+          return;
+        }
+
+        isRiding = riding;
+
+        if (!isRiding) {
+          if (!riders.getIsAttached()) {
+            return;
           }
-        } else {
-          stopMotion();
+
+          riders.release();
+          attachedMass = 0;
+          PluginLog::instance().unitInfo("elevator", elev_ref_num, "Riders released at floor %d", targetFloor);
+          return;
         }
+
+        const std::vector<std::string> &riderNames = config->riderModels.empty() ? RobotTracker::instance().getModelNames() : config->riderModels;
+
+        if (riders.attach(riderNames) == 0) {
+          return;
+        }
+
+        updateAttachedMass();
+
+        PluginLog::instance().unitInfo("elevator", elev_ref_num, "%zu riders attached for the ride to floor %d", riders.getRiders().size(), targetFloor);
       }
 
-      void constrainHorizontalMovement()
+      // the weight of the riders now hangs on the car, so the ones that don't already count as payload are added to it
+      void updateAttachedMass()
       {
-        math::Pose currPose = model->GetWorldPose();
-        float currHeight = currPose.pos.z;
+        const std::vector<physics::ModelPtr> &attached = riders.getRiders();
+        attachedMass = 0;
 
-        math::Pose stabilizedPose;
-        stabilizedPose.rot.x = stabilizedPose.rot.y = stabilizedPose.rot.z = 0;
-        
-        stabilizedPose.pos.x = spawnPosX;
-        stabilizedPose.pos.y = spawnPosY;
-        stabilizedPose.pos.z = currHeight;     
+        for (size_t i=0; i<attached.size(); i++) {
+          if (std::find(config->payloadModels.begin(), config->payloadModels.end(), attached[i]->GetName()) == config->payloadModels.end()) {
+            attachedMass += getModelMass(attached[i]);
+          }
+        }
+      }
+
+      // The joint's motor drives the car; the solver keeps it on its axis & enforces the force limit along with the contacts.
+      // The motor keeps its parameters, so they're only set when they change (while the car ramps or its payload changes).
+      void driveJoint(float upwardVel)
+      {
+        if (!liftJoint) {
+          return;
+        }
+
+        double force = elevForce + getPayloadForce(), vel = liftAxisSign * upwardVel;
 
-        model->SetWorldPose(stabilizedPose);
+        if (force != drivenForce) {
+          if (odeLiftJoint) {
+            odeLiftJoint->SetParam(dParamFMax, force);
+          } else {
+            liftJoint->SetParam("fmax", 0, force);
+          }
+
+          drivenForce = force;
+        }
+
+        if (vel != drivenVel) {
+          if (odeLiftJoint) {
+            odeLiftJoint->SetParam(dParamVel, vel);
+          } else {
+            liftJoint->SetParam("vel", 0, vel);
+          }
+
+          drivenVel = vel;
+        }
       }
 
+      // publishes on change only (latched), so a car that isn't moving between floors doesn't serialize a message every step
       void publishEstimatedPos()
       {
+        int currFloor = estimateCurrFloor();
+
+        if (currFloor == publishedFloor) {
+          return;
+        }
+
         std_msgs::Int32 estimatedFloor;
-        estimatedFloor.data = estimateCurrFloor();
+        estimatedFloor.data = currFloor;
         estimated_floor_pub.publish(estimatedFloor);
+
+        publishedFloor = currFloor;
       }
 
       int estimateCurrFloor()
@@ -294,7 +645,7 @@ namespace gazebo
         float currHeight = bodyLink->GetWorldCoGPose().pos.z;
 
         for (int i=0; i<numFloors; i++) {
-          if (fabs(currHeight - floorHeightMap[i]) < HEIGHT_LEVEL_TOLERANCE) {
+          if (fabs(currHeight - config->floorHeights[i]) < levelTolerance) {
             return i;
           }
         } 
@@ -302,35 +653,98 @@ namespace gazebo
         return UNKNOWN_FLOOR;
       }
 
-      void moveUp()
+      // Payload on board: the fixed payload plus the listed models that are inside the car
+      void updatePayload()
+      {
+        payloadMass = config->payloadMass + attachedMass;
+
+        if (!payloadModels.empty()) {
+          physics::WorldPtr world = model->GetWorld();
+          math::Box car = bodyLink->GetBoundingBox();
+
+          bool isLookup = payloadLookup.isDue(world);
+
+          for (size_t i=0; i<payloadModels.size(); i++) {
+            // looked up again after models were spawned or deleted, so deleted models are dropped and respawned ones picked up
+            if (isLookup) {
+              physics::ModelPtr payloadModel = world->GetModel(config->payloadModels[i]);
+
+              if (payloadModel != payloadModels[i]) {
+                payloadModels[i] = payloadModel;
+                payloadModelMasses[i] = payloadModel ? getModelMass(payloadModel) : 0;
+              }
+            }
+
+            if (!payloadModels[i]) {
+              continue;
+            }
+
+            math::Vector3 pos = payloadModels[i]->GetWorldPose().pos;
+
+            if (pos.x > car.min.x && pos.x < car.max.x && pos.y > car.min.y && pos.y < car.max.y && pos.z > car.min.z && pos.z < car.max.z) {
+              payloadMass += payloadModelMasses[i];
+            }
+          }
+        }
+
+        if (fabs(payloadMass - loggedPayloadMass) > PAYLOAD_MASS_TOLERANCE) {
+          ROS_DEBUG("Elevator %u: payload %f kg", elev_ref_num, payloadMass);
+          loggedPayloadMass = payloadMass;
+        }
+      }
+
+      static float getModelMass(physics::ModelPtr payloadModel)
       {
-        bodyLink->SetForce(math::Vector3(0, 0, elevForce));
-        bodyLink->SetLinearVel(math::Vector3(0, 0, elevSpeed));
+        float mass = 0;
+        physics::Link_V links = payloadModel->GetLinks();
+
+        for (size_t i=0; i<links.size(); i++) {
+          mass += links[i]->GetInertial()->GetMass();
+        }
+
+        return mass;
       }
 
-      void moveDown()
+      // The car has no gravity of its own, but its riders push it down: the joint may use their weight on top of the drive
+      // force, and what it takes to ramp their mass at MAX_LIFT_ACCEL, so a loaded car brakes as hard as an empty one.
+      // The motor is a velocity constraint without gains of its own; its force limit is the only thing the load changes.
+      float getPayloadForce()
       {
-        bodyLink->SetForce(math::Vector3(0, 0, -elevForce));
-        bodyLink->SetLinearVel(math::Vector3(0, 0, -elevSpeed));
+        return payloadMass * (MAX_LIFT_ACCEL - model->GetWorld()->GetPhysicsEngine()->GetGravity().z);
       }
 
       void stopMotion()
       {
-        bodyLink->SetForce(math::Vector3(0, 0, 0));
-        bodyLink->SetLinearVel(math::Vector3(0, 0, 0));
+        liftVel = 0;
+        driveJoint(0);
       }
 
       void initVars()
       {
-        isActive = false;
         targetFloor = 0;
+        levelTolerance = HEIGHT_LEVEL_TOLERANCE;
+        tunedSpeed = tunedForce = -1;
+        publishedFloor = UNKNOWN_FLOOR - 1; // forces the first estimate out
 
-        std::string elev_ref_num_str = model->GetName(); 
-        replaceSubstring(elev_ref_num_str, model_domain_space, "");
-        elev_ref_num = atoi(elev_ref_num_str.c_str());
+        payloadModels.assign(config->payloadModels.size(), physics::ModelPtr());
+        payloadModelMasses.assign(config->payloadModels.size(), 0);
+        payloadMass = loggedPayloadMass = config->payloadMass;
+        attachedMass = 0;
+        isRiding = false;
+        riders.init(bodyLink);
 
         spawnPosX = bodyLink->GetWorldPose().pos.x;
         spawnPosY = bodyLink->GetWorldPose().pos.y;
+
+        liftVel = 0;
+        drivenForce = drivenVel = std::numeric_limits<double>::quiet_NaN();
+        liftAxisSign = liftJoint && liftJoint->GetGlobalAxis(0).z < 0 ? -1 : 1;
+        lastUpdateTime = model->GetWorld()->GetSimTime();
+
+        isFrozen = false;
+        if (lodEnabled) {
+          lod.init("elevator", elev_ref_num);
+        }
       }
 
   };
@@ -0,0 +1,231 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_INIT_POOL_H
+#define DYNAMIC_GAZEBO_MODELS_INIT_POOL_H
+
+#include <deque>
+#include <utility>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+
+#define INIT_POOL_MAX_THREADS 8 // default pool size cap; the param below may set any size
+#define INIT_THREADS_PARAM "/model_dynamics_manager/init_threads" // 0: run the stage inside Load (no deferral)
+
+/*
+
+Deferred plugin initialization:
+	Gazebo loads the models of a world one after the other, so whatever a plugin does in Load adds up over thousands of
+	models. Load therefore only does the work that needs Gazebo (links, poses, update connection, parse-once config) and
+	hands the ROS setup (node handle, subscriptions, publishers) to a small process-wide thread pool. A plugin skips its
+	updates until that stage has finished:
+
+		void Load(...)   { ...; deferredInit.start(boost::bind(&DoorPlugin::initRos, this), boost::bind(&DoorPlugin::registerUnit, this)); }
+		void OnUpdate()  { if (!deferredInit.isReady()) return; ... }
+		~DoorPlugin()    { deferredInit.wait(); ... }
+
+	The optional second step runs on the Gazebo thread, in the isReady() call that first sees the stage finished. The
+	plugins join the UnitRegistry there, so routed commands never reach a unit whose ROS setup is still running.
+	isReady() only takes a lock until the stage has finished; after that it's a plain flag check.
+
+	The pool size is read from INIT_THREADS_PARAM when the pool starts; with 0, start() runs the stage right away, as
+	Load used to (the baseline of startup_benchmark).
+
+*/
+
+namespace gazebo
+{
+	class InitPool
+	{
+		public:
+
+			struct TaskState
+			{
+				boost::mutex mutex;
+				boost::condition_variable finished;
+				bool isDone;
+
+				TaskState() : isDone(false) {}
+			};
+
+			typedef boost::shared_ptr<TaskState> TaskStatePtr;
+
+		private:
+
+			boost::mutex mutex;
+			boost::condition_variable hasWork;
+			std::deque<std::pair<boost::function<void ()>, TaskStatePtr> > tasks;
+			boost::thread_group workers;
+			int numThreads; // -1 until the first task
+			bool isStopping;
+
+			InitPool() : numThreads(-1), isStopping(false) {}
+
+			static int configuredThreads()
+			{
+				int threads = std::min<int>(std::max(boost::thread::hardware_concurrency(), 1u), INIT_POOL_MAX_THREADS);
+				ros::param::param<int>(INIT_THREADS_PARAM, threads, threads);
+
+				return std::max(threads, 0);
+			}
+
+		public:
+
+			static InitPool& instance()
+			{
+				static InitPool pool;
+				return pool;
+			}
+
+			~InitPool()
+			{
+				{
+					boost::mutex::scoped_lock lock(mutex);
+					isStopping = true;
+				}
+
+				hasWork.notify_all();
+				workers.join_all();
+			}
+
+			TaskStatePtr submit(const boost::function<void ()> &task)
+			{
+				TaskStatePtr state(new TaskState());
+				bool isInline;
+
+				{
+					boost::mutex::scoped_lock lock(mutex);
+
+					if (numThreads < 0) {
+						// started on first use, so worlds without these plugins don't pay for the threads
+						numThreads = configuredThreads();
+
+						for (int i=0; i<numThreads; i++) {
+							workers.create_thread(boost::bind(&InitPool::work, this));
+						}
+					}
+
+					isInline = numThreads == 0;
+
+					if (!isInline) {
+						tasks.push_back(std::make_pair(task, state));
+					}
+				}
+
+				if (isInline) {
+					task();
+					state->isDone = true; // not shared with anyone yet
+					return state;
+				}
+
+				hasWork.notify_one();
+				return state;
+			}
+
+		private:
+
+			void work()
+			{
+				while (true) {
+					std::pair<boost::function<void ()>, TaskStatePtr> task;
+
+					{
+						boost::mutex::scoped_lock lock(mutex);
+
+						while (tasks.empty() && !isStopping) {
+							hasWork.wait(lock);
+						}
+
+						if (tasks.empty()) {
+							return; // stopping
+						}
+
+						task = tasks.front();
+						tasks.pop_front();
+					}
+
+					task.first();
+
+					boost::mutex::scoped_lock lock(task.second->mutex);
+					task.second->isDone = true;
+					task.second->finished.notify_all();
+				}
+			}
+	};
+
+	// The deferred initialization stage of one plugin instance
+	class DeferredInit
+	{
+		private:
+
+			InitPool::TaskStatePtr state;
+			boost::function<void ()> onReady;
+			bool isDone;
+
+		public:
+
+			DeferredInit() : isDone(false) {}
+
+			// 'onReady' runs on the thread that calls isReady(), once the task has finished
+			void start(const boost::function<void ()> &task, const boost::function<void ()> &onReady = boost::function<void ()>())
+			{
+				this->onReady = onReady;
+				state = InitPool::instance().submit(task);
+			}
+
+			bool isReady()
+			{
+				if (!isDone && state) {
+					{
+						boost::mutex::scoped_lock lock(state->mutex);
+						isDone = state->isDone;
+					}
+
+					if (isDone && onReady) {
+						onReady();
+					}
+				}
+
+				return isDone;
+			}
+
+			// Blocks until the stage has finished (the task may still use the plugin); returns at once if it never started
+			void wait()
+			{
+				if (!state) {
+					return;
+				}
+
+				boost::mutex::scoped_lock lock(state->mutex);
+
+				while (!state->isDone) {
+					state->finished.wait(lock);
+				}
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,308 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_LOD_SCHEDULER_H
+#define DYNAMIC_GAZEBO_MODELS_LOD_SCHEDULER_H
+
+#include <map>
+#include <string>
+#include <cmath>
+#include <limits>
+
+#include <ros/ros.h>
+#include <std_msgs/UInt32MultiArray.h>
+
+#include "robot_tracker.h"
+#include "param_watch.h"
+#include "plugin_log.h"
+
+#define LOD_MID_RANGE_FACTOR 3.0 // mid class reaches out to this multiple of the context space range
+#define LOD_HYSTERESIS 0.25 // a unit is only demoted once robots are this fraction beyond its current class boundary
+#define LOD_MID_DECIMATION 10 // mid units do their plugin work every nth world iteration; tunable as lod/mid_decimation
+#define LOD_CLASSIFY_PERIOD 50 // in world iterations; tunable as lod/classify_period
+#define LOD_REPORT_PERIOD 1000 // in world iterations
+
+/*
+
+Level-of-detail scheduling for doors & elevators:
+	NEAR - a tracked robot is within the context space of the unit: full update rate
+	MID  - a robot is within LOD_MID_RANGE_FACTOR context spaces: plugin work every LOD_MID_DECIMATION iterations
+	FAR  - no robot around: the unit is frozen (bodies disabled, no plugin work)
+
+	Units are reclassified every LOD_CLASSIFY_PERIOD iterations, staggered by unit, so the grid queries are spread out.
+	The number of units per class is published on /model_dynamics_manager/lod/<unit type> as [near, mid, far].
+
+*/
+
+namespace gazebo
+{
+	enum LodLevel {LOD_NEAR, LOD_MID, LOD_FAR};
+
+	class LodScheduler
+	{
+		public:
+
+			struct UnitCounts
+			{
+				uint32_t count[3];
+				bool isChanged;
+				ros::Publisher pub;
+			};
+
+		private:
+
+			ros::NodeHandle *rosNode;
+			std::map<std::string, UnitCounts> unitCounts;
+			uint64_t lastReport;
+
+			uint32_t midDecimation, classifyPeriod;
+			double rejectedDecimation, rejectedPeriod; // last values warned about, so each unit applying the tuning doesn't repeat it
+
+			LodScheduler() : rosNode(NULL), lastReport(0), midDecimation(LOD_MID_DECIMATION), classifyPeriod(LOD_CLASSIFY_PERIOD), rejectedDecimation(0), rejectedPeriod(0) {}
+
+			// The parameter rounded to a whole number of iterations; false (and iterations untouched) if it isn't set or is out of range
+			static bool getIterations(const ParamTuning &tuning, const std::string &name, uint32_t &iterations, double &rejected)
+			{
+				double value;
+
+				if (!tuning.get("lod", 0, name, value)) {
+					return false;
+				}
+
+				double rounded = std::floor(value + 0.5);
+
+				if (rounded < 1 || rounded > std::numeric_limits<uint32_t>::max()) {
+					if (value != rejected) {
+						ROS_WARN("Tuning parameter 'lod/%s' must be between 1 and %u iterations, got %g; ignored", name.c_str(), std::numeric_limits<uint32_t>::max(), value);
+						rejected = value;
+					}
+
+					return false;
+				}
+
+				iterations = static_cast<uint32_t>(rounded);
+				return true;
+			}
+
+		public:
+
+			static LodScheduler& instance()
+			{
+				static LodScheduler scheduler;
+				return scheduler;
+			}
+
+			~LodScheduler()
+			{
+				delete rosNode;
+			}
+
+			// Returns the counters of the unit type, so units don't have to look them up by name again
+			UnitCounts* addUnit(const std::string &unitType, LodLevel level)
+			{
+				if (rosNode == NULL) {
+					rosNode = new ros::NodeHandle("");
+				}
+
+				if (unitCounts.count(unitType) == 0) {
+					UnitCounts counts = {{0, 0, 0}, true, rosNode->advertise<std_msgs::UInt32MultiArray>("/model_dynamics_manager/lod/" + unitType, 1, true)};
+					unitCounts[unitType] = counts;
+				}
+
+				UnitCounts *counts = &unitCounts[unitType];
+				counts->count[level]++;
+				counts->isChanged = true;
+
+				return counts;
+			}
+
+			// the rates are shared by all unit types, so any unit that sees a new tuning may apply it (see param_watch.h)
+			void tune(const ParamTuning &tuning)
+			{
+				uint32_t decimation = midDecimation, period = classifyPeriod;
+				getIterations(tuning, "mid_decimation", decimation, rejectedDecimation);
+				getIterations(tuning, "classify_period", period, rejectedPeriod);
+
+				if (decimation != midDecimation || period != classifyPeriod) {
+					PluginLog::instance().unitInfo("lod", LOG_NO_UNIT, "Mid units run every %u iterations, reclassified every %u iterations", decimation, period);
+				}
+
+				midDecimation = decimation;
+				classifyPeriod = period;
+			}
+
+			uint32_t getMidDecimation() const
+			{
+				return midDecimation;
+			}
+
+			uint32_t getClassifyPeriod() const
+			{
+				return classifyPeriod;
+			}
+
+			static void moveUnit(UnitCounts *counts, LodLevel from, LodLevel to)
+			{
+				counts->count[from]--;
+				counts->count[to]++;
+				counts->isChanged = true;
+			}
+
+			static void removeUnit(UnitCounts *counts, LodLevel level)
+			{
+				counts->count[level]--;
+				counts->isChanged = true;
+			}
+
+			void report(uint64_t iteration)
+			{
+				if (iteration < lastReport + LOD_REPORT_PERIOD) {
+					return;
+				}
+
+				lastReport = iteration;
+
+				for (std::map<std::string, UnitCounts>::iterator it = unitCounts.begin(); it != unitCounts.end(); ++it) {
+					if (!it->second.isChanged) {
+						continue; // the publisher is latched; nothing to send (or allocate) while units stay put
+					}
+
+					it->second.isChanged = false;
+
+					std_msgs::UInt32MultiArray counts;
+					counts.data.assign(it->second.count, it->second.count + 3);
+					it->second.pub.publish(counts);
+				}
+			}
+	};
+
+	class LodState
+	{
+		private:
+
+			LodScheduler::UnitCounts *counts;
+			LodLevel level;
+			uint32_t phase;
+
+		public:
+
+			LodState() : counts(NULL), level(LOD_NEAR), phase(0) {}
+
+			// a copy counts as a unit of its own, so each copy takes itself off the counters when it goes away
+			LodState(const LodState &other) : counts(other.counts), level(other.level), phase(other.phase)
+			{
+				if (counts) {
+					counts->count[level]++;
+					counts->isChanged = true;
+				}
+			}
+
+			LodState& operator=(const LodState &other)
+			{
+				if (this != &other) {
+					release();
+
+					counts = other.counts;
+					level = other.level;
+					phase = other.phase;
+
+					if (counts) {
+						counts->count[level]++;
+						counts->isChanged = true;
+					}
+				}
+
+				return *this;
+			}
+
+			~LodState()
+			{
+				release();
+			}
+
+			void init(const std::string &unitType, uint32_t unitRef)
+			{
+				release();
+
+				this->phase = unitRef;
+				this->counts = LodScheduler::instance().addUnit(unitType, level);
+			}
+
+			// takes the unit off the counters of its class; the next report publishes the new counts
+			void release()
+			{
+				if (counts) {
+					LodScheduler::removeUnit(counts, level);
+					counts = NULL;
+				}
+			}
+
+			LodLevel getLevel() const
+			{
+				return level;
+			}
+
+			// Returns true if the unit changed class. Only does any work once every classify period.
+			bool reclassify(uint64_t iteration, const math::Vector3 &pos)
+			{
+				if ((iteration + phase) % LodScheduler::instance().getClassifyPeriod() != 0) {
+					return false;
+				}
+
+				const SpatialHash &grid = RobotTracker::instance().getGrid();
+
+				// a boundary is widened on the way out, so units hovering around it don't flip every period:
+				double nearScale = level == LOD_NEAR ? 1.0 + LOD_HYSTERESIS : 1.0;
+				double midScale = (level == LOD_FAR ? 1.0 : 1.0 + LOD_HYSTERESIS) * LOD_MID_RANGE_FACTOR;
+
+				LodLevel newLevel = LOD_FAR;
+
+				if (grid.anyWithin(pos.x, pos.y, pos.z, nearScale * CONTEXT_SPACE_X_RANGE, nearScale * CONTEXT_SPACE_Y_RANGE, nearScale * CONTEXT_SPACE_Z_RANGE)) {
+					newLevel = LOD_NEAR;
+				} else if (grid.anyWithin(pos.x, pos.y, pos.z, midScale * CONTEXT_SPACE_X_RANGE, midScale * CONTEXT_SPACE_Y_RANGE, midScale * CONTEXT_SPACE_Z_RANGE)) {
+					newLevel = LOD_MID;
+				}
+
+				LodScheduler::instance().report(iteration);
+
+				if (newLevel == level) {
+					return false;
+				}
+
+				LodScheduler::moveUnit(counts, level, newLevel);
+				level = newLevel;
+
+				return true;
+			}
+
+			bool shouldRun(uint64_t iteration) const
+			{
+				if (level == LOD_NEAR) {
+					return true;
+				} else if (level == LOD_MID) {
+					return (iteration + phase) % LodScheduler::instance().getMidDecimation() == 0;
+				}
+
+				return false;
+			}
+	};
+}
+
+#endif
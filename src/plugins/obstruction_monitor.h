@@ -0,0 +1,353 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_OBSTRUCTION_MONITOR_H
+#define DYNAMIC_GAZEBO_MODELS_OBSTRUCTION_MONITOR_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+#include <gazebo/transport/transport.hh>
+
+#include <ros/ros.h>
+#include <dynamic_gazebo_models/DoorObstruction.h>
+
+#define OBSTRUCTION_TOPIC "/door_controller/obstruction"
+#define OBSTRUCTION_FILTER "dynamic_gazebo_models_doors"
+
+#define OBSTRUCTION_TIME 0.3 // in s (sim time); a moving door must be blocked this long to back off
+#define OBSTRUCTION_CONTACT_TIMEOUT 0.05 // in s; a contact older than this is gone
+#define OBSTRUCTION_HOLD_TIME 2.0 // in s; an elevator door stays backed off this long before it tries again
+
+/*
+
+Obstruction detection for doors:
+	All door links share one contact filter of the contact manager, so the physics engine only reports the contacts of
+	door collisions, in one message per step, to one subscriber (ContactWatch). The callback only stamps the contact on
+	the door it belongs to; the door checks the stamp in its own update.
+
+	Contacts with static models (walls, floors), with other doors (the two halves of an elevator door) and with the
+	door's ignored model (an elevator door's car) don't count. When a door has been commanded to move and something else
+	has been touching it for OBSTRUCTION_TIME (a door pushing against its own end stop isn't moving), the door backs off instead of pushing on:
+		closing: it opens again
+		opening: it stops where it is
+	and an event goes out on OBSTRUCTION_TOPIC. The next event needs the door to come to rest or the contact to clear first.
+
+	The callback can't look up models, so it keeps the collisions a door touched in the latest step, and the door sorts
+	out the ones that count in its own update (static models are looked up once and cached). The door takes a new list
+	by swapping buffers with the callback, so once both buffers have grown, the update doesn't allocate.
+
+	The filter is rebuilt (once per step, at most) when doors are added or removed.
+
+*/
+
+namespace gazebo
+{
+	class ObstructionMonitor;
+
+	class ContactWatch
+	{
+		private:
+
+			boost::mutex mutex; // guards the collision map & the contact stamps (the callback runs on a transport thread)
+			boost::unordered_map<std::string, ObstructionMonitor*> monitors; // by scoped collision name
+
+			// Gazebo thread only:
+			physics::WorldPtr world;
+			transport::NodePtr node;
+			transport::SubscriberPtr contactSub;
+			boost::unordered_map<std::string, bool> isStaticModel; // by model name
+			bool isDirty;
+			uint64_t syncedIteration;
+
+			ContactWatch() : isDirty(false), syncedIteration(-1) {}
+
+		public:
+
+			static ContactWatch& instance()
+			{
+				static ContactWatch watch;
+				return watch;
+			}
+
+			void add(physics::LinkPtr link, ObstructionMonitor *monitor)
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				physics::Collision_V collisions = link->GetCollisions();
+
+				for (size_t i=0; i<collisions.size(); i++) {
+					monitors[collisions[i]->GetScopedName()] = monitor;
+				}
+
+				world = link->GetWorld();
+				isDirty = true;
+			}
+
+			void remove(ObstructionMonitor *monitor)
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				for (boost::unordered_map<std::string, ObstructionMonitor*>::iterator it = monitors.begin(); it != monitors.end();) {
+					it = it->second == monitor ? monitors.erase(it) : ++it;
+				}
+
+				isDirty = true;
+			}
+
+			// Gazebo thread: the first call of a world iteration rebuilds the filter if the doors changed
+			void sync(uint64_t iteration)
+			{
+				if (iteration == syncedIteration) {
+					return;
+				}
+
+				syncedIteration = iteration;
+
+				if (isDirty) {
+					rebuildFilter();
+				}
+			}
+
+			// Gazebo thread; cached, since models don't change from dynamic to static while they're in the way
+			bool isStatic(const std::string &modelName)
+			{
+				boost::unordered_map<std::string, bool>::iterator it = isStaticModel.find(modelName);
+
+				if (it != isStaticModel.end()) {
+					return it->second;
+				}
+
+				physics::ModelPtr model = world->GetModel(modelName);
+				bool result = !model || model->IsStatic(); // no model: the collision belongs to the world itself
+
+				isStaticModel[modelName] = result;
+				return result;
+			}
+
+			boost::mutex& getMutex()
+			{
+				return mutex;
+			}
+
+		private:
+
+			void rebuildFilter()
+			{
+				std::vector<std::string> collisions;
+
+				boost::mutex::scoped_lock lock(mutex);
+
+				for (boost::unordered_map<std::string, ObstructionMonitor*>::iterator it = monitors.begin(); it != monitors.end(); ++it) {
+					collisions.push_back(it->first);
+				}
+
+				isDirty = false;
+				lock.unlock();
+
+				physics::ContactManager *contactManager = world->GetPhysicsEngine()->GetContactManager();
+
+				if (contactManager->HasFilter(OBSTRUCTION_FILTER)) {
+					contactManager->RemoveFilter(OBSTRUCTION_FILTER);
+				}
+
+				if (collisions.empty()) {
+					return;
+				}
+
+				std::string topic = contactManager->CreateFilter(OBSTRUCTION_FILTER, collisions);
+
+				// the topic stays the same when the filter is rebuilt, so the subscription does too:
+				if (!contactSub) {
+					node = transport::NodePtr(new transport::Node());
+					node->Init(world->GetName());
+					contactSub = node->Subscribe(topic, &ContactWatch::contacts_cb, this);
+				}
+			}
+
+			void contacts_cb(ConstContactsPtr &msg);
+	};
+
+	// The obstruction state of one door
+	class ObstructionMonitor
+	{
+		friend class ContactWatch;
+
+		private:
+
+			// written by the contact callback, under the watch's mutex:
+			common::Time lastContactTime;
+			std::vector<std::string> lastContacts; // the collisions touched at lastContactTime
+
+			std::string modelName, ignoredModel, obstacle, contactModel;
+			std::vector<std::string> contacts; // swapped with lastContacts when they're new
+			common::Time contactsTime, contactStart; // contactsTime: lastContactTime of the list in contacts
+			bool isEnabled, isInContact, isReported;
+
+			ros::Publisher obstruction_pub;
+			dynamic_gazebo_models::DoorObstruction obstructionMsg;
+
+		public:
+
+			ObstructionMonitor() : isEnabled(false), isInContact(false), isReported(false) {}
+
+			~ObstructionMonitor()
+			{
+				if (isEnabled) {
+					ContactWatch::instance().remove(this);
+				}
+			}
+
+			// ignoredModel: a model the door may touch in normal operation (e.g. an elevator door's car)
+			void init(const std::string &modelName, uint32_t unitId, physics::LinkPtr doorLink, const std::string &ignoredModel = "")
+			{
+				obstructionMsg.model_name = this->modelName = modelName;
+				obstructionMsg.unit_id = unitId;
+				this->ignoredModel = ignoredModel;
+
+				ContactWatch::instance().add(doorLink, this);
+				isEnabled = true;
+			}
+
+			bool getIsEnabled() const
+			{
+				return isEnabled;
+			}
+
+			// update() must not be called before this
+			void advertise(ros::NodeHandle *rosNode)
+			{
+				obstruction_pub = rosNode->advertise<dynamic_gazebo_models::DoorObstruction>(OBSTRUCTION_TOPIC, 10);
+			}
+
+			// Returns true (once per obstruction) when the door has been blocked for OBSTRUCTION_TIME while moving
+			bool update(uint64_t iteration, const common::Time &now, bool isMoving)
+			{
+				ContactWatch &watch = ContactWatch::instance();
+				watch.sync(iteration);
+
+				boost::mutex::scoped_lock lock(watch.getMutex());
+				bool isTouching = (now - lastContactTime).Double() < OBSTRUCTION_CONTACT_TIMEOUT;
+
+				if (isTouching && contactsTime != lastContactTime) {
+					contacts.swap(lastContacts); // the callback refills the old buffer
+					lastContacts.clear();
+					contactsTime = lastContactTime;
+				}
+
+				lock.unlock();
+
+				if (!isTouching || !findObstacle()) {
+					isInContact = isReported = false;
+					return false;
+				}
+
+				if (!isMoving) {
+					isInContact = isReported = false; // only the time spent pushing counts
+					return false;
+				}
+
+				if (!isInContact) {
+					isInContact = true;
+					contactStart = now;
+				}
+
+				if (isReported || (now - contactStart).Double() < OBSTRUCTION_TIME) {
+					return false;
+				}
+
+				isReported = true;
+				return true;
+			}
+
+			// action: DoorObstruction::STOPPED or REOPENED
+			void report(uint8_t action, const common::Time &now)
+			{
+				obstructionMsg.obstacle = obstacle;
+				obstructionMsg.action = action;
+				obstructionMsg.stamp = ros::Time(now.sec, now.nsec);
+				obstruction_pub.publish(obstructionMsg);
+
+				ROS_WARN("Door '%s' obstructed by '%s'; %s", obstructionMsg.model_name.c_str(), obstructionMsg.obstacle.c_str(), 
+					action == dynamic_gazebo_models::DoorObstruction::REOPENED ? "reopening" : "stopped");
+			}
+
+		private:
+
+			// the first contact that isn't the door's own model, its ignored model, or static
+			bool findObstacle()
+			{
+				ContactWatch &watch = ContactWatch::instance();
+
+				for (size_t i=0; i<contacts.size(); i++) {
+					contactModel.assign(contacts[i], 0, contacts[i].find("::"));
+
+					if (contactModel != modelName && contactModel != ignoredModel && !watch.isStatic(contactModel)) {
+						obstacle = contacts[i];
+						return true;
+					}
+				}
+
+				return false;
+			}
+	};
+
+	inline void ContactWatch::contacts_cb(ConstContactsPtr &msg)
+	{
+		if (msg->contact_size() == 0) {
+			return;
+		}
+
+		common::Time stamp = msgs::Convert(msg->time());
+
+		boost::mutex::scoped_lock lock(mutex);
+
+		for (int i=0; i<msg->contact_size(); i++) {
+			const msgs::Contact &contact = msg->contact(i);
+
+			boost::unordered_map<std::string, ObstructionMonitor*>::iterator first = monitors.find(contact.collision1());
+			boost::unordered_map<std::string, ObstructionMonitor*>::iterator second = monitors.find(contact.collision2());
+
+			if ((first == monitors.end()) == (second == monitors.end())) {
+				continue; // door against door (or a door that's just been removed)
+			}
+
+			ObstructionMonitor *monitor = first != monitors.end() ? first->second : second->second;
+			const std::string &collision = first != monitors.end() ? contact.collision2() : contact.collision1();
+
+			if (monitor->lastContactTime != stamp) {
+				monitor->lastContactTime = stamp;
+				monitor->lastContacts.clear();
+			}
+
+			if (std::find(monitor->lastContacts.begin(), monitor->lastContacts.end(), collision) == monitor->lastContacts.end()) {
+				monitor->lastContacts.push_back(collision);
+			}
+		}
+	}
+}
+
+#endif
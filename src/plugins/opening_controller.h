@@ -0,0 +1,100 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_OPENING_CONTROLLER_H
+#define DYNAMIC_GAZEBO_MODELS_OPENING_CONTROLLER_H
+
+#include <math.h>
+#include <algorithm>
+
+#define OPENING_TOLERANCE 0.01 // opening fraction; a door this close to its target has settled
+
+/*
+
+Closed-loop control of a door's opening:
+	Works on the opening fraction (0: closed ... 1: fully open) and its rate, so slide & flip doors share it; the door
+	converts the rate into a velocity along its slide axis or around its hinge.
+
+	The commanded rate follows a trapezoidal profile: it ramps up by at most maxAccel, is capped at maxRate, and on
+	approach is limited to sqrt(2 * maxAccel * distance), so the door brakes just in time and doesn't overshoot. Once
+	the door is within OPENING_TOLERANCE of the target and has slowed down, the controller settles and goes idle: it
+	returns 0 and the door stops commanding its link until the next command.
+
+*/
+
+namespace gazebo
+{
+	class OpeningController
+	{
+		private:
+
+			float target, maxRate, maxAccel; // in opening fractions, per s & per s^2
+			float rate;
+			bool isActive;
+
+		public:
+
+			OpeningController() : target(0), maxRate(0), maxAccel(0), rate(0), isActive(false) {}
+
+			void setTarget(float target, float maxRate, float maxAccel, float currentRate)
+			{
+				this->target = std::min(1.0f, std::max(0.0f, target));
+				this->maxRate = maxRate;
+				this->maxAccel = maxAccel;
+				this->rate = currentRate; // picks up from whatever the door was doing, so there's no jump
+				isActive = true;
+			}
+
+			void stop()
+			{
+				isActive = false;
+				rate = 0;
+			}
+
+			bool getIsActive() const
+			{
+				return isActive;
+			}
+
+			// Returns the opening rate to command for a step of dt seconds
+			float update(float opening, float dt)
+			{
+				if (!isActive) {
+					return 0;
+				}
+
+				float error = target - opening;
+				float maxStep = maxAccel * dt;
+
+				if (fabs(error) < OPENING_TOLERANCE && fabs(rate) <= maxStep) {
+					stop(); // settled
+					return 0;
+				}
+
+				float desired = std::min(maxRate, sqrtf(2 * maxAccel * fabs(error)));
+				desired = error > 0 ? desired : -desired;
+
+				rate += std::max(-maxStep, std::min(maxStep, desired - rate));
+				return rate;
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,256 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_PARAM_WATCH_H
+#define DYNAMIC_GAZEBO_MODELS_PARAM_WATCH_H
+
+#include <string>
+#include <sstream>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+#include <XmlRpcValue.h>
+
+#define TUNING_NAMESPACE "/model_dynamics_manager/tuning"
+#define TUNING_POLL_PERIOD 500 // in ms
+
+/*
+
+Live tuning of plugin parameters:
+	Parameters under /model_dynamics_manager/tuning override the plugin settings of the running units, without
+	respawning them:
+
+		<unit type>/<name>              all units of the type (door, elevator, auto_door, lod)
+		<unit type>/unit_<id>/<name>    one unit; takes precedence over the type-wide value
+
+	A background thread polls the namespace (one parameter server call per period) and publishes an immutable snapshot
+	whenever it changes. The Gazebo thread picks up the latest snapshot once per world iteration, so all units switch to
+	it in the same tick, and never in the middle of one. A unit only looks at a snapshot when it's new; the rest of the
+	time, checking for changes is an integer comparison.
+
+	Only positive numbers are taken. Deleting a parameter leaves the units with the last value they got.
+
+*/
+
+namespace gazebo
+{
+	// One snapshot of the tuning namespace; never changes once published
+	class ParamTuning
+	{
+		private:
+
+			boost::unordered_map<std::string, double> values; // by path below the tuning namespace
+
+		public:
+
+			void set(const std::string &path, double value)
+			{
+				values[path] = value;
+			}
+
+			bool operator==(const ParamTuning &other) const
+			{
+				return values == other.values;
+			}
+
+			// The value for the unit, or for its type; false (and value untouched) if neither is set
+			template <class T>
+			bool get(const std::string &unitType, uint32_t unitRef, const std::string &name, T &value) const
+			{
+				std::ostringstream unitPath;
+				unitPath << unitType << "/unit_" << unitRef << "/" << name;
+
+				boost::unordered_map<std::string, double>::const_iterator it = values.find(unitPath.str());
+
+				if (it == values.end()) {
+					it = values.find(unitType + "/" + name);
+				}
+
+				if (it == values.end()) {
+					return false;
+				}
+
+				value = it->second;
+				return true;
+			}
+	};
+
+	typedef boost::shared_ptr<const ParamTuning> ParamTuningPtr;
+
+	class ParamWatch
+	{
+		private:
+
+			boost::mutex mutex;
+			boost::thread watcher;
+			ParamTuningPtr latest;
+			uint32_t latestVersion;
+
+			// Gazebo thread only:
+			ParamTuningPtr current;
+			uint32_t currentVersion;
+			uint64_t syncedIteration;
+
+			ParamWatch() : latest(new ParamTuning()), latestVersion(0), current(latest), currentVersion(0), syncedIteration(-1) {}
+
+		public:
+
+			static ParamWatch& instance()
+			{
+				static ParamWatch watch;
+				return watch;
+			}
+
+			~ParamWatch()
+			{
+				watcher.interrupt();
+				watcher.join();
+			}
+
+			// started by the first unit that uses it (from the init pool, so the lock matters)
+			void start()
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				if (watcher.get_id() == boost::thread::id()) {
+					watcher = boost::thread(boost::bind(&ParamWatch::poll, this));
+				}
+			}
+
+			// Gazebo thread: the first call of a world iteration takes over the latest snapshot
+			void sync(uint64_t iteration)
+			{
+				if (iteration == syncedIteration) {
+					return;
+				}
+
+				syncedIteration = iteration;
+
+				boost::mutex::scoped_lock lock(mutex);
+				current = latest;
+				currentVersion = latestVersion;
+			}
+
+			uint32_t getVersion() const
+			{
+				return currentVersion;
+			}
+
+			const ParamTuning& getTuning() const
+			{
+				return *current;
+			}
+
+		private:
+
+			void poll()
+			{
+				try {
+					while (true) {
+						ParamTuning *tuning = new ParamTuning();
+						XmlRpc::XmlRpcValue params;
+
+						if (ros::param::get(TUNING_NAMESPACE, params)) {
+							flatten(params, "", *tuning);
+						}
+
+						boost::mutex::scoped_lock lock(mutex);
+
+						if (*tuning == *latest) {
+							delete tuning;
+						} else {
+							latest.reset(tuning);
+							latestVersion++;
+						}
+
+						lock.unlock();
+						boost::this_thread::sleep(boost::posix_time::milliseconds(TUNING_POLL_PERIOD));
+					}
+				} catch (boost::thread_interrupted&) {
+					// shutting down
+				}
+			}
+
+			static void flatten(XmlRpc::XmlRpcValue &params, const std::string &path, ParamTuning &tuning)
+			{
+				if (params.getType() == XmlRpc::XmlRpcValue::TypeStruct) {
+					for (XmlRpc::XmlRpcValue::iterator it = params.begin(); it != params.end(); ++it) {
+						flatten(it->second, path.empty() ? it->first : path + "/" + it->first, tuning);
+					}
+
+					return;
+				}
+
+				double value;
+
+				if (params.getType() == XmlRpc::XmlRpcValue::TypeDouble) {
+					value = static_cast<double>(params);
+				} else if (params.getType() == XmlRpc::XmlRpcValue::TypeInt) {
+					value = static_cast<int>(params);
+				} else {
+					ROS_WARN_ONCE("Tuning parameter '%s' is not a number; ignored", path.c_str());
+					return;
+				}
+
+				if (value <= 0) {
+					ROS_WARN_ONCE("Tuning parameter '%s' must be positive; ignored", path.c_str());
+					return;
+				}
+
+				tuning.set(path, value);
+			}
+	};
+
+	// The tuning as seen by one unit
+	class TuningState
+	{
+		private:
+
+			uint32_t version;
+
+		public:
+
+			TuningState() : version(0) {}
+
+			void init()
+			{
+				ParamWatch::instance().start();
+			}
+
+			// Returns the tuning if it changed since the unit last saw it, NULL otherwise
+			const ParamTuning* update(uint64_t iteration)
+			{
+				ParamWatch &watch = ParamWatch::instance();
+				watch.sync(iteration);
+
+				if (watch.getVersion() == version) {
+					return NULL;
+				}
+
+				version = watch.getVersion();
+				return &watch.getTuning();
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,354 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_PLUGIN_LOG_H
+#define DYNAMIC_GAZEBO_MODELS_PLUGIN_LOG_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+
+#define LOG_RING_SIZE 8192 // entries; a power of 2
+#define LOG_TEXT_SIZE 240 // in chars, per entry
+#define LOG_FLUSH_PERIOD 100 // in ms
+#define LOG_CATEGORY_RATE 5.0 // summary lines per second and category
+#define LOG_CATEGORY_BURST 20 // summary lines a category may write at once
+#define LOG_MAX_RANGES 8 // unit id ranges listed in a summary line
+
+#define LOG_NO_UNIT 0xffffffff
+
+/*
+
+Plugin logging off the physics thread:
+	Per-unit messages (commands, parameter changes, ...) don't go to rosout from the plugin. They're formatted into a
+	fixed-size lock-free ring buffer (multi-producer, single consumer), which a background thread drains every
+	LOG_FLUSH_PERIOD. The drained messages are grouped by category & text, so a group command to 5,000 doors becomes one
+	line:
+
+		[door] Slide speed: [1.000000] - 5000 units: 0-4999
+
+	Each category writes at most LOG_CATEGORY_RATE lines per second (with bursts of LOG_CATEGORY_BURST); the lines over
+	that, and messages that didn't fit in the ring, are counted and reported once there's room again.
+
+	Loading: plugins count their units with unitLoaded() instead of logging each one, and the first update after a batch
+	of loads reports one summary line per plugin type (see reportLoads()).
+
+	Warnings & errors still go straight to ROS_WARN / ROS_ERROR; they're rare and shouldn't be delayed.
+
+*/
+
+namespace gazebo
+{
+	class PluginLog
+	{
+		private:
+
+			struct Entry
+			{
+				std::atomic<size_t> sequence;
+				const char *category; // a string literal
+				uint32_t unit;
+				char text[LOG_TEXT_SIZE];
+			};
+
+			struct CategoryLimit
+			{
+				double tokens, lastRefill; // lastRefill in s (wall time)
+				uint32_t suppressed;
+			};
+
+			Entry *entries;
+			std::atomic<size_t> enqueuePos;
+			size_t dequeuePos; // consumer only
+			std::atomic<uint32_t> dropped;
+
+			boost::mutex startMutex;
+			std::atomic<bool> isStarted;
+			boost::thread drainer;
+
+			std::map<std::string, CategoryLimit> limits; // drainer only
+
+			// load summaries; Gazebo thread only:
+			std::map<const char*, std::map<std::string, uint32_t> > loads; // by plugin type (a string literal), then by description
+			bool hasPendingLoads;
+
+			PluginLog() : entries(new Entry[LOG_RING_SIZE]), enqueuePos(0), dequeuePos(0), dropped(0), isStarted(false), hasPendingLoads(false)
+			{
+				for (size_t i=0; i<LOG_RING_SIZE; i++) {
+					entries[i].sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+		public:
+
+			static PluginLog& instance()
+			{
+				static PluginLog log;
+				return log;
+			}
+
+			~PluginLog()
+			{
+				drainer.interrupt();
+				drainer.join();
+
+				drain(); // whatever came in since the last period
+				delete[] entries;
+			}
+
+			// Never blocks; the message is dropped (and counted) if the ring is full
+			void unitInfo(const char *category, uint32_t unit, const char *format, ...)
+			{
+				start();
+
+				size_t pos = enqueuePos.load(std::memory_order_relaxed);
+				Entry *entry;
+
+				while (true) {
+					entry = &entries[pos & (LOG_RING_SIZE - 1)];
+					intptr_t diff = (intptr_t) entry->sequence.load(std::memory_order_acquire) - (intptr_t) pos;
+
+					if (diff == 0) {
+						if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+							break;
+						}
+					} else if (diff < 0) {
+						dropped.fetch_add(1, std::memory_order_relaxed);
+						return;
+					} else {
+						pos = enqueuePos.load(std::memory_order_relaxed);
+					}
+				}
+
+				entry->category = category;
+				entry->unit = unit;
+
+				va_list args;
+				va_start(args, format);
+				vsnprintf(entry->text, LOG_TEXT_SIZE, format, args);
+				va_end(args);
+
+				entry->sequence.store(pos + 1, std::memory_order_release);
+			}
+
+			// Gazebo thread (plugin Load)
+			void unitLoaded(const char *pluginType, const std::string &description)
+			{
+				loads[pluginType][description]++;
+				hasPendingLoads = true;
+			}
+
+			// Gazebo thread (plugin updates): one line per plugin type for the units loaded since the last report
+			void reportLoads()
+			{
+				if (!hasPendingLoads) {
+					return;
+				}
+
+				hasPendingLoads = false;
+
+				for (std::map<const char*, std::map<std::string, uint32_t> >::iterator it = loads.begin(); it != loads.end(); ++it) {
+					uint32_t total = 0;
+					std::ostringstream kinds;
+
+					for (std::map<std::string, uint32_t>::iterator kind = it->second.begin(); kind != it->second.end(); ++kind) {
+						total += kind->second;
+
+						if (!kind->first.empty()) {
+							kinds << (kinds.tellp() > 0 ? ", " : " (") << kind->second << " " << kind->first;
+						}
+					}
+
+					if (kinds.tellp() > 0) {
+						kinds << ")";
+					}
+
+					unitInfo(it->first, LOG_NO_UNIT, "%u units loaded%s", total, kinds.str().c_str());
+				}
+
+				loads.clear();
+			}
+
+		private:
+
+			// the drainer is started by the first message, so worlds that never log don't pay for the thread
+			void start()
+			{
+				if (isStarted.load(std::memory_order_acquire)) {
+					return;
+				}
+
+				boost::mutex::scoped_lock lock(startMutex);
+
+				if (!isStarted.load(std::memory_order_relaxed)) {
+					drainer = boost::thread(boost::bind(&PluginLog::run, this));
+					isStarted.store(true, std::memory_order_release);
+				}
+			}
+
+			void run()
+			{
+				try {
+					while (true) {
+						boost::this_thread::sleep(boost::posix_time::milliseconds(LOG_FLUSH_PERIOD));
+						drain();
+					}
+				} catch (boost::thread_interrupted&) {
+					// shutting down
+				}
+			}
+
+			void drain()
+			{
+				// the units of each (category, text), in order of first appearance:
+				std::map<std::pair<std::string, std::string>, size_t> groupIndex;
+				std::vector<std::pair<std::string, std::string> > groupKeys;
+				std::vector<std::vector<uint32_t> > groupUnits;
+
+				while (true) {
+					Entry &entry = entries[dequeuePos & (LOG_RING_SIZE - 1)];
+
+					if (entry.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+						break; // empty
+					}
+
+					std::pair<std::string, std::string> key(entry.category, entry.text);
+					uint32_t unit = entry.unit;
+
+					entry.sequence.store(dequeuePos + LOG_RING_SIZE, std::memory_order_release);
+					dequeuePos++;
+
+					std::map<std::pair<std::string, std::string>, size_t>::iterator it = groupIndex.find(key);
+
+					if (it == groupIndex.end()) {
+						it = groupIndex.insert(std::make_pair(key, groupKeys.size())).first;
+						groupKeys.push_back(key);
+						groupUnits.push_back(std::vector<uint32_t>());
+					}
+
+					groupUnits[it->second].push_back(unit);
+				}
+
+				for (size_t i=0; i<groupKeys.size(); i++) {
+					if (!takeToken(groupKeys[i].first)) {
+						continue;
+					}
+
+					ROS_INFO("[%s] %s%s", groupKeys[i].first.c_str(), groupKeys[i].second.c_str(), describeUnits(groupUnits[i]).c_str());
+				}
+
+				uint32_t numDropped = dropped.exchange(0, std::memory_order_relaxed);
+
+				if (numDropped > 0) {
+					ROS_WARN("Plugin log: %u messages dropped (log buffer full)", numDropped);
+				}
+			}
+
+			bool takeToken(const std::string &category)
+			{
+				double now = ros::WallTime::now().toSec();
+
+				if (limits.count(category) == 0) {
+					CategoryLimit limit = {LOG_CATEGORY_BURST, now, 0};
+					limits[category] = limit;
+				}
+
+				CategoryLimit &limit = limits[category];
+				limit.tokens = std::min<double>(LOG_CATEGORY_BURST, limit.tokens + (now - limit.lastRefill) * LOG_CATEGORY_RATE);
+				limit.lastRefill = now;
+
+				if (limit.tokens < 1) {
+					limit.suppressed++;
+					return false;
+				}
+
+				limit.tokens--;
+
+				if (limit.suppressed > 0) {
+					ROS_INFO("[%s] %u summaries suppressed (rate limit)", category.c_str(), limit.suppressed);
+					limit.suppressed = 0;
+				}
+
+				return true;
+			}
+
+			// " - unit 4", or " - 5000 units: 0-4999", or " (3 times)" for messages without a unit
+			static std::string describeUnits(std::vector<uint32_t> &units)
+			{
+				std::ostringstream desc;
+				std::sort(units.begin(), units.end());
+
+				if (units[0] == LOG_NO_UNIT) {
+					if (units.size() > 1) {
+						desc << " (" << units.size() << " times)";
+					}
+
+					return desc.str();
+				}
+
+				units.erase(std::unique(units.begin(), units.end()), units.end());
+				units.erase(std::remove(units.begin(), units.end(), LOG_NO_UNIT), units.end());
+
+				if (units.size() == 1) {
+					desc << " - unit " << units[0];
+					return desc.str();
+				}
+
+				desc << " - " << units.size() << " units: ";
+
+				size_t numRanges = 0;
+
+				for (size_t i=0; i<units.size(); numRanges++) {
+					size_t j = i;
+
+					while (j + 1 < units.size() && units[j + 1] == units[j] + 1) {
+						j++;
+					}
+
+					if (numRanges == LOG_MAX_RANGES) {
+						desc << ", ...";
+						break;
+					}
+
+					desc << (numRanges > 0 ? ", " : "") << units[i];
+
+					if (j > i) {
+						desc << "-" << units[j];
+					}
+
+					i = j + 1;
+				}
+
+				return desc.str();
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,175 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_RIDER_ATTACHMENT_H
+#define DYNAMIC_GAZEBO_MODELS_RIDER_ATTACHMENT_H
+
+#include <vector>
+#include <string>
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+/*
+
+Riders attached to an elevator car:
+	When the car departs, every rider that lies entirely inside the car's bounding box is attached to the car
+	with a fixed joint (a revolute joint with both stops at 0, the way Gazebo's gripper holds objects). For the ride, the
+	rider moves with the car as one body: it doesn't slip or jitter on the car floor and can't be thrown off at speed,
+	and ODE doesn't collide bodies that are jointed together, so the rider's base no longer generates contacts against
+	the car. On arrival the joints are detached and the riders are free again.
+
+	Riders are the dynamic models named in a list; a name ending in '*' matches every model whose name starts with the
+	rest, so loose objects (or other cars) in the car are never tied to it. The models inside the car are only looked
+	up on departure, so riding costs nothing per step. The joints are kept and reused for the next ride. A rider that
+	is deleted during the ride took its bodies (and the joint's hold on them) along with it in the physics engine: its
+	joint is discarded rather than detached.
+
+*/
+
+namespace gazebo
+{
+	class RiderAttachment
+	{
+		private:
+
+			physics::LinkPtr carLink;
+			std::vector<physics::ModelPtr> riders;
+			std::vector<physics::JointPtr> joints; // riders[i] hangs on joints[i]
+
+		public:
+
+			void init(physics::LinkPtr carLink)
+			{
+				this->carLink = carLink;
+			}
+
+			~RiderAttachment()
+			{
+				release();
+			}
+
+			bool getIsAttached() const
+			{
+				return !riders.empty();
+			}
+
+			const std::vector<physics::ModelPtr>& getRiders() const
+			{
+				return riders;
+			}
+
+			// Returns the number of riders attached
+			size_t attach(const std::vector<std::string> &riderNames)
+			{
+				physics::ModelPtr car = carLink->GetModel();
+				physics::WorldPtr world = car->GetWorld();
+				math::Box carBox = carLink->GetBoundingBox();
+
+				release();
+
+				physics::Model_V models = world->GetModels();
+
+				for (size_t i=0; i<models.size(); i++) {
+					if (models[i] == car || models[i]->IsStatic() || !isRider(models[i]->GetName(), riderNames)) {
+						continue;
+					}
+
+					math::Box box = models[i]->GetBoundingBox();
+
+					if (box.min.x > carBox.min.x && box.min.y > carBox.min.y && box.min.z > carBox.min.z &&
+							box.max.x < carBox.max.x && box.max.y < carBox.max.y && box.max.z < carBox.max.z) {
+						riders.push_back(models[i]);
+					}
+				}
+
+				while (joints.size() < riders.size()) {
+					joints.push_back(world->GetPhysicsEngine()->CreateJoint("revolute", car));
+				}
+
+				for (size_t i=0; i<riders.size(); i++) {
+					physics::LinkPtr riderLink = riders[i]->GetLink(); // the canonical link; the rest of the rider hangs on it
+
+					joints[i]->Load(carLink, riderLink, riderLink->GetWorldPose() - carLink->GetWorldPose());
+					joints[i]->Init();
+					joints[i]->SetHighStop(0, 0);
+					joints[i]->SetLowStop(0, 0);
+				}
+
+				return riders.size();
+			}
+
+			// Drops the riders that were deleted during the ride; returns true if there were any
+			bool dropGone()
+			{
+				bool isDropped = false;
+
+				for (size_t i=0; i<riders.size(); ) {
+					if (isPresent(riders[i])) {
+						i++;
+						continue;
+					}
+
+					riders.erase(riders.begin() + i);
+					joints.erase(joints.begin() + i);
+					isDropped = true;
+				}
+
+				return isDropped;
+			}
+
+			void release()
+			{
+				dropGone();
+
+				for (size_t i=0; i<riders.size(); i++) {
+					joints[i]->Detach();
+				}
+
+				riders.clear();
+			}
+
+		private:
+
+			static bool isRider(const std::string &name, const std::vector<std::string> &riderNames)
+			{
+				for (size_t i=0; i<riderNames.size(); i++) {
+					const std::string &riderName = riderNames[i];
+
+					if (!riderName.empty() && riderName[riderName.size() - 1] == '*') {
+						if (name.compare(0, riderName.size() - 1, riderName, 0, riderName.size() - 1) == 0) {
+							return true;
+						}
+					} else if (name == riderName) {
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+			static bool isPresent(physics::ModelPtr model)
+			{
+				return model->GetWorld()->GetModel(model->GetName()) == model;
+			}
+	};
+}
+
+#endif
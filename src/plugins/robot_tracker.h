@@ -0,0 +1,255 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_ROBOT_TRACKER_H
+#define DYNAMIC_GAZEBO_MODELS_ROBOT_TRACKER_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#include <ros/ros.h>
+#include <geometry_msgs/Pose.h>
+
+#include "spatial_hash.h"
+
+#define CONTEXT_SPACE_X_RANGE 2.0 // in m; half-extents of the box around a unit in which a robot counts as nearby
+#define CONTEXT_SPACE_Y_RANGE 2.0
+#define CONTEXT_SPACE_Z_RANGE 2.0
+
+#define MODEL_LOOKUP_PERIOD 1000 // in world iterations; models are looked up again by name at most this often
+
+/*
+
+Process-wide tracker of robot positions:
+	Robots are given either as pose topics (geometry_msgs/Pose) or as Gazebo model names. All plugin instances share one
+	tracker, which rebuilds its spatial hash at most once per world iteration, no matter how many plugins query it.
+
+*/
+
+namespace gazebo
+{
+	/*
+		When to look up models by name again: at most once every MODEL_LOOKUP_PERIOD iterations, and only if models were
+		spawned or deleted since the last lookup. World::GetModel copies the names it compares, so looking up on every
+		period would allocate in a world that doesn't change; comparing the model count doesn't.
+	*/
+	class ModelLookupSchedule
+	{
+		private:
+
+			uint64_t nextIteration;
+			unsigned int modelCount;
+			bool isChanged;
+
+		public:
+
+			ModelLookupSchedule() : nextIteration(0), modelCount(0), isChanged(true) {}
+
+			// forces a lookup on the next call, e.g. after new names were added
+			void reset()
+			{
+				nextIteration = 0;
+				isChanged = true;
+			}
+
+			// Called on every update (so no spawn or delete goes unnoticed); true if the models should be looked up now
+			bool isDue(physics::WorldPtr world)
+			{
+				unsigned int count = world->GetModelCount();
+
+				if (count != modelCount) {
+					modelCount = count;
+					isChanged = true;
+				}
+
+				uint64_t iteration = world->GetIterations();
+
+				if (!isChanged || iteration < nextIteration) {
+					return false;
+				}
+
+				nextIteration = iteration + MODEL_LOOKUP_PERIOD;
+				isChanged = false;
+
+				return true;
+			}
+	};
+
+	class RobotTracker
+	{
+		private:
+
+			ros::NodeHandle *rosNode;
+			std::vector<ros::Subscriber> poseSubs;
+			std::vector<std::string> poseTopics, modelNames;
+
+			std::vector<math::Vector3> topicPoses;
+			std::vector<bool> topicPoseReceived;
+			std::vector<physics::ModelPtr> models;
+
+			SpatialHash grid;
+			ModelLookupSchedule lookup;
+			uint64_t lastIteration;
+			bool isBuilt;
+
+			RobotTracker() : rosNode(NULL), grid(std::max(CONTEXT_SPACE_X_RANGE, std::max(CONTEXT_SPACE_Y_RANGE, CONTEXT_SPACE_Z_RANGE))), lastIteration(0), isBuilt(false) {}
+
+		public:
+
+			static RobotTracker& instance()
+			{
+				static RobotTracker tracker;
+				return tracker;
+			}
+
+			~RobotTracker()
+			{
+				delete rosNode;
+			}
+
+			// Registers the robots listed in the 'bot_pose_topics' & 'bot_model_names' elements of a plugin reference
+			void addRobotsFromSdf(sdf::ElementPtr _sdf)
+			{
+				if (_sdf->HasElement("bot_pose_topics")) {
+					addPoseTopics(parseCsvStr(_sdf->GetElement("bot_pose_topics")->Get<std::string>()));
+				}
+
+				if (_sdf->HasElement("bot_model_names")) {
+					addModelNames(parseCsvStr(_sdf->GetElement("bot_model_names")->Get<std::string>()));
+				}
+			}
+
+			void addPoseTopics(const std::vector<std::string> &topics)
+			{
+				if (rosNode == NULL) {
+					rosNode = new ros::NodeHandle("");
+				}
+
+				for (size_t i=0; i<topics.size(); i++) {
+					if (std::find(poseTopics.begin(), poseTopics.end(), topics[i]) != poseTopics.end()) {
+						continue; // already subscribed by another plugin instance
+					}
+
+					poseTopics.push_back(topics[i]);
+					topicPoses.push_back(math::Vector3());
+					topicPoseReceived.push_back(false);
+
+					poseSubs.push_back(rosNode->subscribe<geometry_msgs::Pose>(topics[i], 1, boost::bind(&RobotTracker::pose_cb, this, _1, poseTopics.size() - 1)));
+				}
+			}
+
+			void addModelNames(const std::vector<std::string> &names)
+			{
+				lookup.reset();
+
+				for (size_t i=0; i<names.size(); i++) {
+					if (std::find(modelNames.begin(), modelNames.end(), names[i]) == modelNames.end()) {
+						modelNames.push_back(names[i]);
+						models.push_back(physics::ModelPtr());
+					}
+				}
+			}
+
+			const std::vector<std::string>& getModelNames() const
+			{
+				return modelNames;
+			}
+
+			bool isEmpty() const
+			{
+				return poseTopics.empty() && modelNames.empty();
+			}
+
+			// Rebuilds the spatial hash if it hasn't been rebuilt during the current world iteration
+			void refresh(physics::WorldPtr world)
+			{
+				uint64_t iteration = world->GetIterations();
+
+				if (isBuilt && iteration == lastIteration) {
+					return;
+				}
+
+				lastIteration = iteration;
+				isBuilt = true;
+				grid.clear();
+
+				for (size_t i=0; i<topicPoses.size(); i++) {
+					if (topicPoseReceived[i]) {
+						grid.insert(topicPoses[i].x, topicPoses[i].y, topicPoses[i].z);
+					}
+				}
+
+				bool isLookup = lookup.isDue(world);
+
+				for (size_t i=0; i<models.size(); i++) {
+					// looked up again after models were spawned or deleted, so deleted robots are dropped and respawned ones picked up
+					if (isLookup) {
+						models[i] = world->GetModel(modelNames[i]);
+					}
+
+					if (models[i]) {
+						math::Vector3 pos = models[i]->GetWorldPose().pos;
+						grid.insert(pos.x, pos.y, pos.z);
+					}
+				}
+			}
+
+			const SpatialHash& getGrid() const
+			{
+				return grid;
+			}
+
+			static std::vector<std::string> parseCsvStr(std::string csv_str)
+			{
+				std::vector<std::string> item_list;
+
+				// parse csv-style input (also remove whitespace):
+				std::string::iterator end_pos = std::remove(csv_str.begin(), csv_str.end(), ' ');
+				csv_str.erase(end_pos, csv_str.end());
+
+				std::istringstream ss(csv_str);
+				std::string token;
+
+				while (std::getline(ss, token, ',')) {
+					if (!token.empty()) {
+						item_list.push_back(token);
+					}
+				}
+
+				return item_list;
+			}
+
+		private:
+
+			void pose_cb(const geometry_msgs::Pose::ConstPtr& pose, size_t index)
+			{
+				topicPoses[index].Set(pose->position.x, pose->position.y, pose->position.z);
+				topicPoseReceived[index] = true;
+			}
+	};
+}
+
+#endif
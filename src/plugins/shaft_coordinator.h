@@ -0,0 +1,237 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_SHAFT_COORDINATOR_H
+#define DYNAMIC_GAZEBO_MODELS_SHAFT_COORDINATOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+
+#define DEFAULT_CAR_CLEARANCE 0.5 // in m; gap kept between two cars of a shaft
+#define NO_PARKING_FLOOR -1
+#define SHAFT_LEVEL_TOLERANCE 0.01 // in m; a car this close to its target is idle
+
+/*
+
+Several cars in one shaft:
+	Elevators with <shared_shaft> that are spawned at the same x, y share a shaft, and can't pass each other. Before each step, a car asks the
+	coordinator how far it may go towards its target floor:
+
+	* a car never moves closer than the clearance to the current position of its neighbours
+	* when two cars have targets that can't both be served (the cars would overlap), the later request yields: it only
+	  goes as far as the floor closest to its target that's compatible with the other car's target
+	* an idle car (at its target) that is in the way of a neighbour's target is sent to the nearest floor that clears
+	  it (parked)
+
+	so the cars never conflict, and every reachable target is eventually served. Heights are those of each car's
+	reference point (the one its floor heights are given for); a car spans [height - below, height + above].
+	The coordinator is only used from the Gazebo thread (plugin updates).
+
+*/
+
+namespace gazebo
+{
+	struct ShaftCar
+	{
+		float height, targetHeight; // in m
+		float below, above; // extent of the car around its reference point
+		const std::vector<float> *floorHeights; // sorted
+		uint64_t requestIteration; // when the current target was set
+		int parkingFloor; // set by the coordinator, NO_PARKING_FLOOR if none
+
+		bool isIdle() const
+		{
+			return fabs(height - targetHeight) < SHAFT_LEVEL_TOLERANCE;
+		}
+	};
+
+	class ShaftCoordinator
+	{
+		private:
+
+			struct Shaft
+			{
+				std::vector<ShaftCar*> cars;
+				float clearance;
+			};
+
+			std::map<std::string, Shaft> shafts;
+
+			ShaftCoordinator() {}
+
+		public:
+
+			static ShaftCoordinator& instance()
+			{
+				static ShaftCoordinator coordinator;
+				return coordinator;
+			}
+
+			void add(const std::string &shaftName, ShaftCar *car, float clearance)
+			{
+				Shaft &shaft = shafts[shaftName];
+				shaft.clearance = clearance; // the same for all cars of a shaft
+				shaft.cars.push_back(car);
+			}
+
+			void remove(const std::string &shaftName, ShaftCar *car)
+			{
+				std::map<std::string, Shaft>::iterator it = shafts.find(shaftName);
+
+				if (it == shafts.end()) {
+					return;
+				}
+
+				std::vector<ShaftCar*> &cars = it->second.cars;
+				cars.erase(std::remove(cars.begin(), cars.end(), car), cars.end());
+
+				if (cars.empty()) {
+					shafts.erase(it);
+				}
+			}
+
+			// Returns the height the car may move towards during this step (its own height if it has to wait)
+			float clampTarget(const std::string &shaftName, ShaftCar *car)
+			{
+				Shaft &shaft = shafts[shaftName];
+				float target = car->targetHeight;
+
+				for (size_t i=0; i<shaft.cars.size(); i++) {
+					ShaftCar *other = shaft.cars[i];
+
+					if (other == car) {
+						continue;
+					}
+
+					bool isAbove = other->height > car->height;
+
+					if (isAbove ? !isNeighbourAbove(shaft, car, other) : !isNeighbourBelow(shaft, car, other)) {
+						continue;
+					}
+
+					target = isAbove ? clampBelow(shaft, car, other, target) : clampAbove(shaft, car, other, target);
+				}
+
+				return target;
+			}
+
+		private:
+
+			// only the direct neighbours matter, since cars keep their order in the shaft
+			static bool isNeighbourAbove(const Shaft &shaft, const ShaftCar *car, const ShaftCar *other)
+			{
+				for (size_t i=0; i<shaft.cars.size(); i++) {
+					if (shaft.cars[i]->height > car->height && shaft.cars[i]->height < other->height) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			static bool isNeighbourBelow(const Shaft &shaft, const ShaftCar *car, const ShaftCar *other)
+			{
+				for (size_t i=0; i<shaft.cars.size(); i++) {
+					if (shaft.cars[i]->height < car->height && shaft.cars[i]->height > other->height) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			// car is below 'upper'
+			static float clampBelow(const Shaft &shaft, ShaftCar *car, ShaftCar *upper, float target)
+			{
+				float gap = car->above + shaft.clearance + upper->below;
+
+				if (car->targetHeight + gap > upper->targetHeight) {
+					// the targets conflict:
+					if (upper->isIdle()) {
+						upper->parkingFloor = findFloor(*upper->floorHeights, car->targetHeight + gap, true);
+					}
+
+					if (upper->parkingFloor == NO_PARKING_FLOOR && (upper->isIdle() || lowerYields(car, upper, gap))) {
+						int floor = findFloor(*car->floorHeights, upper->targetHeight - gap, false);
+						target = floor == NO_PARKING_FLOOR ? car->height : (*car->floorHeights)[floor];
+					}
+				}
+
+				// never closer than the clearance to where the other car is now:
+				return std::min(target, std::max(car->height, upper->height - gap));
+			}
+
+			// car is above 'lower'
+			static float clampAbove(const Shaft &shaft, ShaftCar *car, ShaftCar *lower, float target)
+			{
+				float gap = lower->above + shaft.clearance + car->below;
+
+				if (lower->targetHeight + gap > car->targetHeight) {
+					if (lower->isIdle()) {
+						lower->parkingFloor = findFloor(*lower->floorHeights, car->targetHeight - gap, false);
+					}
+
+					if (lower->parkingFloor == NO_PARKING_FLOOR && (lower->isIdle() || !lowerYields(lower, car, gap))) {
+						int floor = findFloor(*car->floorHeights, lower->targetHeight + gap, true);
+						target = floor == NO_PARKING_FLOOR ? car->height : (*car->floorHeights)[floor];
+					}
+				}
+
+				return std::max(target, std::min(car->height, lower->height + gap));
+			}
+
+			// Of two moving cars with conflicting targets, the one that can make room does; if both can, the later request
+			static bool lowerYields(const ShaftCar *lower, const ShaftCar *upper, float gap)
+			{
+				bool lowerCanYield = findFloor(*lower->floorHeights, upper->targetHeight - gap, false) != NO_PARKING_FLOOR;
+				bool upperCanYield = findFloor(*upper->floorHeights, lower->targetHeight + gap, true) != NO_PARKING_FLOOR;
+
+				if (lowerCanYield != upperCanYield) {
+					return lowerCanYield;
+				}
+
+				return yields(lower, upper);
+			}
+
+			// the later request yields (ties are broken by address, so exactly one car does)
+			static bool yields(const ShaftCar *car, const ShaftCar *other)
+			{
+				return car->requestIteration > other->requestIteration || (car->requestIteration == other->requestIteration && car > other);
+			}
+
+			// The lowest floor at or above the height (isUp), or the highest one at or below it
+			static int findFloor(const std::vector<float> &floorHeights, float height, bool isUp)
+			{
+				if (isUp) {
+					std::vector<float>::const_iterator it = std::lower_bound(floorHeights.begin(), floorHeights.end(), height);
+					return it == floorHeights.end() ? NO_PARKING_FLOOR : it - floorHeights.begin();
+				}
+
+				std::vector<float>::const_iterator it = std::upper_bound(floorHeights.begin(), floorHeights.end(), height);
+				return it == floorHeights.begin() ? NO_PARKING_FLOOR : (it - floorHeights.begin()) - 1;
+			}
+	};
+}
+
+#endif
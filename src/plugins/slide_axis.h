@@ -0,0 +1,107 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_SLIDE_AXIS_H
+#define DYNAMIC_GAZEBO_MODELS_SLIDE_AXIS_H
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/math/gzmath.hh>
+
+/*
+
+Slide axis of a sliding door:
+	Computed once at spawn from the orientation of the door link (the door panel spans its local x axis), so doors can
+	face any direction. The door's position is then a single 'travel' value along that axis, measured from the spawn
+	(closed) position: [0, max_trans_dist] for left-sliding doors, [-max_trans_dist, 0] for right-sliding ones.
+
+*/
+
+namespace gazebo
+{
+	class SlideAxis
+	{
+		private:
+
+			math::Vector3 origin, dir;
+			float minTravel, maxTravel;
+			bool isRight;
+
+		public:
+
+			SlideAxis() : minTravel(0), maxTravel(0), isRight(false) {}
+
+			void init(const math::Vector3 &spawnPos, const math::Quaternion &doorRot, float maxTransDist, bool slideRight)
+			{
+				origin = spawnPos;
+
+				dir = doorRot.RotateVector(math::Vector3(1, 0, 0));
+				dir.z = 0;
+				dir.Normalize();
+
+				isRight = slideRight;
+				setMaxTransDist(maxTransDist);
+			}
+
+			// the axis stays, only the travel range changes (live tuning)
+			void setMaxTransDist(float maxTransDist)
+			{
+				minTravel = isRight ? -maxTransDist : 0;
+				maxTravel = isRight ? 0 : maxTransDist;
+			}
+
+			float project(const math::Vector3 &pos) const
+			{
+				return (pos.x - origin.x) * dir.x + (pos.y - origin.y) * dir.y;
+			}
+
+			// point on the axis at the given travel; the height is left to the caller
+			math::Vector3 pointAt(float travel, double z) const
+			{
+				return math::Vector3(origin.x + dir.x * travel, origin.y + dir.y * travel, z);
+			}
+
+			math::Vector3 velocity(float speed) const
+			{
+				return dir * speed;
+			}
+
+			const math::Vector3& getOrigin() const
+			{
+				return origin;
+			}
+
+			const math::Vector3& getDir() const
+			{
+				return dir;
+			}
+
+			float getMinTravel() const
+			{
+				return minTravel;
+			}
+
+			float getMaxTravel() const
+			{
+				return maxTravel;
+			}
+	};
+}
+
+#endif
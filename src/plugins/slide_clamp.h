@@ -0,0 +1,149 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_SLIDE_CLAMP_H
+#define DYNAMIC_GAZEBO_MODELS_SLIDE_CLAMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SLIDE_CLAMP_X86
+#include <immintrin.h>
+#endif
+
+/*
+
+Batched slide constraints:
+	Clamps a packed array of door travels (position along each door's slide axis) to [minTravel[i], maxTravel[i]] in
+	place, and writes the indices of the doors that were actually moved to 'changed'. Returns the number of changed doors.
+	The AVX2 / SSE variants are picked at runtime from what the CPU supports; the scalar version handles the rest.
+
+*/
+
+struct SlideClampArrays
+{
+	float *travel;
+	const float *minTravel, *maxTravel;
+};
+
+typedef size_t (*SlideClampKernel)(const SlideClampArrays &doors, size_t begin, size_t end, uint32_t *changed);
+
+static inline size_t clampSlideScalar(const SlideClampArrays &doors, size_t begin, size_t end, uint32_t *changed)
+{
+	size_t numChanged = 0;
+
+	for (size_t i = begin; i < end; i++) {
+		float s = doors.travel[i];
+
+		if (s > doors.maxTravel[i]) {
+			doors.travel[i] = doors.maxTravel[i];
+			changed[numChanged++] = i;
+		} else if (s < doors.minTravel[i]) {
+			doors.travel[i] = doors.minTravel[i];
+			changed[numChanged++] = i;
+		}
+	}
+
+	return numChanged;
+}
+
+#ifdef SLIDE_CLAMP_X86
+
+__attribute__((target("sse2")))
+static inline size_t clampSlideSSE(const SlideClampArrays &doors, size_t begin, size_t end, uint32_t *changed)
+{
+	size_t numChanged = 0;
+	size_t i = begin;
+
+	for (; i + 4 <= end; i += 4) {
+		__m128 s = _mm_loadu_ps(doors.travel + i);
+		__m128 cs = _mm_max_ps(_mm_min_ps(s, _mm_loadu_ps(doors.maxTravel + i)), _mm_loadu_ps(doors.minTravel + i));
+
+		int mask = _mm_movemask_ps(_mm_cmpneq_ps(s, cs));
+
+		if (mask == 0) {
+			continue; // the common case: all four doors are within their limits
+		}
+
+		_mm_storeu_ps(doors.travel + i, cs);
+
+		for (int lane = 0; lane < 4; lane++) {
+			if (mask & (1 << lane)) {
+				changed[numChanged++] = i + lane;
+			}
+		}
+	}
+
+	return numChanged + clampSlideScalar(doors, i, end, changed + numChanged);
+}
+
+__attribute__((target("avx2")))
+static inline size_t clampSlideAVX2(const SlideClampArrays &doors, size_t begin, size_t end, uint32_t *changed)
+{
+	size_t numChanged = 0;
+	size_t i = begin;
+
+	for (; i + 8 <= end; i += 8) {
+		__m256 s = _mm256_loadu_ps(doors.travel + i);
+		__m256 cs = _mm256_max_ps(_mm256_min_ps(s, _mm256_loadu_ps(doors.maxTravel + i)), _mm256_loadu_ps(doors.minTravel + i));
+
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(s, cs, _CMP_NEQ_UQ));
+
+		if (mask == 0) {
+			continue;
+		}
+
+		_mm256_storeu_ps(doors.travel + i, cs);
+
+		for (int lane = 0; lane < 8; lane++) {
+			if (mask & (1 << lane)) {
+				changed[numChanged++] = i + lane;
+			}
+		}
+	}
+
+	return numChanged + clampSlideScalar(doors, i, end, changed + numChanged);
+}
+
+#endif
+
+static inline SlideClampKernel selectSlideClampKernel()
+{
+#ifdef SLIDE_CLAMP_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		return clampSlideAVX2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		return clampSlideSSE;
+	}
+#endif
+
+	return clampSlideScalar;
+}
+
+static inline size_t clampSlideBatch(const SlideClampArrays &doors, size_t numDoors, uint32_t *changed)
+{
+	static const SlideClampKernel kernel = selectSlideClampKernel();
+	return kernel(doors, 0, numDoors, changed);
+}
+
+#endif
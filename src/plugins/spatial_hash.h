@@ -0,0 +1,146 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_SPATIAL_HASH_H
+#define DYNAMIC_GAZEBO_MODELS_SPATIAL_HASH_H
+
+#include <vector>
+#include <math.h>
+#include <stdint.h>
+
+#define SPATIAL_HASH_TABLE_SIZE 4096 // must be a power of two
+#define SPATIAL_HASH_EMPTY -1
+
+/*
+
+Uniform-grid spatial hash for robot positions:
+	Points are bucketed by the cube cell (edge = cell size) they fall into. The grid is cleared and refilled every tick;
+	clear() only resets the slots that were used, and keeps the allocated storage, so refilling is O(points).
+	A box query only visits the cells overlapping the box, so its cost does not depend on the total number of points.
+
+*/
+
+class SpatialHash
+{
+	private:
+
+		struct Point
+		{
+			double x, y, z;
+		};
+
+		double cellSize, invCellSize;
+
+		std::vector<int> slotHeads;  // first point index per table slot
+		std::vector<int> nextPoint;  // chained point indices within a slot
+		std::vector<int> usedSlots;
+		std::vector<Point> points;
+
+	public:
+
+		SpatialHash(double cellSize = 2.0)
+		{
+			slotHeads.assign(SPATIAL_HASH_TABLE_SIZE, SPATIAL_HASH_EMPTY);
+			setCellSize(cellSize);
+		}
+
+		void setCellSize(double cellSize)
+		{
+			this->cellSize = cellSize;
+			this->invCellSize = 1.0 / cellSize;
+			clear();
+		}
+
+		double getCellSize() const
+		{
+			return this->cellSize;
+		}
+
+		void clear()
+		{
+			for (size_t i=0; i<usedSlots.size(); i++) {
+				slotHeads[usedSlots[i]] = SPATIAL_HASH_EMPTY;
+			}
+
+			usedSlots.clear();
+			nextPoint.clear();
+			points.clear();
+		}
+
+		void insert(double x, double y, double z)
+		{
+			uint32_t slot = hashCell(cellCoord(x), cellCoord(y), cellCoord(z));
+
+			if (slotHeads[slot] == SPATIAL_HASH_EMPTY) {
+				usedSlots.push_back(slot);
+			}
+
+			Point p = {x, y, z};
+			points.push_back(p);
+			nextPoint.push_back(slotHeads[slot]);
+			slotHeads[slot] = points.size() - 1;
+		}
+
+		size_t size() const
+		{
+			return points.size();
+		}
+
+		// true if any point lies inside the axis-aligned box centered at (x, y, z) with half-extents (rx, ry, rz)
+		bool anyWithin(double x, double y, double z, double rx, double ry, double rz) const
+		{
+			if (points.empty()) {
+				return false;
+			}
+
+			int minX = cellCoord(x - rx), maxX = cellCoord(x + rx);
+			int minY = cellCoord(y - ry), maxY = cellCoord(y + ry);
+			int minZ = cellCoord(z - rz), maxZ = cellCoord(z + rz);
+
+			for (int cx = minX; cx <= maxX; cx++) {
+				for (int cy = minY; cy <= maxY; cy++) {
+					for (int cz = minZ; cz <= maxZ; cz++) {
+						for (int i = slotHeads[hashCell(cx, cy, cz)]; i != SPATIAL_HASH_EMPTY; i = nextPoint[i]) {
+							// slots are shared by colliding cells, so always test the actual coordinates
+							if (fabs(points[i].x - x) <= rx && fabs(points[i].y - y) <= ry && fabs(points[i].z - z) <= rz) {
+								return true;
+							}
+						}
+					}
+				}
+			}
+
+			return false;
+		}
+
+	private:
+
+		int cellCoord(double v) const
+		{
+			return (int) floor(v * invCellSize);
+		}
+
+		static uint32_t hashCell(int cx, int cy, int cz)
+		{
+			return (((uint32_t) cx * 73856093u) ^ ((uint32_t) cy * 19349663u) ^ ((uint32_t) cz * 83492791u)) & (SPATIAL_HASH_TABLE_SIZE - 1);
+		}
+};
+
+#endif
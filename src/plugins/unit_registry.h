@@ -0,0 +1,296 @@
+// Copyright (c) 2014 Mohit Shridhar, David Lee
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DYNAMIC_GAZEBO_MODELS_UNIT_REGISTRY_H
+#define DYNAMIC_GAZEBO_MODELS_UNIT_REGISTRY_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <stdlib.h>
+
+#include <boost/bind.hpp>
+#include <gazebo/gazebo.hh>
+
+#include <ros/ros.h>
+#include <dynamic_gazebo_models/ActiveUnits.h>
+#include <dynamic_gazebo_models/UnitDelta.h>
+
+#define MAX_UNIT_ID 65535 // unit ids index a dense table
+#define DELTA_REPLAY_DEPTH 100 // deltas kept to replay onto a list that arrives after them; the delta subscription queue
+
+/*
+
+Unit ids & message routing:
+	Every door / elevator has a numeric id (its 'reference number') that control groups refer to. It is either given
+	explicitly with a <unit_id> element in the plugin reference, or parsed from the model name, which must then be the
+	model domain space followed by a number ('door_12'). A name that doesn't match is rejected instead of becoming 0.
+
+	All units of a type register in one table indexed by id. The registry keeps the only subscriptions to the active list
+	& the active delta of the controller, and delivers the command topics to the active units only:
+
+		UnitRegistry<DoorPlugin> &registry = UnitRegistry<DoorPlugin>::instance();
+		if (registry.init("/door_controller")) {
+			registry.route<geometry_msgs::Twist>("/door_controller/command", 1000, &DoorPlugin::cmd_ang_cb);
+		}
+		registry.add(door_ref_num, this);
+
+	so a command costs one table lookup per active unit instead of one id comparison per unit in the world. Units are
+	added once their deferred ROS setup has finished (see init_pool.h), so the routed handlers never run alongside it.
+	The registry is only touched from the Gazebo thread (plugin Load / destructors and ros::spinOnce in the updates).
+
+	Several units may share an id (e.g. the auto doors of one elevator, one per floor).
+
+	The active lists & deltas come in on two topics, so they can arrive out of order. They are numbered together by the
+	controller: anything older than the last list is dropped, and deltas that were newer than a list that arrives after
+	them are applied again on top of it.
+
+*/
+
+namespace gazebo
+{
+	// Parses '<prefix><number>'; returns false if the name doesn't have that form
+	static inline bool parseUnitId(const std::string &name, const std::string &prefix, uint32_t &id)
+	{
+		if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) {
+			return false;
+		}
+
+		std::string number = name.substr(prefix.size());
+
+		if (number.find_first_not_of("0123456789") != std::string::npos) {
+			return false;
+		}
+
+		unsigned long value = strtoul(number.c_str(), NULL, 10);
+
+		if (value > MAX_UNIT_ID) {
+			return false;
+		}
+
+		id = value;
+		return true;
+	}
+
+	// An explicit <unit_id> element wins over the model name
+	static inline bool resolveUnitId(sdf::ElementPtr _sdf, const std::string &modelName, const std::string &prefix, uint32_t &id)
+	{
+		if (_sdf->HasElement("unit_id")) {
+			int value = _sdf->GetElement("unit_id")->Get<int>();
+
+			if (value < 0 || value > MAX_UNIT_ID) {
+				ROS_ERROR("Model '%s': unit_id %d is out of range [0, %d]", modelName.c_str(), value, MAX_UNIT_ID);
+				return false;
+			}
+
+			id = value;
+			return true;
+		}
+
+		if (!parseUnitId(modelName, prefix, id)) {
+			ROS_ERROR("Model '%s': the name is not '%s<number>' and no unit_id is given in the plugin reference. The unit can't be controlled", modelName.c_str(), prefix.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	template <class Unit>
+	class UnitRegistry
+	{
+		private:
+
+			std::vector<std::vector<Unit*> > units; // indexed by id
+			std::vector<bool> activeFlags; // indexed by id
+			std::vector<uint32_t> activeIds;
+
+			bool hasList;
+			uint32_t listSeq; // of the last active list applied
+			std::deque<dynamic_gazebo_models::UnitDelta::ConstPtr> deltas; // applied, newest last
+
+			ros::NodeHandle *rosNode;
+			std::vector<ros::Subscriber> subs;
+
+			UnitRegistry() : rosNode(NULL), hasList(false), listSeq(0) {}
+
+		public:
+
+			static UnitRegistry& instance()
+			{
+				static UnitRegistry registry;
+				return registry;
+			}
+
+			~UnitRegistry()
+			{
+				subs.clear();
+				delete rosNode;
+			}
+
+			// Subscribes to the active list & delta of a controller; returns true on the first call only (set up the routes then)
+			bool init(const std::string &controllerNs)
+			{
+				if (rosNode != NULL) {
+					return false;
+				}
+
+				rosNode = new ros::NodeHandle("");
+
+				subs.push_back(rosNode->subscribe<dynamic_gazebo_models::ActiveUnits>(controllerNs + "/active", 1000, &UnitRegistry::active_cb, this));
+				subs.push_back(rosNode->subscribe<dynamic_gazebo_models::UnitDelta>(controllerNs + "/active_delta", 100, &UnitRegistry::active_delta_cb, this));
+
+				return true;
+			}
+
+			// Delivers the messages of a topic to the active units
+			template <class M>
+			void route(const std::string &topic, uint32_t queueSize, void (Unit::*handler)(const typename M::ConstPtr&))
+			{
+				subs.push_back(rosNode->subscribe<M>(topic, queueSize, boost::bind(&UnitRegistry::template dispatch<M>, this, _1, handler)));
+			}
+
+			void add(uint32_t id, Unit *unit)
+			{
+				if (id >= units.size()) {
+					units.resize(id + 1);
+					activeFlags.resize(id + 1, false);
+				}
+
+				units[id].push_back(unit);
+			}
+
+			void remove(uint32_t id, Unit *unit)
+			{
+				if (id < units.size()) {
+					units[id].erase(std::remove(units[id].begin(), units[id].end(), unit), units[id].end());
+				}
+			}
+
+			bool isActive(uint32_t id) const
+			{
+				return id < activeFlags.size() && activeFlags[id];
+			}
+
+		private:
+
+			void setActive(uint32_t id, bool state)
+			{
+				if (id >= activeFlags.size()) {
+					// not spawned (yet); remember it, so a unit that registers later knows
+					units.resize(id + 1);
+					activeFlags.resize(id + 1, false);
+				}
+
+				if (activeFlags[id] == state) {
+					return;
+				}
+
+				activeFlags[id] = state;
+
+				if (state) {
+					activeIds.push_back(id);
+				} else {
+					activeIds.erase(std::find(activeIds.begin(), activeIds.end(), id));
+				}
+			}
+
+			// wraps around like the sequence numbers do
+			static bool isOlder(uint32_t seq, uint32_t than)
+			{
+				return static_cast<int32_t>(seq - than) < 0;
+			}
+
+			void active_cb(const dynamic_gazebo_models::ActiveUnits::ConstPtr& activeList)
+			{
+				if (hasList && isOlder(activeList->seq, listSeq)) {
+					return;
+				}
+
+				hasList = true;
+				listSeq = activeList->seq;
+
+				for (size_t i=0; i<activeIds.size(); i++) {
+					activeFlags[activeIds[i]] = false;
+				}
+
+				activeIds.clear();
+
+				for (size_t i=0; i<activeList->units.size(); i++) {
+					if (activeList->units[i] <= MAX_UNIT_ID) {
+						setActive(activeList->units[i], true);
+					}
+				}
+
+				// the deltas that were published after this list:
+				while (!deltas.empty() && !isOlder(listSeq, deltas.front()->seq)) {
+					deltas.pop_front();
+				}
+
+				for (size_t i=0; i<deltas.size(); i++) {
+					applyDelta(*deltas[i]);
+				}
+			}
+
+			void active_delta_cb(const dynamic_gazebo_models::UnitDelta::ConstPtr& delta)
+			{
+				if (hasList && isOlder(delta->seq, listSeq)) {
+					return;
+				}
+
+				applyDelta(*delta);
+
+				deltas.push_back(delta);
+				if (deltas.size() > DELTA_REPLAY_DEPTH) {
+					deltas.pop_front();
+				}
+			}
+
+			void applyDelta(const dynamic_gazebo_models::UnitDelta &delta)
+			{
+				for (size_t i=0; i<delta.added.size(); i++) {
+					if (delta.added[i] <= MAX_UNIT_ID) {
+						setActive(delta.added[i], true);
+					}
+				}
+
+				// a unit listed on both sides ends up inactive
+				for (size_t i=0; i<delta.removed.size(); i++) {
+					if (delta.removed[i] <= MAX_UNIT_ID) {
+						setActive(delta.removed[i], false);
+					}
+				}
+			}
+
+			template <class M>
+			void dispatch(const typename M::ConstPtr& msg, void (Unit::*handler)(const typename M::ConstPtr&))
+			{
+				for (size_t i=0; i<activeIds.size(); i++) {
+					const std::vector<Unit*> &targets = units[activeIds[i]];
+
+					for (size_t j=0; j<targets.size(); j++) {
+						(targets[j]->*handler)(msg);
+					}
+				}
+			}
+	};
+}
+
+#endif